@@ -6,6 +6,7 @@
 UDungeonMakerGraph::UDungeonMakerGraph()
 {
 	NodeType = UDungeonMakerNode::StaticClass();
+	GraphID = 0;
 
 #if WITH_EDITORONLY_DATA
 	EdGraph = nullptr;
@@ -152,6 +153,7 @@ void UDungeonMakerGraph::ClearGraph()
 
 	AllNodes.Reset();
 	RootNodes.Reset();
+	GraphID = 0;
 }
 
 void UDungeonMakerGraph::UpdateIDs()
@@ -165,6 +167,46 @@ void UDungeonMakerGraph::UpdateIDs()
 	}
 }
 
+void UDungeonMakerGraph::UpdateGraphID()
+{
+	uint32 hash = GetTypeHash(AllNodes.Num());
+	for (int i = 0; i < AllNodes.Num(); ++i)
+	{
+		UDungeonMakerNode* Node = AllNodes[i];
+		check(Node != nullptr);
+
+		hash = HashCombine(hash, GetTypeHash(Node->NodeType));
+		hash = HashCombine(hash, GetTypeHash(Node->NodeID));
+		hash = HashCombine(hash, GetTypeHash(Node->bTightlyCoupledToParent));
+		for (int j = 0; j < Node->ChildrenNodes.Num(); ++j)
+		{
+			hash = HashCombine(hash, GetTypeHash(Node->ChildrenNodes[j]->NodeID));
+		}
+	}
+
+	// 0 is reserved for "not calculated yet"
+	GraphID = hash == 0 ? 1 : hash;
+}
+
+uint32 UDungeonMakerGraph::GetGraphID() const
+{
+	checkSlow(GraphID != 0);
+	return GraphID;
+}
+
+void UDungeonMakerGraph::PostLoad()
+{
+	Super::PostLoad();
+	UpdateGraphID();
+}
+
+#if WITH_EDITOR
+void UDungeonMakerGraph::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	UpdateGraphID();
+}
+#endif
 
 FString UDungeonMakerGraph::ToString() const
 {
@@ -70,16 +70,25 @@ FString UDungeonMakerNode::ToString(int32 IndentLevel, bool bPrintChildren)
 
 bool UDungeonMakerNode::IsChildOf(UDungeonMakerNode* ParentSymbol) const
 {
-	for (UDungeonMakerNode* parent : ParentNodes)
+	// Walk up through all our ancestors, visiting each one only once
+	TSet<const UDungeonMakerNode*> visited;
+	TArray<const UDungeonMakerNode*> toVisit;
+	toVisit.Add(this);
+	while (toVisit.Num() > 0)
 	{
-		if (parent == ParentSymbol)
+		const UDungeonMakerNode* current = toVisit.Pop(false);
+		for (UDungeonMakerNode* parent : current->ParentNodes)
 		{
-			return true;
-		}
-		// If our parent is a child of this symbol, so are we
-		if (parent->IsChildOf(ParentSymbol))
-		{
-			return true;
+			if (parent == ParentSymbol)
+			{
+				return true;
+			}
+			// If our parent is a child of this symbol, so are we
+			if (parent != NULL && !visited.Contains(parent))
+			{
+				visited.Add(parent);
+				toVisit.Add(parent);
+			}
 		}
 	}
 	return false;
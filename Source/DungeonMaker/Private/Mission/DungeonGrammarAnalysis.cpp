@@ -0,0 +1,427 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonGrammarAnalysis.h"
+#include "DungeonMissionGrammar.h"
+
+FDungeonGrammarAnalysis::FDungeonGrammarAnalysis()
+{
+	Reset();
+}
+
+void FDungeonGrammarAnalysis::Reset()
+{
+	Rules.Reset();
+	AnalyzedHeadSymbol = NULL;
+	Symbols.Reset();
+	SymbolIndices.Reset();
+	RuleCanFire.Reset();
+	RuleReachable.Reset();
+	RuleRecursive.Reset();
+	RuleConsumesAnything.Reset();
+	RuleConsumes.Reset();
+	RuleProduces.Reset();
+	SymbolRules.Reset();
+	SymbolReachable.Reset();
+	SymbolComponent.Reset();
+	ComponentOrder.Reset();
+	bHasCycle = false;
+	MaxRewriteCount = 0;
+	MaxNodeCount = 1;
+}
+
+bool FDungeonGrammarAnalysis::IsBuiltFor(const TArray<const UDungeonMissionGrammar*>& Grammars, const UGraphNode* HeadSymbol) const
+{
+	return AnalyzedHeadSymbol == HeadSymbol && Rules == Grammars;
+}
+
+void FDungeonGrammarAnalysis::Build(const TArray<const UDungeonMissionGrammar*>& Grammars, const UGraphNode* HeadSymbol)
+{
+	Reset();
+	Rules = Grammars;
+	AnalyzedHeadSymbol = HeadSymbol;
+	if (HeadSymbol == NULL)
+	{
+		return;
+	}
+
+	int32 ruleCount = Rules.Num();
+	RuleCanFire.SetNumZeroed(ruleCount);
+	RuleReachable.SetNumZeroed(ruleCount);
+	RuleRecursive.SetNumZeroed(ruleCount);
+	RuleConsumesAnything.SetNumZeroed(ruleCount);
+	RuleConsumes.SetNum(ruleCount);
+	RuleProduces.SetNum(ruleCount);
+
+	// Only the head symbol and symbols which get output can ever be in a mission
+	int32 headSymbolIndex = AddSymbol(HeadSymbol);
+	for (const UDungeonMissionGrammar* grammar : Rules)
+	{
+		if (grammar == NULL || grammar->OutputGraph == NULL)
+		{
+			continue;
+		}
+		for (const UDungeonMakerNode* node : grammar->OutputGraph->AllNodes)
+		{
+			if (node != NULL && node->NodeType != NULL)
+			{
+				AddSymbol(node->NodeType);
+			}
+		}
+	}
+
+	for (int32 i = 0; i < ruleCount; i++)
+	{
+		ReadRule(i);
+	}
+
+	SymbolRules.SetNum(Symbols.Num());
+	for (int32 symbol = 0; symbol < Symbols.Num(); symbol++)
+	{
+		if (IsTerminalSymbol(symbol))
+		{
+			// Terminal nodes never get replaced
+			continue;
+		}
+		for (int32 rule = 0; rule < ruleCount; rule++)
+		{
+			if (RuleCanFire[rule] && (RuleConsumesAnything[rule] || RuleConsumes[rule].Contains(symbol)))
+			{
+				SymbolRules[symbol].Add(rule);
+			}
+		}
+	}
+
+	FindReachableRules(headSymbolIndex);
+	FindComponents();
+	if (!bHasCycle)
+	{
+		FindBounds();
+	}
+}
+
+int32 FDungeonGrammarAnalysis::AddSymbol(const UGraphNode* Symbol)
+{
+	const int32* existing = SymbolIndices.Find(Symbol);
+	if (existing != NULL)
+	{
+		return *existing;
+	}
+	int32 index = Symbols.Add(Symbol);
+	SymbolIndices.Add(Symbol, index);
+	return index;
+}
+
+bool FDungeonGrammarAnalysis::IsTerminalSymbol(int32 Symbol) const
+{
+	return Symbols[Symbol]->bIsTerminalNode;
+}
+
+void FDungeonGrammarAnalysis::ReadRule(int32 Rule)
+{
+	const UDungeonMissionGrammar* grammar = Rules[Rule];
+	if (grammar == NULL || grammar->OutputGraph == NULL)
+	{
+		return;
+	}
+
+	// The output needs a root to replace the matched node with
+	bool bHasOutputRoot = false;
+	for (const UDungeonMakerNode* node : grammar->OutputGraph->AllNodes)
+	{
+		if (node == NULL || node->NodeType == NULL)
+		{
+			continue;
+		}
+		RuleProduces[Rule].Add(SymbolIndices[node->NodeType]);
+		bHasOutputRoot |= node->NodeID == 1;
+	}
+	if (!bHasOutputRoot)
+	{
+		return;
+	}
+
+	if (grammar->InputGraph != NULL)
+	{
+		// The pattern's root is what gets matched against the node being replaced
+		for (const UDungeonMakerNode* node : grammar->InputGraph->AllNodes)
+		{
+			if (node == NULL || node->NodeID != 1)
+			{
+				continue;
+			}
+			if (node->NodeType == NULL)
+			{
+				RuleConsumesAnything[Rule] = true;
+			}
+			else if (SymbolIndices.Contains(node->NodeType))
+			{
+				RuleConsumes[Rule].Add(SymbolIndices[node->NodeType]);
+			}
+			RuleCanFire[Rule] = true;
+			break;
+		}
+		return;
+	}
+
+	const UStateMachineState* input = grammar->RuleInput;
+	if (input == NULL)
+	{
+		return;
+	}
+	RuleCanFire[Rule] = true;
+
+	// The first branch taken decides which symbols the node being replaced can have
+	TArray<UStateMachineBranch*> branches = input->InstancedBranches;
+	branches.Append(input->SharedBranches);
+	bool bAnyBranches = false;
+	for (const UStateMachineBranch* branch : branches)
+	{
+		if (branch == NULL || branch->DestinationState == NULL)
+		{
+			continue;
+		}
+		bAnyBranches = true;
+		if (branch->bReverseInputTest)
+		{
+			// Reversed branches also pass on a coupling mismatch, whatever the symbol is
+			RuleConsumesAnything[Rule] = true;
+			continue;
+		}
+		for (UStateMachineSymbol* symbol : branch->AcceptableInputs)
+		{
+			const int32* symbolIndex = SymbolIndices.Find(Cast<UGraphNode>(symbol));
+			if (symbolIndex != NULL)
+			{
+				RuleConsumes[Rule].AddUnique(*symbolIndex);
+			}
+		}
+	}
+
+	if (!bAnyBranches)
+	{
+		// Whether this matches depends only on the state itself
+		RuleConsumesAnything[Rule] = true;
+	}
+}
+
+void FDungeonGrammarAnalysis::FindReachableRules(int32 HeadSymbolIndex)
+{
+	SymbolReachable.SetNumZeroed(Symbols.Num());
+	TArray<int32> toVisit;
+	toVisit.Add(HeadSymbolIndex);
+	SymbolReachable[HeadSymbolIndex] = true;
+
+	while (toVisit.Num() > 0)
+	{
+		int32 symbol = toVisit.Pop(false);
+		for (int32 rule : SymbolRules[symbol])
+		{
+			if (RuleReachable[rule])
+			{
+				continue;
+			}
+			RuleReachable[rule] = true;
+			for (int32 produced : RuleProduces[rule])
+			{
+				if (!SymbolReachable[produced])
+				{
+					SymbolReachable[produced] = true;
+					toVisit.Add(produced);
+				}
+			}
+		}
+	}
+}
+
+void FDungeonGrammarAnalysis::FindComponents()
+{
+	int32 symbolCount = Symbols.Num();
+
+	// Link every symbol to everything that can replace it
+	TArray<TArray<int32>> links;
+	links.SetNum(symbolCount);
+	for (int32 symbol = 0; symbol < symbolCount; symbol++)
+	{
+		for (int32 rule : SymbolRules[symbol])
+		{
+			for (int32 produced : RuleProduces[rule])
+			{
+				if (!IsTerminalSymbol(produced))
+				{
+					links[symbol].AddUnique(produced);
+				}
+			}
+		}
+	}
+
+	SymbolComponent.Init(INVALID_INDEX, symbolCount);
+	TArray<int32> visitIndex;
+	visitIndex.Init(INVALID_INDEX, symbolCount);
+	TArray<int32> lowLink;
+	lowLink.SetNumZeroed(symbolCount);
+	TArray<bool> onStack;
+	onStack.SetNumZeroed(symbolCount);
+	TArray<int32> stack;
+	TArray<bool> componentHasCycle;
+	// Each entry is a symbol, and how many of its links we've followed so far
+	TArray<TPair<int32, int32>> callStack;
+	int32 nextVisitIndex = 0;
+
+	for (int32 root = 0; root < symbolCount; root++)
+	{
+		if (!SymbolReachable[root] || visitIndex[root] != INVALID_INDEX)
+		{
+			continue;
+		}
+
+		visitIndex[root] = lowLink[root] = nextVisitIndex++;
+		stack.Add(root);
+		onStack[root] = true;
+		callStack.Add(TPair<int32, int32>(root, 0));
+
+		while (callStack.Num() > 0)
+		{
+			int32 symbol = callStack.Last().Key;
+			int32& nextLink = callStack.Last().Value;
+			if (nextLink < links[symbol].Num())
+			{
+				int32 next = links[symbol][nextLink++];
+				if (visitIndex[next] == INVALID_INDEX)
+				{
+					visitIndex[next] = lowLink[next] = nextVisitIndex++;
+					stack.Add(next);
+					onStack[next] = true;
+					callStack.Add(TPair<int32, int32>(next, 0));
+				}
+				else if (onStack[next])
+				{
+					lowLink[symbol] = FMath::Min(lowLink[symbol], visitIndex[next]);
+				}
+				continue;
+			}
+
+			// Everything below us has been visited
+			callStack.Pop(false);
+			if (callStack.Num() > 0)
+			{
+				int32 parent = callStack.Last().Key;
+				lowLink[parent] = FMath::Min(lowLink[parent], lowLink[symbol]);
+			}
+
+			if (lowLink[symbol] == visitIndex[symbol])
+			{
+				int32 component = componentHasCycle.Add(false);
+				int32 member;
+				int32 memberCount = 0;
+				do
+				{
+					member = stack.Pop(false);
+					onStack[member] = false;
+					SymbolComponent[member] = component;
+					ComponentOrder.Add(member);
+					memberCount++;
+				} while (member != symbol);
+				componentHasCycle[component] = memberCount > 1 || links[symbol].Contains(symbol);
+			}
+		}
+	}
+
+	// A rule is recursive if something it produces can lead back to what it consumed
+	for (int32 symbol = 0; symbol < symbolCount; symbol++)
+	{
+		if (SymbolComponent[symbol] == INVALID_INDEX || !componentHasCycle[SymbolComponent[symbol]])
+		{
+			continue;
+		}
+		for (int32 rule : SymbolRules[symbol])
+		{
+			for (int32 produced : RuleProduces[rule])
+			{
+				if (SymbolComponent[produced] == SymbolComponent[symbol])
+				{
+					RuleRecursive[rule] = true;
+					bHasCycle = true;
+				}
+			}
+		}
+	}
+}
+
+void FDungeonGrammarAnalysis::FindBounds()
+{
+	// Worst case for a single node with each symbol: how many rewrites it and everything it
+	// turns into can take, and how many nodes it can become.
+	// Components come out with everything they produce first, so each symbol only needs to look back.
+	TArray<int64> rewrites;
+	rewrites.SetNumZeroed(Symbols.Num());
+	TArray<int64> nodes;
+	nodes.Init(1, Symbols.Num());
+
+	for (int32 symbol : ComponentOrder)
+	{
+		for (int32 rule : SymbolRules[symbol])
+		{
+			int64 ruleRewrites = 1;
+			int64 ruleNodes = 0;
+			for (int32 produced : RuleProduces[rule])
+			{
+				ruleRewrites = FMath::Min<int64>(ruleRewrites + rewrites[produced], MAX_int32);
+				ruleNodes = FMath::Min<int64>(ruleNodes + nodes[produced], MAX_int32);
+			}
+			rewrites[symbol] = FMath::Max(rewrites[symbol], ruleRewrites);
+			nodes[symbol] = FMath::Max(nodes[symbol], ruleNodes);
+		}
+	}
+
+	int32 head = SymbolIndices[AnalyzedHeadSymbol];
+	MaxRewriteCount = (int32)rewrites[head];
+	MaxNodeCount = (int32)nodes[head];
+}
+
+int32 FDungeonGrammarAnalysis::GetStepBound() const
+{
+	if (bHasCycle)
+	{
+		return INVALID_INDEX;
+	}
+	// Every step down the mission is either a rewrite or a move to a child,
+	// and a path can't be longer than the whole mission.
+	return (int32)FMath::Min<int64>((int64)MaxRewriteCount + MaxNodeCount + 1, MAX_int32);
+}
+
+void FDungeonGrammarAnalysis::GetReachableGrammars(TArray<const UDungeonMissionGrammar*>& OutGrammars) const
+{
+	OutGrammars.Reset();
+	for (int32 i = 0; i < Rules.Num(); i++)
+	{
+		if (RuleReachable[i])
+		{
+			OutGrammars.Add(Rules[i]);
+		}
+	}
+}
+
+void FDungeonGrammarAnalysis::LogWarnings() const
+{
+	for (int32 i = 0; i < Rules.Num(); i++)
+	{
+		FString name = Rules[i] != NULL ? Rules[i]->GetName() : TEXT("None");
+		if (!RuleCanFire[i])
+		{
+			UE_LOG(LogMissionGen, Warning, TEXT("Grammar %s can never be used; it needs an input and an output graph with a root node."), *name);
+		}
+		else if (!RuleReachable[i])
+		{
+			UE_LOG(LogMissionGen, Warning, TEXT("Grammar %s can't be reached from %s."), *name, *AnalyzedHeadSymbol->Description.ToString());
+		}
+		else if (RuleRecursive[i])
+		{
+			UE_LOG(LogMissionGen, Log, TEXT("Grammar %s can produce a symbol it consumes, so it may keep rewriting until generation runs out of steps."), *name);
+		}
+	}
+
+	if (!bHasCycle && Symbols.Num() > 0)
+	{
+		UE_LOG(LogMissionGen, Log, TEXT("Grammars will finish within %d rewrites, making at most %d nodes."), MaxRewriteCount, MaxNodeCount);
+	}
+}
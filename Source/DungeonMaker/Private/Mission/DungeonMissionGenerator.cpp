@@ -4,6 +4,7 @@
 #include "Runtime/Core/Public/Containers/Queue.h"
 #include "Grammar/Grammar.h"
 #include "DrawDebugHelpers.h"
+#include "Async/ParallelFor.h"
 
 // Sets default values for this component's properties
 UDungeonMissionGenerator::UDungeonMissionGenerator()
@@ -11,6 +12,7 @@ UDungeonMissionGenerator::UDungeonMissionGenerator()
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = false;
+	HeadIndex = FDungeonMissionGraph::INVALID_INDEX;
 
 	/*StartNode = FDungeonNode();
 	StartNode.Symbol = FName(TEXT("Start"));*/
@@ -18,39 +20,64 @@ UDungeonMissionGenerator::UDungeonMissionGenerator()
 
 void UDungeonMissionGenerator::TryToCreateDungeon(FRandomStream& Stream)
 {
-	Head = NewObject<UDungeonMissionNode>();
-	Head->NodeType = HeadSymbol.Symbol;
-	Head->NodeID = HeadSymbol.SymbolID;
-	Head->bTightlyCoupledToParent = false;
+	MissionGraph.Reset();
+	Head = NULL;
+	UnresolvedHooks.Empty();
+	HeadIndex = MissionGraph.AddNode(HeadSymbol.Symbol, HeadSymbol.SymbolID, false);
+	UnresolvedHookIndices.Empty();
 	DungeonSize = 1;
 
-	GrammarUsageCount.Empty();
-	TryToCreateDungeon(Head, Grammars, Stream, 255);
+	if (!GrammarAnalysis.IsBuiltFor(Grammars, HeadSymbol.Symbol))
+	{
+		AnalyzeGrammars();
+	}
 
-	// Relabel all the node IDs with their (hopefully final) IDs
-	int32 currentID = 1;
-	TArray<UDungeonMissionNode*> nodes;
-	nodes.Add(Head);
-	TSet<UDungeonMissionNode*> processed;
-	while (nodes.Num() > 0)
+	ActiveGrammars = Grammars;
+	if (bPruneUnreachableGrammars)
 	{
-		UDungeonMissionNode* current = nodes[0];
-		nodes.RemoveAt(0);
-		if (processed.Contains(current))
+		TArray<const UDungeonMissionGrammar*> reachableGrammars;
+		GrammarAnalysis.GetReachableGrammars(reachableGrammars);
+		if (reachableGrammars.Num() > 0)
 		{
-			continue;
+			ActiveGrammars = reachableGrammars;
 		}
+	}
 
-		current->NodeID = currentID;
-		currentID++;
-		for (UDungeonMakerNode* node : current->ChildrenNodes)
+	// Any output graph which was made at runtime (and so never loaded) needs its ID worked out
+	// before we start counting how often it's used. After this, IDs are only ever read.
+	for (const UDungeonMissionGrammar* grammar : ActiveGrammars)
+	{
+		if (grammar->OutputGraph != NULL && grammar->OutputGraph->GraphID == 0)
 		{
-			nodes.Add((UDungeonMissionNode*)node);
+			grammar->OutputGraph->UpdateGraphID();
 		}
-		processed.Add(current);
+	}
+
+	int32 stepCount = MaxRewriteSteps;
+	if (GrammarAnalysis.GetStepBound() != FDungeonGrammarAnalysis::INVALID_INDEX)
+	{
+		stepCount = FMath::Min(stepCount, GrammarAnalysis.GetStepBound());
+	}
 
-		DungeonSize++;
+	GrammarUsageCount.Empty();
+	if (bRewriteInRounds)
+	{
+		RewriteInRounds(Stream, stepCount);
+	}
+	else
+	{
+		TryToCreateDungeon(HeadIndex, ActiveGrammars, Stream, stepCount);
+	}
+
+	// Relabel all the node IDs with their (hopefully final) IDs
+	MissionAnalysis.Build(MissionGraph);
+	TArray<int32> nodes;
+	MissionAnalysis.GetBreadthFirstOrder(HeadIndex, nodes);
+	for (int32 i = 0; i < nodes.Num(); i++)
+	{
+		MissionGraph.NodeIDs[nodes[i]] = i + 1;
 	}
+	DungeonSize += nodes.Num();
 
 #if !UE_BUILD_SHIPPING
 	UE_LOG(LogMissionGen, Log, TEXT("Completed dungeon:"));
@@ -58,13 +85,38 @@ void UDungeonMissionGenerator::TryToCreateDungeon(FRandomStream& Stream)
 #endif
 }
 
+void UDungeonMissionGenerator::AnalyzeGrammars()
+{
+	GrammarAnalysis.Build(Grammars, HeadSymbol.Symbol);
+#if !UE_BUILD_SHIPPING
+	GrammarAnalysis.LogWarnings();
+#endif
+}
+
+void UDungeonMissionGenerator::MaterializeMission()
+{
+	if (Head != NULL)
+	{
+		// Already made the nodes for this mission
+		return;
+	}
+	TArray<UDungeonMissionNode*> nodes;
+	Head = MissionGraph.Materialize(this, HeadIndex, nodes);
+
+	UnresolvedHooks.Empty(UnresolvedHookIndices.Num());
+	for (int32 hook : UnresolvedHookIndices)
+	{
+		UnresolvedHooks.Add(nodes[hook]);
+	}
+}
+
 void UDungeonMissionGenerator::FindNodeMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars, 
-	UDungeonMissionNode* StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars)
+	int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars)
 {
 	bool bFoundMatches = OutAcceptableGrammars.Num() > 0;
 	FGraphLink us;
-	us.Symbol = StartingLocation->ToGraphSymbol();
-	us.bIsTightlyCoupled = StartingLocation->bTightlyCoupledToParent;
+	us.Symbol = MissionGraph.ToGraphSymbol(StartingLocation);
+	us.bIsTightlyCoupled = MissionGraph.TightlyCoupled[StartingLocation];
 
 	// We're only checking if us by ourselves is valid, so the array just needs to contain us.
 	TArray<FGraphLink> links;
@@ -76,26 +128,28 @@ void UDungeonMissionGenerator::FindNodeMatches(TArray<const UDungeonMissionGramm
 }
 
 void UDungeonMissionGenerator::FindMatchesWithChildren(TArray<const UDungeonMissionGrammar*>& AllowedGrammars, 
-	UDungeonMissionNode* StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars)
+	int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars)
 {
 	// We have children; we should check to see if we have a grammar which accepts us and our children
 	// Define us first
 	FGraphLink us;
-	us.Symbol = StartingLocation->ToGraphSymbol();
-	us.bIsTightlyCoupled = StartingLocation->bTightlyCoupledToParent;
+	us.Symbol = MissionGraph.ToGraphSymbol(StartingLocation);
+	us.bIsTightlyCoupled = MissionGraph.TightlyCoupled[StartingLocation];
 
 	UE_LOG(LogMissionGen, Log, TEXT("Trying to match childen of %s!"), *us.Symbol.GetSymbolDescription());
 
 	// Iterate over each child
-	for (UDungeonMakerNode* nextNode : StartingLocation->ChildrenNodes)
+	for (int32 edge = MissionGraph.FirstChildEdge(StartingLocation); edge != FDungeonMissionGraph::INVALID_INDEX; edge = MissionGraph.NextChildEdge(edge))
 	{
+		int32 nextNode = MissionGraph.GetEdgeChild(edge);
+
 		// Add ourselves to the array
 		TArray<FGraphLink> links;
 		links.Add(us);
 
 		FGraphLink next;
-		next.Symbol = nextNode->ToGraphSymbol();
-		next.bIsTightlyCoupled = nextNode->bTightlyCoupledToParent;
+		next.Symbol = MissionGraph.ToGraphSymbol(nextNode);
+		next.bIsTightlyCoupled = MissionGraph.TightlyCoupled[nextNode];
 
 		links.Add(next);
 
@@ -107,19 +161,83 @@ void UDungeonMissionGenerator::FindMatchesWithChildren(TArray<const UDungeonMiss
 #if !UE_BUILD_SHIPPING
 	if (OutAcceptableGrammars.Num() == 0)
 	{
-		UE_LOG(LogMissionGen, Warning, TEXT("No symbols matched any child combination of %s."), *StartingLocation->GetSymbolDescription());
+		UE_LOG(LogMissionGen, Warning, TEXT("No symbols matched any child combination of %s."), *MissionGraph.GetSymbolDescription(StartingLocation));
 	}
 #endif
 }
 
+void UDungeonMissionGenerator::FindPatternMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
+	int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars)
+{
+	TArray<TArray<int32>> matches;
+	for (const UDungeonMissionGrammar* grammar : AllowedGrammars)
+	{
+		if (grammar->InputGraph == NULL || grammar->OutputGraph == NULL)
+		{
+			continue;
+		}
+
+		const FDungeonMissionPattern& pattern = GetInputPattern(grammar->InputGraph);
+		matches.Reset();
+		if (FDungeonMissionPatternMatcher::FindMatches(pattern, MissionGraph, StartingLocation, matches) == 0)
+		{
+			continue;
+		}
+
+		UDungeonMakerGraph* graph = grammar->OutputGraph;
+		UE_LOG(LogMissionGen, Log, TEXT("Found %d matches for %s starting from %s."), matches.Num(), *grammar->InputGraph->GetName(), *MissionGraph.GetSymbolDescription(StartingLocation));
+
+		// Make us less likely to be chosen if we've been chosen a lot before
+		float weightModifier = 1.0f;
+		const int32* usageCount = GrammarUsageCount.Find(graph->GetGraphID());
+		if (usageCount != NULL)
+		{
+			weightModifier /= *usageCount;
+		}
+
+		for (const TArray<int32>& match : matches)
+		{
+			FGraphOutput replaceResult;
+			replaceResult.Graph = graph;
+			replaceResult.Weight = grammar->Weight * weightModifier;
+			for (int32 i = 0; i < match.Num(); i++)
+			{
+				replaceResult.MatchedNodes.Add(pattern.NodeIDs[i], match[i]);
+
+				FGraphLink link;
+				link.Symbol = MissionGraph.ToGraphSymbol(match[i]);
+				link.bIsTightlyCoupled = MissionGraph.TightlyCoupled[match[i]];
+				replaceResult.MatchedLinks.Add(link);
+			}
+			OutAcceptableGrammars.Add(replaceResult);
+		}
+	}
+}
+
+const FDungeonMissionPattern& UDungeonMissionGenerator::GetInputPattern(const UDungeonMakerGraph* InputGraph)
+{
+	FDungeonMissionPattern* pattern = InputPatterns.Find(InputGraph);
+	if (pattern == NULL)
+	{
+		pattern = &InputPatterns.Add(InputGraph);
+		pattern->Compile(InputGraph);
+	}
+	return *pattern;
+}
+
 void UDungeonMissionGenerator::CheckGrammarMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
-	const TArray<FGraphLink>& Links, UDungeonMissionNode* StartingLocation, bool bFoundMatches, 
+	const TArray<FGraphLink>& Links, int32 StartingLocation, bool bFoundMatches, 
 	TArray<FGraphOutput>& OutAcceptableGrammars)
 {
 	for (int i = 0; i < AllowedGrammars.Num(); i++)
 	{
 		// Iterate over all grammars
 		const UDungeonMissionGrammar* grammar = AllowedGrammars[i];
+		if (grammar->InputGraph != NULL)
+		{
+			// Matched by FindPatternMatches instead
+			continue;
+		}
 
 		EGrammarResultType resultType = grammar->MatchesGrammar(this, Links);
 		if (resultType == EGrammarResultType::Accepted)
@@ -148,10 +266,10 @@ void UDungeonMissionGenerator::CheckGrammarMatches(TArray<const UDungeonMissionG
 #endif
 			// Make us less likely to be chosen if we've been chosen a lot before
 			float weightModifier = 1.0f;
-			FString outputString = graph->ToString();
-			if (GrammarUsageCount.Contains(outputString))
+			const int32* usageCount = GrammarUsageCount.Find(graph->GetGraphID());
+			if (usageCount != NULL)
 			{
-				weightModifier /= GrammarUsageCount[outputString];
+				weightModifier /= *usageCount;
 			}
 			if (bFoundMatches)
 			{
@@ -170,34 +288,33 @@ void UDungeonMissionGenerator::CheckGrammarMatches(TArray<const UDungeonMissionG
 
 void UDungeonMissionGenerator::DrawDebugDungeon()
 {
-	check(Head != NULL && Head->NodeType != NULL);
-	int32 dungeonDepth = Head->GetLevelCount();
-	TMap<UDungeonMakerNode*, FIntVector> dungeonCoords;
+	check(MissionGraph.IsValidNode(HeadIndex) && MissionGraph.NodeTypes[HeadIndex] != NULL);
+	int32 dungeonDepth = MissionAnalysis.GetLevelCount(HeadIndex);
+	TMap<int32, FIntVector> dungeonCoords;
 	int xOffset = 0;
 	int yOffset = 0;
 
-	TArray<TArray<UDungeonMissionNode*>> allNodes;
+	TArray<TArray<int32>> allNodes;
 	allNodes.AddDefaulted(dungeonDepth);
-	TArray<UDungeonMissionNode*> startNodes;
-	startNodes.Add(Head);
-	allNodes[0] = startNodes;
+	allNodes[0].Add(HeadIndex);
 
-	TQueue<UDungeonMissionNode*> nodesToDraw;
+	TQueue<int32> nodesToDraw;
 	
 	for (int j = 0; j < allNodes.Num(); j++)
 	{
 		for (int k = 0; k < allNodes[j].Num(); k++)
 		{
-			UDungeonMissionNode* next = allNodes[j][k];
+			int32 next = allNodes[j][k];
 			nodesToDraw.Enqueue(next);
 			dungeonCoords.Add(next, FIntVector(xOffset + k, yOffset, 0));
-			for (UDungeonMakerNode* node : next->ChildrenNodes)
+			for (int32 edge = MissionGraph.FirstChildEdge(next); edge != FDungeonMissionGraph::INVALID_INDEX; edge = MissionGraph.NextChildEdge(edge))
 			{
-				int32 nodesBelow = ((UDungeonMissionNode*)node)->GetLevelCount();
+				int32 node = MissionGraph.GetEdgeChild(edge);
+				int32 nodesBelow = MissionAnalysis.GetLevelCount(node);
 				if (nodesBelow <= 1)
 				{
 					// Send to the bottom
-					nodesToDraw.Enqueue((UDungeonMissionNode*)node);
+					nodesToDraw.Enqueue(node);
 					dungeonCoords.Add(node, FIntVector(xOffset + k, dungeonDepth - 1, 0));
 					// Increment the x offset; the bottom of this one is already accounted for
 					xOffset++;
@@ -206,7 +323,7 @@ void UDungeonMissionGenerator::DrawDebugDungeon()
 
 				// Otherwise, our child has child nodes
 				// This will never overflow because we already know how many children have child nodes
-				allNodes[j + 1].Add((UDungeonMissionNode*)node);
+				allNodes[j + 1].Add(node);
 			}
 		}
 		yOffset++;
@@ -214,20 +331,21 @@ void UDungeonMissionGenerator::DrawDebugDungeon()
 
 	while (!nodesToDraw.IsEmpty())
 	{
-		UDungeonMissionNode* next;
+		int32 next;
 		nodesToDraw.Dequeue(next);
 
 		FIntVector nodeLocation = dungeonCoords[next];
 		FVector drawLocation = FVector(nodeLocation.X * 100.0f, nodeLocation.Y * 100.0f, 0.0f);
 
 		DrawDebugSphere(GetWorld(), drawLocation, 15.0f, 8, FColor(255, 0, 255), true);
-		DrawDebugString(GetWorld(), drawLocation + FVector(0.0f, 0.0f, 100.0f), next->GetSymbolDescription());
-		for (UDungeonMakerNode* node : next->ChildrenNodes)
+		DrawDebugString(GetWorld(), drawLocation + FVector(0.0f, 0.0f, 100.0f), MissionGraph.GetSymbolDescription(next));
+		for (int32 edge = MissionGraph.FirstChildEdge(next); edge != FDungeonMissionGraph::INVALID_INDEX; edge = MissionGraph.NextChildEdge(edge))
 		{
+			int32 node = MissionGraph.GetEdgeChild(edge);
 			FIntVector childLocation = dungeonCoords[node];
 			FVector drawChildLocation = FVector(childLocation.X * 100.0f, childLocation.Y * 100.0f, 0.0f);
 			FColor lineColor;
-			if (node->bTightlyCoupledToParent)
+			if (MissionGraph.TightlyCoupled[node])
 			{
 				lineColor = FColor(0, 0, 255);
 			}
@@ -242,42 +360,37 @@ void UDungeonMissionGenerator::DrawDebugDungeon()
 
 void UDungeonMissionGenerator::PrintDebugDungeon()
 {
-	check(Head != NULL && Head->NodeType != NULL);
-	UE_LOG(LogMissionGen, Log, TEXT("%s"), *Head->ToString(0));
+	check(MissionGraph.IsValidNode(HeadIndex) && MissionGraph.NodeTypes[HeadIndex] != NULL);
+	UE_LOG(LogMissionGen, Log, TEXT("%s"), *MissionGraph.ToString(HeadIndex));
 }
 
-void UDungeonMissionGenerator::TryToCreateDungeon(UDungeonMissionNode* StartingLocation, 
+void UDungeonMissionGenerator::TryToCreateDungeon(int32 StartingLocation, 
 	TArray<const UDungeonMissionGrammar*> AllowedGrammars, FRandomStream& Rng, int32 RemainingMaxStepCount)
 {
-	checkf(StartingLocation != NULL, TEXT("Starting node for dungeon generation was null!"));
-	checkf(StartingLocation->IsValidLowLevel(), TEXT("Starting node for dungeon generation was invalid!"));
-	checkf(StartingLocation->NodeType != NULL, TEXT("Starting node for dungeon generation had no symbols!"));
+	checkf(MissionGraph.IsValidNode(StartingLocation), TEXT("Starting node for dungeon generation was invalid!"));
+	checkf(MissionGraph.NodeTypes[StartingLocation] != NULL, TEXT("Starting node for dungeon generation had no symbols!"));
 	checkf(AllowedGrammars.Num() > 0, TEXT("There were no allowed grammars for dungeon generation!"));
 	checkf(RemainingMaxStepCount >= 0, TEXT("Dungeon generation ran out of steps! You have an overflow issue."));
 
-	if (StartingLocation->NodeType->bIsTerminalNode)
+	TArray<int32> children;
+	if (MissionGraph.IsTerminal(StartingLocation))
 	{
 		// This node has already been processed completely and turned into a terminal node
-		for (UDungeonMakerNode* node : StartingLocation->ChildrenNodes)
+		MissionGraph.GetChildren(StartingLocation, children);
+		for (int32 node : children)
 		{
 			// Try and process each child
-			TryToCreateDungeon((UDungeonMissionNode*)node, AllowedGrammars, Rng, RemainingMaxStepCount - 1);
+			TryToCreateDungeon(node, AllowedGrammars, Rng, RemainingMaxStepCount - 1);
 		}
 		return;
 	}
 
-	UE_LOG(LogMissionGen, Log, TEXT("Trying to create a dungeon starting from %s."), *StartingLocation->GetSymbolDescription());
+	UE_LOG(LogMissionGen, Log, TEXT("Trying to create a dungeon starting from %s."), *MissionGraph.GetSymbolDescription(StartingLocation));
 
 	TArray<FGraphOutput> acceptableGrammars;
-	if (StartingLocation->ChildrenNodes.Num() > 0)
-	{
-		FindMatchesWithChildren(AllowedGrammars, StartingLocation, acceptableGrammars);
-	}
-
-	// Try to see if we have a grammar that accepts only us
-	FindNodeMatches(AllowedGrammars, StartingLocation, acceptableGrammars);
+	FindAllMatches(AllowedGrammars, StartingLocation, acceptableGrammars);
 
-	UE_LOG(LogMissionGen, Log, TEXT("Found %d acceptable grammars for %s."), acceptableGrammars.Num(), *StartingLocation->GetSymbolDescription());
+	UE_LOG(LogMissionGen, Log, TEXT("Found %d acceptable grammars for %s."), acceptableGrammars.Num(), *MissionGraph.GetSymbolDescription(StartingLocation));
 
 	// Replace and look again
 	if (acceptableGrammars.Num() > 0)
@@ -288,85 +401,259 @@ void UDungeonMissionGenerator::TryToCreateDungeon(UDungeonMissionNode* StartingL
 	else
 	{
 		// No matching grammars; turn into a hook
-		UE_LOG(LogMissionGen, Error, TEXT("%s had no matching grammars."), *StartingLocation->GetSymbolDescription());
-		UnresolvedHooks.Add(StartingLocation);
-		for (UDungeonMakerNode* node : StartingLocation->ChildrenNodes)
+		UE_LOG(LogMissionGen, Error, TEXT("%s had no matching grammars."), *MissionGraph.GetSymbolDescription(StartingLocation));
+		UnresolvedHookIndices.Add(StartingLocation);
+		MissionGraph.GetChildren(StartingLocation, children);
+		for (int32 node : children)
 		{
 			// Try and process each child
-			TryToCreateDungeon((UDungeonMissionNode*)node, AllowedGrammars, Rng, RemainingMaxStepCount - 1);
+			TryToCreateDungeon(node, AllowedGrammars, Rng, RemainingMaxStepCount - 1);
 		}
 	}
 }
 
-void UDungeonMissionGenerator::ReplaceDungeonNodes(UDungeonMissionNode* StartingLocation, 
+void UDungeonMissionGenerator::ReplaceDungeonNodes(int32 StartingLocation, 
 	TArray<FGraphOutput> AcceptableGrammars, FRandomStream& Rng)
 {
 	checkf(AcceptableGrammars.Num() > 0, TEXT("There weren't any accepted grammars!"));
-	int32 index = Rng.RandRange(0, AcceptableGrammars.Num() - 1);
-	FGraphOutput grammarReplaceResult = AcceptableGrammars[index];
-	if (grammarReplaceResult.Weight <= 0.0f)
-	{
-		AcceptableGrammars.RemoveAt(index);
-		ReplaceDungeonNodes(StartingLocation, AcceptableGrammars, Rng);
-		return;
-	}
-	else if(AcceptableGrammars.Num() > 1)
+	FGraphOutput grammarReplaceResult;
+	bool bChoseReplacement = ChooseReplacement(AcceptableGrammars, Rng, grammarReplaceResult);
+	checkf(bChoseReplacement, TEXT("None of the accepted grammars had a weight above 0!"));
+
+	GrammarUsageCount.FindOrAdd(grammarReplaceResult.Graph->GetGraphID()) += 1;
+
+	// Actually do the replacement
+	ReplaceNodes(StartingLocation, grammarReplaceResult);
+}
+
+bool UDungeonMissionGenerator::ChooseReplacement(TArray<FGraphOutput> AcceptableGrammars, FRandomStream& Rng, 
+	FGraphOutput& OutReplacement) const
+{
+	while (AcceptableGrammars.Num() > 0)
 	{
-		// Higher weights are more likely to be kept
-		float replaceChance = 1.0f / (grammarReplaceResult.Weight + 1);
-		float rngAmount = Rng.GetFraction();
-		if (rngAmount < replaceChance)
+		int32 index = Rng.RandRange(0, AcceptableGrammars.Num() - 1);
+		const FGraphOutput& grammarReplaceResult = AcceptableGrammars[index];
+		if (grammarReplaceResult.Weight <= 0.0f)
 		{
-			// Toss it back and get a new one
-			ReplaceDungeonNodes(StartingLocation, AcceptableGrammars, Rng);
-			return;
+			AcceptableGrammars.RemoveAt(index);
+			continue;
 		}
+		else if (AcceptableGrammars.Num() > 1)
+		{
+			// Higher weights are more likely to be kept
+			float replaceChance = 1.0f / (grammarReplaceResult.Weight + 1);
+			float rngAmount = Rng.GetFraction();
+			if (rngAmount < replaceChance)
+			{
+				// Toss it back and get a new one
+				continue;
+			}
+		}
+
+		OutReplacement = grammarReplaceResult;
+		return true;
 	}
+	return false;
+}
+
+void UDungeonMissionGenerator::FindAllMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
+	int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars)
+{
+	// Grammars with input graphs can match any number of nodes at once, so check them first
+	FindPatternMatches(AllowedGrammars, StartingLocation, OutAcceptableGrammars);
 
-	FString grammarString = grammarReplaceResult.Graph->ToString();
-	if (GrammarUsageCount.Contains(grammarString))
+	if (MissionGraph.GetChildCount(StartingLocation) > 0)
 	{
-		GrammarUsageCount[grammarString] += 1;
+		FindMatchesWithChildren(AllowedGrammars, StartingLocation, OutAcceptableGrammars);
 	}
-	else
+
+	// Try to see if we have a grammar that accepts only us
+	FindNodeMatches(AllowedGrammars, StartingLocation, OutAcceptableGrammars);
+}
+
+void UDungeonMissionGenerator::ResolveMatchedNodes(int32 StartingLocation, FGraphOutput& Replacement, 
+	TArray<int32>& OutNodes) const
+{
+	OutNodes.Reset();
+	if (Replacement.MatchedNodes.Num() > 0)
 	{
-		GrammarUsageCount.Add(grammarString, 1);
+		Replacement.MatchedNodes.GenerateValueArray(OutNodes);
+		return;
 	}
 
-	// Actually do the replacement
-	ReplaceNodes(StartingLocation, grammarReplaceResult);
+	OutNodes.Add(StartingLocation);
+	if (Replacement.MatchedLinks.Num() > 1)
+	{
+		// This is the same lookup ReplaceNodes does
+		Replacement.MatchedChild = MissionGraph.FindChildFromSymbol(StartingLocation, Replacement.MatchedLinks[1].Symbol);
+		if (Replacement.MatchedChild != FDungeonMissionGraph::INVALID_INDEX)
+		{
+			OutNodes.Add(Replacement.MatchedChild);
+		}
+	}
 }
 
-void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocation, 
-	const FGraphOutput& GrammarReplaceResult)
+void UDungeonMissionGenerator::RewriteInRounds(FRandomStream& Rng, int32 MaxRounds)
 {
-	// Find the matched nodes
-	UDungeonMissionNode* startLocation = StartingLocation;
-	UDungeonMissionNode* replaceLocation = NULL;
-	if (GrammarReplaceResult.MatchedLinks.Num() > 1)
+	// Compile all our input graphs now, since worker threads can't add to the cache
+	for (const UDungeonMissionGrammar* grammar : ActiveGrammars)
 	{
-		replaceLocation = (UDungeonMissionNode*)StartingLocation->FindChildNodeFromSymbol(GrammarReplaceResult.MatchedLinks[1].Symbol);
+		if (grammar->InputGraph != NULL)
+		{
+			GetInputPattern(grammar->InputGraph);
+		}
 	}
 
-	// Number the nodes
-	startLocation->NodeID = 1;
-	if (replaceLocation != NULL)
+	TSet<int32> hooks;
+	TArray<int32> frontier;
+	TArray<FGraphOutput> replacements;
+	TArray<bool> foundReplacement;
+	TArray<bool> claimed;
+	TArray<int32> matchedNodes;
+	TArray<int32> toReplace;
+
+	for (int32 round = 0; round < MaxRounds; round++)
 	{
-		replaceLocation->NodeID = 2;
+		// Every node which still needs replacing
+		frontier.Reset();
+		for (int32 i = 0; i < MissionGraph.Num(); i++)
+		{
+			if (MissionGraph.NodeTypes[i] != NULL && !MissionGraph.IsTerminal(i) && !hooks.Contains(i))
+			{
+				frontier.Add(i);
+			}
+		}
+		if (frontier.Num() == 0)
+		{
+			break;
+		}
+
+		UE_LOG(LogMissionGen, Log, TEXT("Rewrite round %d: %d nodes to replace."), round, frontier.Num());
+
+		// Find and pick a replacement for every node at once.
+		// Each node gets its own random stream, so it doesn't matter which thread handles it.
+		int32 roundSeed = Rng.GetUnsignedInt();
+		replacements.Reset();
+		replacements.SetNum(frontier.Num());
+		foundReplacement.Reset();
+		foundReplacement.SetNumZeroed(frontier.Num());
+		ParallelFor(frontier.Num(), [&](int32 Index)
+		{
+			int32 node = frontier[Index];
+			TArray<FGraphOutput> acceptableGrammars;
+			FindAllMatches(ActiveGrammars, node, acceptableGrammars);
+			if (acceptableGrammars.Num() == 0)
+			{
+				return;
+			}
+			FRandomStream nodeRng(HashCombine(roundSeed, GetTypeHash(node)));
+			foundReplacement[Index] = ChooseReplacement(acceptableGrammars, nodeRng, replacements[Index]);
+		});
+
+		// Keep every replacement that doesn't touch a node some earlier replacement is using
+		claimed.Reset();
+		claimed.SetNumZeroed(MissionGraph.Num());
+		toReplace.Reset();
+		for (int32 i = 0; i < frontier.Num(); i++)
+		{
+			if (!foundReplacement[i])
+			{
+				// No matching grammars; turn into a hook
+				UE_LOG(LogMissionGen, Error, TEXT("%s had no matching grammars."), *MissionGraph.GetSymbolDescription(frontier[i]));
+				UnresolvedHookIndices.Add(frontier[i]);
+				hooks.Add(frontier[i]);
+				continue;
+			}
+
+			ResolveMatchedNodes(frontier[i], replacements[i], matchedNodes);
+			bool bOverlaps = false;
+			for (int32 node : matchedNodes)
+			{
+				bOverlaps |= claimed[node];
+			}
+			if (bOverlaps)
+			{
+				// Try again next round
+				continue;
+			}
+
+			for (int32 node : matchedNodes)
+			{
+				claimed[node] = true;
+			}
+			toReplace.Add(i);
+		}
+
+		if (toReplace.Num() == 0)
+		{
+			break;
+		}
+
+		// The replacements don't overlap, so they can be made one after another
+		for (int32 i : toReplace)
+		{
+			GrammarUsageCount.FindOrAdd(replacements[i].Graph->GetGraphID()) += 1;
+			ReplaceNodes(frontier[i], replacements[i]);
+		}
 	}
+}
+
+void UDungeonMissionGenerator::ReplaceNodes(int32 StartingLocation, 
+	const FGraphOutput& GrammarReplaceResult)
+{
+	const int32 INVALID_INDEX = FDungeonMissionGraph::INVALID_INDEX;
+
+	// Find the matched nodes
+	int32 startLocation = StartingLocation;
+	int32 replaceLocation = INVALID_INDEX;
+	bool bMatchedPattern = GrammarReplaceResult.MatchedNodes.Num() > 0;
+	TMap<int32, int32> nodeMap;
+	FString initialShape;
 
-	FString initialShape = startLocation->GetSymbolDescription();
-	if (replaceLocation != NULL)
+	if (bMatchedPattern)
 	{
-		initialShape.Append("->");
-		initialShape.Append(replaceLocation->GetSymbolDescription());
+		// Our input graph already told us which node is which
+		nodeMap = GrammarReplaceResult.MatchedNodes;
+		for (const TPair<int32, int32>& match : GrammarReplaceResult.MatchedNodes)
+		{
+			MissionGraph.NodeIDs[match.Value] = match.Key;
+			if (!initialShape.IsEmpty())
+			{
+				initialShape.Append(", ");
+			}
+			initialShape.Append(MissionGraph.GetSymbolDescription(match.Value));
+		}
 	}
-
-	TMap<int32, UDungeonMissionNode*> nodeMap;
-	nodeMap.Add(1, startLocation);
-	if (replaceLocation != NULL)
+	else
 	{
-		nodeMap.Add(2, replaceLocation);
+		if (GrammarReplaceResult.MatchedChild != INVALID_INDEX)
+		{
+			replaceLocation = GrammarReplaceResult.MatchedChild;
+		}
+		else if (GrammarReplaceResult.MatchedLinks.Num() > 1)
+		{
+			replaceLocation = MissionGraph.FindChildFromSymbol(StartingLocation, GrammarReplaceResult.MatchedLinks[1].Symbol);
+		}
+
+		// Number the nodes
+		MissionGraph.NodeIDs[startLocation] = 1;
+		if (replaceLocation != INVALID_INDEX)
+		{
+			MissionGraph.NodeIDs[replaceLocation] = 2;
+		}
+
+		initialShape = MissionGraph.GetSymbolDescription(startLocation);
+		if (replaceLocation != INVALID_INDEX)
+		{
+			initialShape.Append("->");
+			initialShape.Append(MissionGraph.GetSymbolDescription(replaceLocation));
+		}
+
+		nodeMap.Add(1, startLocation);
+		if (replaceLocation != INVALID_INDEX)
+		{
+			nodeMap.Add(2, replaceLocation);
+		}
 	}
 
 	// Break their parent-child link
@@ -379,7 +666,10 @@ void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocatio
 
 	graph->UpdateIDs();
 
-	FString grammarChain = graph->ToString();
+	FString grammarChain;
+#if !UE_BUILD_SHIPPING
+	grammarChain = graph->ToString();
+#endif
 	UE_LOG(LogMissionGen, Log, TEXT("Replacing %s with %s (Total Length: %d)."), *initialShape, *grammarChain, graph->Num());
 
 	TArray<UDungeonMakerNode*> toProcess;
@@ -395,21 +685,35 @@ void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocatio
 		return;
 	}
 
-	if (!startLocation->NodeType->bIsTerminalNode)
+	if (!MissionGraph.IsTerminal(startLocation))
 	{
-		startLocation->NodeType = head->NodeType;
+		MissionGraph.NodeTypes[startLocation] = head->NodeType;
 	}
 
-	if (graph->Num() == 2 && replaceLocation != NULL)
+	if (!bMatchedPattern && graph->Num() == 2 && replaceLocation != INVALID_INDEX)
 	{
-		replaceLocation->NodeType = graph->AllNodes[1]->NodeType;
-		replaceLocation->bTightlyCoupledToParent = graph->AllNodes[1]->bTightlyCoupledToParent;
+		MissionGraph.NodeTypes[replaceLocation] = graph->AllNodes[1]->NodeType;
+		MissionGraph.TightlyCoupled[replaceLocation] = graph->AllNodes[1]->bTightlyCoupledToParent;
 	}
-	else if(graph->Num() > 2)
+	else if(bMatchedPattern || graph->Num() > 2)
 	{
-		if (replaceLocation != NULL)
+		if (bMatchedPattern)
 		{
-			startLocation->BreakLinkWithNode(replaceLocation);
+			// The output graph decides how all the matched nodes link together
+			for (const TPair<int32, int32>& from : GrammarReplaceResult.MatchedNodes)
+			{
+				for (const TPair<int32, int32>& to : GrammarReplaceResult.MatchedNodes)
+				{
+					if (MissionGraph.HasLink(from.Value, to.Value))
+					{
+						MissionGraph.BreakLink(from.Value, to.Value);
+					}
+				}
+			}
+		}
+		else if (replaceLocation != INVALID_INDEX)
+		{
+			MissionGraph.BreakLink(startLocation, replaceLocation);
 		}
 
 		toProcess.Add(head);
@@ -430,10 +734,10 @@ void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocatio
 
 			// It is assumed that the from node is already in the map
 			// It is also assumed that the from node has already replaced its symbol
-			UDungeonMissionNode* fromNode = nodeMap[fromSymbol.SymbolID];
+			int32 fromNode = nodeMap[fromSymbol.SymbolID];
 
-			TArray<UDungeonMakerNode*> children = node->ChildrenNodes;
-			UE_LOG(LogMissionGen, Log, TEXT("Processing %s, with %d children."), *fromNode->ToString(0, false), children.Num());
+			const TArray<UDungeonMakerNode*>& children = node->ChildrenNodes;
+			UE_LOG(LogMissionGen, Log, TEXT("Processing %s, with %d children."), *MissionGraph.ToString(fromNode, 0, false), children.Num());
 
 			for (int i = 0; i < children.Num(); i++)
 			{
@@ -445,7 +749,7 @@ void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocatio
 				}
 
 				// Create nodes for all children of this node
-				UDungeonMissionNode* toNode;
+				int32 toNode;
 				FNumberedGraphSymbol childSymbol = child->ToGraphSymbol();
 				if (nodeMap.Contains(childSymbol.SymbolID))
 				{
@@ -454,16 +758,16 @@ void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocatio
 				else
 				{
 					// Create a new node
-					toNode = NewObject<UDungeonMissionNode>();
+					toNode = MissionGraph.AddNode(NULL, 0, false);
 				}
 				// Change the symbol on the node
-				if (toNode->NodeType == NULL || !toNode->NodeType->bIsTerminalNode)
+				if (!MissionGraph.IsTerminal(toNode))
 				{
-					toNode->NodeType = childSymbol.Symbol;
-					toNode->NodeID = childSymbol.SymbolID;
+					MissionGraph.NodeTypes[toNode] = childSymbol.Symbol;
+					MissionGraph.NodeIDs[toNode] = childSymbol.SymbolID;
 				}
 
-				fromNode->AddLinkToNode(toNode, child->bTightlyCoupledToParent);
+				MissionGraph.AddLink(fromNode, toNode, child->bTightlyCoupledToParent);
 
 				// Update the node lookup
 				nodeMap.Add(child->NodeID, toNode);
@@ -472,36 +776,25 @@ void UDungeonMissionGenerator::ReplaceNodes(UDungeonMissionNode* StartingLocatio
 			}
 		}
 
-		if (replaceLocation != NULL && nodeMap.Contains(2))
+		if (replaceLocation != INVALID_INDEX && nodeMap.Contains(2))
 		{
 			if (nodeMap[2] != replaceLocation)
 			{
-				nodeMap[2]->AddLinkToNode(replaceLocation, replaceLocation->bTightlyCoupledToParent);
+				MissionGraph.AddLink(nodeMap[2], replaceLocation, MissionGraph.TightlyCoupled[replaceLocation]);
 			}
 		}
-	}
-	// Relabel all the nodes with their new IDs
-	/*int32 currentID = 1;
-	TArray<UDungeonMissionNode*> nodes;
-	nodes.Add(Head);
-	TSet<UDungeonMissionNode*> processed;
-	while (nodes.Num() > 0)
-	{
-		UDungeonMissionNode* current = nodes[0];
-		nodes.RemoveAt(0);
-		if (processed.Contains(current))
-		{
-			continue;
-		}
 
-		current->Symbol.SymbolID = currentID;
-		currentID++;
-		for (FMissionNodeData& node : current->NextNodes)
+		// Don't lose any matched nodes that the output graph left out
+		for (const TPair<int32, int32>& match : GrammarReplaceResult.MatchedNodes)
 		{
-			nodes.Add(node.Node);
+			if (match.Value != startLocation && match.Value != HeadIndex && MissionGraph.GetParentCount(match.Value) == 0)
+			{
+				UE_LOG(LogMissionGen, Warning, TEXT("%s was matched, but isn't in the output graph. Attaching it to %s."),
+					*MissionGraph.GetSymbolDescription(match.Value), *MissionGraph.GetSymbolDescription(startLocation));
+				MissionGraph.AddLink(startLocation, match.Value, MissionGraph.TightlyCoupled[match.Value]);
+			}
 		}
-		processed.Add(current);
-	}*/
+	}
 
 #if !UE_BUILD_SHIPPING
 	UE_LOG(LogMissionGen, Log, TEXT("Dungeon after replacement:"));
@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonMissionGraph.h"
+#include "DungeonMissionNode.h"
+
+void FDungeonMissionGraph::Reset(int32 ExpectedNodeCount)
+{
+	NodeTypes.Reset(ExpectedNodeCount);
+	NodeIDs.Reset(ExpectedNodeCount);
+	TightlyCoupled.Reset(ExpectedNodeCount);
+
+	FirstOutEdge.Reset(ExpectedNodeCount);
+	LastOutEdge.Reset(ExpectedNodeCount);
+	FirstInEdge.Reset(ExpectedNodeCount);
+	LastInEdge.Reset(ExpectedNodeCount);
+	OutDegree.Reset(ExpectedNodeCount);
+	InDegree.Reset(ExpectedNodeCount);
+
+	EdgeFrom.Reset(ExpectedNodeCount);
+	EdgeTo.Reset(ExpectedNodeCount);
+	NextOutEdge.Reset(ExpectedNodeCount);
+	PrevOutEdge.Reset(ExpectedNodeCount);
+	NextInEdge.Reset(ExpectedNodeCount);
+	PrevInEdge.Reset(ExpectedNodeCount);
+	FreeEdges.Reset();
+}
+
+int32 FDungeonMissionGraph::AddNode(UGraphNode* Symbol, int32 NodeID, bool bTightlyCoupledToParent)
+{
+	int32 index = NodeTypes.Add(Symbol);
+	NodeIDs.Add(NodeID);
+	TightlyCoupled.Add(bTightlyCoupledToParent);
+
+	FirstOutEdge.Add(INVALID_INDEX);
+	LastOutEdge.Add(INVALID_INDEX);
+	FirstInEdge.Add(INVALID_INDEX);
+	LastInEdge.Add(INVALID_INDEX);
+	OutDegree.Add(0);
+	InDegree.Add(0);
+	return index;
+}
+
+void FDungeonMissionGraph::AddLink(int32 Parent, int32 Child, bool bTightlyCoupled)
+{
+	check(IsValidNode(Parent) && IsValidNode(Child));
+	if (FindEdge(Parent, Child) != INVALID_INDEX)
+	{
+		// Already linked
+		return;
+	}
+
+	// Every new parent decides our coupling, so the last one linked wins
+	TightlyCoupled[Child] = bTightlyCoupled;
+
+	int32 edge;
+	if (FreeEdges.Num() > 0)
+	{
+		edge = FreeEdges.Pop(false);
+	}
+	else
+	{
+		edge = EdgeFrom.AddUninitialized();
+		EdgeTo.AddUninitialized();
+		NextOutEdge.AddUninitialized();
+		PrevOutEdge.AddUninitialized();
+		NextInEdge.AddUninitialized();
+		PrevInEdge.AddUninitialized();
+	}
+	EdgeFrom[edge] = Parent;
+	EdgeTo[edge] = Child;
+
+	// Append to the end of the parent's child list
+	NextOutEdge[edge] = INVALID_INDEX;
+	PrevOutEdge[edge] = LastOutEdge[Parent];
+	if (LastOutEdge[Parent] != INVALID_INDEX)
+	{
+		NextOutEdge[LastOutEdge[Parent]] = edge;
+	}
+	else
+	{
+		FirstOutEdge[Parent] = edge;
+	}
+	LastOutEdge[Parent] = edge;
+	OutDegree[Parent]++;
+
+	// Append to the end of the child's parent list
+	NextInEdge[edge] = INVALID_INDEX;
+	PrevInEdge[edge] = LastInEdge[Child];
+	if (LastInEdge[Child] != INVALID_INDEX)
+	{
+		NextInEdge[LastInEdge[Child]] = edge;
+	}
+	else
+	{
+		FirstInEdge[Child] = edge;
+	}
+	LastInEdge[Child] = edge;
+	InDegree[Child]++;
+}
+
+void FDungeonMissionGraph::BreakLink(int32 Parent, int32 Child)
+{
+	int32 edge = FindEdge(Parent, Child);
+	if (edge == INVALID_INDEX)
+	{
+		return;
+	}
+
+	// Unlink from the parent's child list
+	if (PrevOutEdge[edge] != INVALID_INDEX)
+	{
+		NextOutEdge[PrevOutEdge[edge]] = NextOutEdge[edge];
+	}
+	else
+	{
+		FirstOutEdge[Parent] = NextOutEdge[edge];
+	}
+	if (NextOutEdge[edge] != INVALID_INDEX)
+	{
+		PrevOutEdge[NextOutEdge[edge]] = PrevOutEdge[edge];
+	}
+	else
+	{
+		LastOutEdge[Parent] = PrevOutEdge[edge];
+	}
+	OutDegree[Parent]--;
+
+	// Unlink from the child's parent list
+	if (PrevInEdge[edge] != INVALID_INDEX)
+	{
+		NextInEdge[PrevInEdge[edge]] = NextInEdge[edge];
+	}
+	else
+	{
+		FirstInEdge[Child] = NextInEdge[edge];
+	}
+	if (NextInEdge[edge] != INVALID_INDEX)
+	{
+		PrevInEdge[NextInEdge[edge]] = PrevInEdge[edge];
+	}
+	else
+	{
+		LastInEdge[Child] = PrevInEdge[edge];
+	}
+	InDegree[Child]--;
+
+	EdgeFrom[edge] = INVALID_INDEX;
+	EdgeTo[edge] = INVALID_INDEX;
+	FreeEdges.Add(edge);
+
+#if !UE_BUILD_SHIPPING
+	UE_LOG(LogMissionGen, Verbose, TEXT("Breaking link between %s and %s."), *ToString(Parent, 0, false), *ToString(Child, 0, false));
+#endif
+}
+
+void FDungeonMissionGraph::GetChildren(int32 Node, TArray<int32>& OutChildren) const
+{
+	OutChildren.Reset(OutDegree[Node]);
+	for (int32 edge = FirstOutEdge[Node]; edge != INVALID_INDEX; edge = NextOutEdge[edge])
+	{
+		OutChildren.Add(EdgeTo[edge]);
+	}
+}
+
+void FDungeonMissionGraph::GetParents(int32 Node, TArray<int32>& OutParents) const
+{
+	OutParents.Reset(InDegree[Node]);
+	for (int32 edge = FirstInEdge[Node]; edge != INVALID_INDEX; edge = NextInEdge[edge])
+	{
+		OutParents.Add(EdgeFrom[edge]);
+	}
+}
+
+int32 FDungeonMissionGraph::FindChildFromSymbol(int32 Node, const FNumberedGraphSymbol& ChildSymbol) const
+{
+	for (int32 edge = FirstOutEdge[Node]; edge != INVALID_INDEX; edge = NextOutEdge[edge])
+	{
+		int32 child = EdgeTo[edge];
+		if (NodeTypes[child] == ChildSymbol.Symbol && NodeIDs[child] == ChildSymbol.SymbolID)
+		{
+			return child;
+		}
+	}
+	return INVALID_INDEX;
+}
+
+FNumberedGraphSymbol FDungeonMissionGraph::ToGraphSymbol(int32 Node) const
+{
+	FNumberedGraphSymbol symbol;
+	symbol.Symbol = NodeTypes[Node];
+	symbol.SymbolID = NodeIDs[Node];
+	return symbol;
+}
+
+bool FDungeonMissionGraph::IsTerminal(int32 Node) const
+{
+	return NodeTypes[Node] != NULL && NodeTypes[Node]->bIsTerminalNode;
+}
+
+FString FDungeonMissionGraph::GetSymbolDescription(int32 Node) const
+{
+	if (NodeTypes[Node] == NULL)
+	{
+		return "";
+	}
+	return NodeTypes[Node]->Description.ToString();
+}
+
+FString FDungeonMissionGraph::ToString(int32 Node, int32 IndentLevel, bool bPrintChildren) const
+{
+	FString output;
+#if !UE_BUILD_SHIPPING
+	if (!IsValidNode(Node))
+	{
+		return output;
+	}
+	for (int i = 0; i < IndentLevel; i++)
+	{
+		output.AppendChar(' ');
+	}
+	if (TightlyCoupled[Node])
+	{
+		output.Append("=>");
+	}
+	else
+	{
+		output.Append("->");
+	}
+	output.Append(GetSymbolDescription(Node));
+	output.Append(" (");
+	output.AppendInt(NodeIDs[Node]);
+	output.AppendChar(')');
+
+	if (bPrintChildren)
+	{
+		for (int32 edge = FirstOutEdge[Node]; edge != INVALID_INDEX; edge = NextOutEdge[edge])
+		{
+			output.Append("\n");
+			output.Append(ToString(EdgeTo[edge], IndentLevel + 4));
+		}
+	}
+#endif
+	return output;
+}
+
+UDungeonMissionNode* FDungeonMissionGraph::Materialize(UObject* Outer, int32 Head, TArray<UDungeonMissionNode*>& OutNodes) const
+{
+	OutNodes.SetNumZeroed(Num());
+	for (int32 i = 0; i < Num(); i++)
+	{
+		UDungeonMissionNode* node = NewObject<UDungeonMissionNode>(Outer);
+		node->NodeType = NodeTypes[i];
+		node->NodeID = NodeIDs[i];
+		node->bTightlyCoupledToParent = TightlyCoupled[i];
+		node->ChildrenNodes.Reserve(OutDegree[i]);
+		node->ParentNodes.Reserve(InDegree[i]);
+		OutNodes[i] = node;
+	}
+
+	for (int32 i = 0; i < Num(); i++)
+	{
+		for (int32 edge = FirstOutEdge[i]; edge != INVALID_INDEX; edge = NextOutEdge[edge])
+		{
+			OutNodes[i]->ChildrenNodes.Add(OutNodes[EdgeTo[edge]]);
+		}
+		for (int32 edge = FirstInEdge[i]; edge != INVALID_INDEX; edge = NextInEdge[edge])
+		{
+			OutNodes[i]->ParentNodes.Add(OutNodes[EdgeFrom[edge]]);
+		}
+	}
+
+	return OutNodes.IsValidIndex(Head) ? OutNodes[Head] : NULL;
+}
+
+int32 FDungeonMissionGraph::FindEdge(int32 Parent, int32 Child) const
+{
+	for (int32 edge = FirstOutEdge[Parent]; edge != INVALID_INDEX; edge = NextOutEdge[edge])
+	{
+		if (EdgeTo[edge] == Child)
+		{
+			return edge;
+		}
+	}
+	return INVALID_INDEX;
+}
@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonMissionGraphAnalysis.h"
+#include "DungeonMakerNode.h"
+
+FDungeonMissionGraphAnalysis::FDungeonMissionGraphAnalysis()
+{
+	Reset();
+}
+
+void FDungeonMissionGraphAnalysis::Reset()
+{
+	ChildOffsets.Reset();
+	ChildOffsets.Add(0);
+	ChildIndices.Reset();
+	ParentOffsets.Reset();
+	ParentIndices.Reset();
+	Nodes.Reset();
+	NodeIndices.Reset();
+	TopologicalOrder.Reset();
+	TopologicalRank.Reset();
+	bIsAcyclic = true;
+	LevelCount.Reset();
+	Depth.Reset();
+	Levels.Reset();
+	MaxLevelCount = 0;
+	AncestorBits.Reset();
+	AncestorWordsPerNode = 0;
+}
+
+void FDungeonMissionGraphAnalysis::Build(const FDungeonMissionGraph& Graph)
+{
+	Reset();
+
+	int32 nodeCount = Graph.Num();
+	ChildOffsets.SetNumUninitialized(nodeCount + 1);
+	for (int32 i = 0; i < nodeCount; i++)
+	{
+		ChildOffsets[i] = ChildIndices.Num();
+		for (int32 edge = Graph.FirstChildEdge(i); edge != FDungeonMissionGraph::INVALID_INDEX; edge = Graph.NextChildEdge(edge))
+		{
+			ChildIndices.Add(Graph.GetEdgeChild(edge));
+		}
+	}
+	ChildOffsets[nodeCount] = ChildIndices.Num();
+
+	Analyze();
+}
+
+void FDungeonMissionGraphAnalysis::Build(UDungeonMakerNode* Head)
+{
+	Reset();
+	if (Head == NULL)
+	{
+		return;
+	}
+
+	// Find every node we can reach
+	Nodes.Add(Head);
+	NodeIndices.Add(Head, 0);
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		for (UDungeonMakerNode* child : Nodes[i]->ChildrenNodes)
+		{
+			if (child != NULL && !NodeIndices.Contains(child))
+			{
+				NodeIndices.Add(child, Nodes.Add(child));
+			}
+		}
+	}
+
+	int32 nodeCount = Nodes.Num();
+	ChildOffsets.SetNumUninitialized(nodeCount + 1);
+	for (int32 i = 0; i < nodeCount; i++)
+	{
+		ChildOffsets[i] = ChildIndices.Num();
+		for (UDungeonMakerNode* child : Nodes[i]->ChildrenNodes)
+		{
+			if (child != NULL)
+			{
+				ChildIndices.Add(NodeIndices[child]);
+			}
+		}
+	}
+	ChildOffsets[nodeCount] = ChildIndices.Num();
+
+	Analyze();
+}
+
+int32 FDungeonMissionGraphAnalysis::IndexOf(const UDungeonMakerNode* Node) const
+{
+	const int32* index = NodeIndices.Find(Node);
+	if (index == NULL)
+	{
+		return INVALID_INDEX;
+	}
+	return *index;
+}
+
+void FDungeonMissionGraphAnalysis::Analyze()
+{
+	int32 nodeCount = Num();
+
+	// Flip the child lists around to get our parent lists
+	ParentOffsets.SetNumZeroed(nodeCount + 1);
+	for (int32 child : ChildIndices)
+	{
+		ParentOffsets[child + 1]++;
+	}
+	for (int32 i = 0; i < nodeCount; i++)
+	{
+		ParentOffsets[i + 1] += ParentOffsets[i];
+	}
+	ParentIndices.SetNumUninitialized(ChildIndices.Num());
+	TArray<int32> insertAt;
+	insertAt.Append(ParentOffsets.GetData(), nodeCount);
+	for (int32 parent = 0; parent < nodeCount; parent++)
+	{
+		for (int32 i = ChildOffsets[parent]; i < ChildOffsets[parent + 1]; i++)
+		{
+			ParentIndices[insertAt[ChildIndices[i]]++] = parent;
+		}
+	}
+
+	ComputeTopologicalOrder();
+	ComputeLevels();
+	ComputeAncestors();
+}
+
+void FDungeonMissionGraphAnalysis::ComputeTopologicalOrder()
+{
+	// Kahn's algorithm
+	int32 nodeCount = Num();
+	TArray<int32> remainingParents;
+	remainingParents.SetNumUninitialized(nodeCount);
+	TopologicalOrder.Reserve(nodeCount);
+	for (int32 i = 0; i < nodeCount; i++)
+	{
+		remainingParents[i] = GetParentCount(i);
+		if (remainingParents[i] == 0)
+		{
+			TopologicalOrder.Add(i);
+		}
+	}
+
+	// TopologicalOrder doubles as our queue
+	for (int32 next = 0; next < TopologicalOrder.Num(); next++)
+	{
+		int32 node = TopologicalOrder[next];
+		for (int32 i = ChildOffsets[node]; i < ChildOffsets[node + 1]; i++)
+		{
+			int32 child = ChildIndices[i];
+			remainingParents[child]--;
+			if (remainingParents[child] == 0)
+			{
+				TopologicalOrder.Add(child);
+			}
+		}
+	}
+
+	bIsAcyclic = TopologicalOrder.Num() == nodeCount;
+	if (!bIsAcyclic)
+	{
+		UE_LOG(LogMissionGen, Warning, TEXT("Mission graph has a cycle; %d nodes could not be sorted."), nodeCount - TopologicalOrder.Num());
+		for (int32 i = 0; i < nodeCount; i++)
+		{
+			if (remainingParents[i] > 0)
+			{
+				TopologicalOrder.Add(i);
+			}
+		}
+	}
+
+	TopologicalRank.SetNumUninitialized(nodeCount);
+	for (int32 i = 0; i < nodeCount; i++)
+	{
+		TopologicalRank[TopologicalOrder[i]] = i;
+	}
+}
+
+void FDungeonMissionGraphAnalysis::ComputeLevels()
+{
+	int32 nodeCount = Num();
+	LevelCount.SetNumZeroed(nodeCount);
+	Depth.SetNumZeroed(nodeCount);
+
+	// Children come after their parents, so walk backwards to find the level count...
+	for (int32 i = nodeCount - 1; i >= 0; i--)
+	{
+		int32 node = TopologicalOrder[i];
+		int32 biggest = 0;
+		for (int32 j = ChildOffsets[node]; j < ChildOffsets[node + 1]; j++)
+		{
+			biggest = FMath::Max(biggest, LevelCount[ChildIndices[j]]);
+		}
+		LevelCount[node] = biggest + 1;
+		MaxLevelCount = FMath::Max(MaxLevelCount, LevelCount[node]);
+	}
+
+	// ...and forwards to find the depth
+	int32 deepest = 0;
+	for (int32 node : TopologicalOrder)
+	{
+		for (int32 j = ChildOffsets[node]; j < ChildOffsets[node + 1]; j++)
+		{
+			int32 child = ChildIndices[j];
+			Depth[child] = FMath::Max(Depth[child], Depth[node] + 1);
+		}
+		deepest = FMath::Max(deepest, Depth[node]);
+	}
+
+	if (nodeCount > 0)
+	{
+		Levels.SetNum(deepest + 1);
+		for (int32 node : TopologicalOrder)
+		{
+			Levels[Depth[node]].Add(node);
+		}
+	}
+}
+
+void FDungeonMissionGraphAnalysis::ComputeAncestors()
+{
+	int32 nodeCount = Num();
+	AncestorWordsPerNode = (nodeCount + 31) / 32;
+	AncestorBits.SetNumZeroed(nodeCount * AncestorWordsPerNode);
+
+	// Our ancestors are our parents, plus all of their ancestors
+	for (int32 node : TopologicalOrder)
+	{
+		uint32* ourBits = AncestorBits.GetData() + node * AncestorWordsPerNode;
+		for (int32 i = ParentOffsets[node]; i < ParentOffsets[node + 1]; i++)
+		{
+			int32 parent = ParentIndices[i];
+			const uint32* parentBits = AncestorBits.GetData() + parent * AncestorWordsPerNode;
+			for (int32 word = 0; word < AncestorWordsPerNode; word++)
+			{
+				ourBits[word] |= parentBits[word];
+			}
+			ourBits[parent / 32] |= 1u << (parent % 32);
+		}
+	}
+}
+
+bool FDungeonMissionGraphAnalysis::IsAncestorOf(int32 Ancestor, int32 Node) const
+{
+	if (Ancestor < 0 || Ancestor >= Num() || Node < 0 || Node >= Num())
+	{
+		return false;
+	}
+	if (bIsAcyclic)
+	{
+		return (AncestorBits[Node * AncestorWordsPerNode + Ancestor / 32] & (1u << (Ancestor % 32))) != 0;
+	}
+
+	// Our bits can't be trusted if there's a cycle; walk up through our parents instead
+	TArray<bool> visited;
+	visited.SetNumZeroed(Num());
+	TArray<int32> toVisit;
+	toVisit.Add(Node);
+	while (toVisit.Num() > 0)
+	{
+		int32 current = toVisit.Pop(false);
+		for (int32 i = ParentOffsets[current]; i < ParentOffsets[current + 1]; i++)
+		{
+			int32 parent = ParentIndices[i];
+			if (parent == Ancestor)
+			{
+				return true;
+			}
+			if (!visited[parent])
+			{
+				visited[parent] = true;
+				toVisit.Add(parent);
+			}
+		}
+	}
+	return false;
+}
+
+void FDungeonMissionGraphAnalysis::GetBreadthFirstOrder(int32 Start, TArray<int32>& OutOrder) const
+{
+	OutOrder.Reset(Num());
+	if (Start < 0 || Start >= Num())
+	{
+		return;
+	}
+
+	TArray<bool> visited;
+	visited.SetNumZeroed(Num());
+	visited[Start] = true;
+	OutOrder.Add(Start);
+
+	// OutOrder doubles as our queue
+	for (int32 next = 0; next < OutOrder.Num(); next++)
+	{
+		int32 node = OutOrder[next];
+		for (int32 i = ChildOffsets[node]; i < ChildOffsets[node + 1]; i++)
+		{
+			int32 child = ChildIndices[i];
+			if (!visited[child])
+			{
+				visited[child] = true;
+				OutOrder.Add(child);
+			}
+		}
+	}
+}
@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "DungeonMissionNode.h"
+#include "DungeonMissionGraphAnalysis.h"
 
 UDungeonMakerNode* UDungeonMissionNode::FindChildNodeFromSymbol(FNumberedGraphSymbol ChildSymbol) const
 {
@@ -91,16 +92,19 @@ void UDungeonMissionNode::AddLinkToNode(UDungeonMissionNode* NewChild, bool bTig
 
 int32 UDungeonMissionNode::GetLevelCount()
 {
-	int32 biggest = 0;
-	for (UDungeonMakerNode* node : ChildrenNodes)
-	{
-		int32 nextNodeLevelCount = ((UDungeonMissionNode*)node)->GetLevelCount();
-		if (nextNodeLevelCount > biggest)
-		{
-			biggest = nextNodeLevelCount;
-		}
-	}
-	return biggest + 1;
+	// Only our descendants matter, so the analysis can start from us
+	FDungeonMissionGraphAnalysis analysis;
+	analysis.Build(this);
+	return GetLevelCount(analysis);
+}
+
+int32 UDungeonMissionNode::GetLevelCount(const FDungeonMissionGraphAnalysis& Analysis) const
+{
+	// Our children can share descendants, so walking down through every child
+	// recursively can take exponential time. Look it up in the analysis instead.
+	int32 index = Analysis.IndexOf(this);
+	checkf(index != FDungeonMissionGraphAnalysis::INVALID_INDEX, TEXT("Node isn't part of the analyzed graph!"));
+	return Analysis.GetLevelCount(index);
 }
 
 /*TArray<UDungeonMissionNode*> UDungeonMissionNode::GetDepthFirstSortedNodes(UDungeonMissionNode* Head, bool bOnlyTightlyCoupled)
@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonMissionPatternMatcher.h"
+#include "DungeonMakerGraph.h"
+
+bool FDungeonMissionPattern::Compile(const UDungeonMakerGraph* Graph)
+{
+	Symbols.Reset();
+	NodeIDs.Reset();
+	TightlyCoupled.Reset();
+	Children.Reset();
+	Parents.Reset();
+	MatchOrder.Reset();
+	Anchors.Reset();
+	AnchorIsParent.Reset();
+
+	if (Graph == NULL || Graph->AllNodes.Num() == 0)
+	{
+		return false;
+	}
+
+	TMap<const UDungeonMakerNode*, int32> indices;
+	int32 root = INDEX_NONE;
+	for (const UDungeonMakerNode* node : Graph->AllNodes)
+	{
+		int32 index = Symbols.Add(node->NodeType);
+		NodeIDs.Add(node->NodeID);
+		TightlyCoupled.Add(node->bTightlyCoupledToParent);
+		indices.Add(node, index);
+		if (node->NodeID == 1)
+		{
+			root = index;
+		}
+	}
+
+	if (root == INDEX_NONE)
+	{
+		UE_LOG(LogMissionGen, Warning, TEXT("Input graph %s has no node with an ID of 1, so it can't be used as a pattern."), *Graph->GetName());
+		Symbols.Reset();
+		return false;
+	}
+
+	Children.SetNum(Symbols.Num());
+	Parents.SetNum(Symbols.Num());
+	for (const UDungeonMakerNode* node : Graph->AllNodes)
+	{
+		int32 parent = indices[node];
+		for (const UDungeonMakerNode* child : node->ChildrenNodes)
+		{
+			const int32* childIndex = indices.Find(child);
+			if (childIndex != NULL)
+			{
+				Children[parent].AddUnique(*childIndex);
+				Parents[*childIndex].AddUnique(parent);
+			}
+		}
+	}
+
+	// Figure out what order to match things in.
+	// Nodes with the most links to things we've already matched get pruned the hardest,
+	// so they go first.
+	TArray<bool> ordered;
+	ordered.SetNumZeroed(Symbols.Num());
+	ordered[root] = true;
+	MatchOrder.Add(root);
+	Anchors.Add(INDEX_NONE);
+	AnchorIsParent.Add(false);
+
+	while (MatchOrder.Num() < Symbols.Num())
+	{
+		int32 best = INDEX_NONE;
+		int32 bestLinks = 0;
+		int32 bestDegree = 0;
+		for (int32 i = 0; i < Symbols.Num(); i++)
+		{
+			if (ordered[i])
+			{
+				continue;
+			}
+			int32 links = 0;
+			for (int32 parent : Parents[i])
+			{
+				links += ordered[parent] ? 1 : 0;
+			}
+			for (int32 child : Children[i])
+			{
+				links += ordered[child] ? 1 : 0;
+			}
+			int32 degree = Parents[i].Num() + Children[i].Num();
+			if (links > bestLinks || (links == bestLinks && links > 0 && degree > bestDegree))
+			{
+				best = i;
+				bestLinks = links;
+				bestDegree = degree;
+			}
+		}
+
+		if (best == INDEX_NONE)
+		{
+			UE_LOG(LogMissionGen, Warning, TEXT("Input graph %s is not connected to its root node, so it can't be used as a pattern."), *Graph->GetName());
+			Symbols.Reset();
+			return false;
+		}
+
+		// Prefer to pull candidates from a parent, since nodes tend to have fewer parents than children
+		int32 anchor = INDEX_NONE;
+		bool bAnchorIsParent = false;
+		for (int32 parent : Parents[best])
+		{
+			if (ordered[parent])
+			{
+				anchor = parent;
+				bAnchorIsParent = true;
+				break;
+			}
+		}
+		if (anchor == INDEX_NONE)
+		{
+			for (int32 child : Children[best])
+			{
+				if (ordered[child])
+				{
+					anchor = child;
+					break;
+				}
+			}
+		}
+
+		ordered[best] = true;
+		MatchOrder.Add(best);
+		Anchors.Add(anchor);
+		AnchorIsParent.Add(bAnchorIsParent);
+	}
+
+	return true;
+}
+
+int32 FDungeonMissionPatternMatcher::FindMatches(const FDungeonMissionPattern& Pattern, const FDungeonMissionGraph& Graph,
+	int32 Root, TArray<TArray<int32>>& OutMatches, int32 MaxMatches)
+{
+	int32 startingMatchCount = OutMatches.Num();
+	if (!Pattern.IsValid() || !Graph.IsValidNode(Root) || MaxMatches <= 0)
+	{
+		return 0;
+	}
+
+	TArray<int32> currentMatch;
+	currentMatch.Init(FDungeonMissionGraph::INVALID_INDEX, Pattern.Num());
+	if (!IsFeasible(Pattern, Graph, Pattern.MatchOrder[0], Root, currentMatch))
+	{
+		return 0;
+	}
+	currentMatch[Pattern.MatchOrder[0]] = Root;
+
+	MatchNext(Pattern, Graph, 1, currentMatch, OutMatches, startingMatchCount + MaxMatches);
+	return OutMatches.Num() - startingMatchCount;
+}
+
+void FDungeonMissionPatternMatcher::MatchNext(const FDungeonMissionPattern& Pattern, const FDungeonMissionGraph& Graph,
+	int32 OrderIndex, TArray<int32>& CurrentMatch, TArray<TArray<int32>>& OutMatches, int32 MaxMatches)
+{
+	if (OrderIndex == Pattern.MatchOrder.Num())
+	{
+		// Everything has been matched
+		OutMatches.Add(CurrentMatch);
+		return;
+	}
+
+	int32 patternNode = Pattern.MatchOrder[OrderIndex];
+	int32 anchor = CurrentMatch[Pattern.Anchors[OrderIndex]];
+
+	// Only neighbors of our anchor's match can possibly match us
+	if (Pattern.AnchorIsParent[OrderIndex])
+	{
+		for (int32 edge = Graph.FirstChildEdge(anchor); edge != FDungeonMissionGraph::INVALID_INDEX; edge = Graph.NextChildEdge(edge))
+		{
+			int32 candidate = Graph.GetEdgeChild(edge);
+			if (IsFeasible(Pattern, Graph, patternNode, candidate, CurrentMatch))
+			{
+				CurrentMatch[patternNode] = candidate;
+				MatchNext(Pattern, Graph, OrderIndex + 1, CurrentMatch, OutMatches, MaxMatches);
+				CurrentMatch[patternNode] = FDungeonMissionGraph::INVALID_INDEX;
+				if (OutMatches.Num() >= MaxMatches)
+				{
+					return;
+				}
+			}
+		}
+	}
+	else
+	{
+		for (int32 edge = Graph.FirstParentEdge(anchor); edge != FDungeonMissionGraph::INVALID_INDEX; edge = Graph.NextParentEdge(edge))
+		{
+			int32 candidate = Graph.GetEdgeParent(edge);
+			if (IsFeasible(Pattern, Graph, patternNode, candidate, CurrentMatch))
+			{
+				CurrentMatch[patternNode] = candidate;
+				MatchNext(Pattern, Graph, OrderIndex + 1, CurrentMatch, OutMatches, MaxMatches);
+				CurrentMatch[patternNode] = FDungeonMissionGraph::INVALID_INDEX;
+				if (OutMatches.Num() >= MaxMatches)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+bool FDungeonMissionPatternMatcher::IsFeasible(const FDungeonMissionPattern& Pattern, const FDungeonMissionGraph& Graph,
+	int32 PatternNode, int32 Candidate, const TArray<int32>& CurrentMatch)
+{
+	// Cheapest checks first: symbol, coupling, and whether we have enough links
+	const UGraphNode* symbol = Pattern.Symbols[PatternNode];
+	if (symbol != NULL && Graph.NodeTypes[Candidate] != symbol)
+	{
+		return false;
+	}
+	if (Pattern.Parents[PatternNode].Num() > 0 && Graph.TightlyCoupled[Candidate] != Pattern.TightlyCoupled[PatternNode])
+	{
+		return false;
+	}
+	if (Graph.GetChildCount(Candidate) < Pattern.Children[PatternNode].Num() ||
+		Graph.GetParentCount(Candidate) < Pattern.Parents[PatternNode].Num())
+	{
+		return false;
+	}
+
+	// Make sure we agree with everything that's already been matched
+	for (int32 other = 0; other < CurrentMatch.Num(); other++)
+	{
+		int32 otherMatch = CurrentMatch[other];
+		if (otherMatch == FDungeonMissionGraph::INVALID_INDEX)
+		{
+			continue;
+		}
+		if (otherMatch == Candidate)
+		{
+			// Already used by another pattern node
+			return false;
+		}
+
+		bool bPatternLinksToOther = Pattern.Children[PatternNode].Contains(other);
+		bool bPatternLinksFromOther = Pattern.Parents[PatternNode].Contains(other);
+		if (Graph.HasLink(Candidate, otherMatch) != bPatternLinksToOther ||
+			Graph.HasLink(otherMatch, Candidate) != bPatternLinksFromOther)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -15,6 +15,16 @@ ADungeon::ADungeon()
 TSet<FIntVector> ADungeon::GetAllTilesOfType(ETileType Type) const
 {
 	TSet<FIntVector> tileTypes;
+	if (Space->TileGrid.IsBuilt())
+	{
+		// The grid already keeps a layer per type for each floor
+		TArray<FIntVector> tiles;
+		Space->TileGrid.GetAllTiles(Type, tiles);
+		tileTypes.Append(tiles);
+		return tileTypes;
+	}
+
+	// Still generating, so ask each floor's rooms
 	for (int i = 0; i < Space->Floors.Num(); i++)
 	{
 		tileTypes.Append(Space->Floors[i]->GetAllTilesOfType(Type));
@@ -22,6 +32,75 @@ TSet<FIntVector> ADungeon::GetAllTilesOfType(ETileType Type) const
 	return tileTypes;
 }
 
+FIntVector ADungeon::ConvertWorldToTileSpace(FVector WorldLocation) const
+{
+	return FIntVector(
+		FMath::FloorToInt(WorldLocation.X / UDungeonTile::TILE_SIZE),
+		FMath::FloorToInt(WorldLocation.Y / UDungeonTile::TILE_SIZE),
+		FMath::FloorToInt(WorldLocation.Z / UDungeonTile::TILE_SIZE));
+}
+
+bool ADungeon::FindNearestTileOfType(ETileType Type, FIntVector Origin, int32 MaxDistance, FIntVector& NearestTile) const
+{
+	return Space->TileGrid.FindNearestTileOfType(Type, Origin, MaxDistance, NearestTile);
+}
+
+TArray<FIntVector> ADungeon::GetTilesOfTypeInRadius(ETileType Type, FIntVector Center, float Radius) const
+{
+	TArray<FIntVector> tiles;
+	Space->TileGrid.GetTilesInRadius(Type, Center, Radius, tiles);
+	return tiles;
+}
+
+TArray<FIntVector> ADungeon::GetTilesOfTypeInRectangle(ETileType Type, FIntVector Min, FIntVector Max) const
+{
+	TArray<FIntVector> tiles;
+	Space->TileGrid.GetTilesInRectangle(Type, Min, Max, tiles);
+	return tiles;
+}
+
+bool ADungeon::FindPath(FIntVector Start, FIntVector Goal, TArray<FIntVector>& Path)
+{
+	return Space->Pathfinder.FindPath(Start, Goal, Path);
+}
+
+FIntVector ADungeon::GetFlowDirection(FIntVector Target, FIntVector From)
+{
+	return Space->Pathfinder.GetFlowDirection(Target, From);
+}
+
+int32 ADungeon::GetFlowDistance(FIntVector Target, FIntVector From)
+{
+	return Space->Pathfinder.GetFlowDistance(Target, From);
+}
+
+bool ADungeon::HasLineOfSight(FIntVector From, FIntVector To) const
+{
+	return Space->Visibility.HasLineOfSight(From, To);
+}
+
+TArray<FIntVector> ADungeon::GetVisibleTiles(FIntVector Origin, int32 Radius)
+{
+	TArray<FIntVector> tiles;
+	Space->Visibility.GetVisibleTiles(Origin, Radius, tiles);
+	return tiles;
+}
+
+void ADungeon::UpdateFogOfWar(FIntVector PlayerLocation, int32 SightRadius)
+{
+	Space->Visibility.UpdateFogOfWar(PlayerLocation, SightRadius);
+}
+
+bool ADungeon::IsTileVisible(FIntVector Tile) const
+{
+	return Space->Visibility.IsTileVisible(Tile);
+}
+
+bool ADungeon::IsTileExplored(FIntVector Tile) const
+{
+	return Space->Visibility.IsTileExplored(Tile);
+}
+
 // Called when the game starts or when spawned
 void ADungeon::BeginPlay()
 {
@@ -38,10 +117,28 @@ void ADungeon::BeginPlay()
 	}
 	UE_LOG(LogMissionGen, Log, TEXT("Creating dungeon out of seed %d."), Seed);
 	bool bSuccessfullyMadeDungeon = false;
+	int32 missionCount = 0;
 
 	do 
 	{
 		Mission->TryToCreateDungeon(rng);
-		bSuccessfullyMadeDungeon = Space->CreateDungeonSpace(Mission->Head, Mission->DungeonSize, rng);
+		missionCount++;
+		// Rewriting only touches the mission graph; the nodes get made once, for the layouts to share.
+		Mission->MaterializeMission();
+
+		// Space generation only reads the mission, so a failed layout can be retried with the same one.
+		// Every layout gets a seed derived from the mission's, so retries don't depend on how far
+		// the last layout got through its random stream.
+		int32 missionSeed = rng.GetUnsignedInt();
+		for (int32 attempt = 0; attempt <= LayoutRetriesPerMission && !bSuccessfullyMadeDungeon; attempt++)
+		{
+			FRandomStream layoutRng((int32)HashCombine(missionSeed, GetTypeHash(attempt)));
+			bSuccessfullyMadeDungeon = Space->CreateDungeonSpace(Mission->Head, Mission->DungeonSize, layoutRng);
+		}
+
+		if (!bSuccessfullyMadeDungeon)
+		{
+			UE_LOG(LogMissionGen, Log, TEXT("Couldn't lay out mission %d after %d tries; generating a new mission."), missionCount, LayoutRetriesPerMission + 1);
+		}
 	} while (!bSuccessfullyMadeDungeon);
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ UDungeonSpaceGenerator::UDungeonSpaceGenerator()
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = false;
 	MaxGeneratedRooms = -1;
+	GoalSymbol = NULL;
 }
 
 bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32 SymbolCount, FRandomStream& Rng)
@@ -16,9 +17,20 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 	TotalSymbolCount = SymbolCount;
 
 	// Create floors
-	int32 floorSideSize = FMath::CeilToInt(FMath::Sqrt((float)DungeonSize / (float)RoomSize));
-	int32 symbolsPerFloor = floorSideSize * floorSideSize;
-	int32 floorCount = FMath::CeilToInt(SymbolCount / (float)symbolsPerFloor);
+	int32 floorSideSize;
+	int32 floorCount;
+	if (FloorSizing == EDungeonFloorSizing::FitToMission)
+	{
+		// Rooms are only ever laid out next to each other on the same floor, so everything goes on one floor
+		floorSideSize = FitFloorToMission(Head, SymbolCount);
+		floorCount = 1;
+	}
+	else
+	{
+		floorSideSize = FMath::CeilToInt(FMath::Sqrt((float)DungeonSize / (float)RoomSize));
+		int32 symbolsPerFloor = floorSideSize * floorSideSize;
+		floorCount = FMath::CeilToInt(SymbolCount / (float)symbolsPerFloor);
+	}
 
 	// By default, all levels will have the same number of rooms
 	// We can probably get fancy with this by making like spherical dungeons and such if wanted
@@ -31,9 +43,23 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 	
 	MissionSpaceHandler = NewObject<UDungeonMissionSpaceHandler>(GetOuter(), TEXT("Mission Space Manager"));
 	MissionSpaceHandler->RoomSize = RoomSize;
+	MissionSpaceHandler->MaxLayoutSteps = MaxLayoutSteps;
+	MissionSpaceHandler->LayoutAttempts = LayoutAttempts;
+	MissionSpaceHandler->bParallelLayoutAttempts = bParallelLayoutAttempts;
 	MissionSpaceHandler->InitializeDungeonFloor(this, dungeonLevelSizes);
 	// Map the mission to the space
 	bool bMadeSpace = MissionSpaceHandler->CreateDungeonSpace(Head, FIntVector(0, 0, 0), TotalSymbolCount, Rng);
+	for (int32 growth = 0; !bMadeSpace && bGrowFloorsOnLayoutFailure && growth < MaxFloorGrowth; growth++)
+	{
+		// Keep the mission, and give it more space to work with
+		for (int32& size : dungeonLevelSizes)
+		{
+			size++;
+		}
+		UE_LOG(LogSpaceGen, Log, TEXT("Layout failed; growing floors to %d x %d."), dungeonLevelSizes[0], dungeonLevelSizes[0]);
+		MissionSpaceHandler->InitializeDungeonFloor(this, dungeonLevelSizes);
+		bMadeSpace = MissionSpaceHandler->CreateDungeonSpace(Head, FIntVector(0, 0, 0), TotalSymbolCount, Rng);
+	}
 
 	if (!bMadeSpace)
 	{
@@ -41,6 +67,23 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 		return false;
 	}
 
+	// Make sure the player can actually finish the dungeon before we spawn anything
+	Solvability = FDungeonSolvabilityAnalyzer::Analyze(DungeonSpace, Head, GoalSymbol);
+	if (!Solvability.bIsSolvable)
+	{
+		UE_LOG(LogSpaceGen, Warning, TEXT("Goal room (%d, %d, %d) can't be reached from the start! Keys found: %d, locks opened: %d."),
+			Solvability.GoalRoom.X, Solvability.GoalRoom.Y, Solvability.GoalRoom.Z, Solvability.KeyOrder.Num(), Solvability.LockOrder.Num());
+		if (bRejectUnsolvableLayouts)
+		{
+			MissionSpaceHandler->DestroyComponent();
+			return false;
+		}
+	}
+	else if (Solvability.bHasSoftlockRisk)
+	{
+		UE_LOG(LogSpaceGen, Log, TEXT("Dungeon has %d locked rooms which could waste a key if opened out of order."), Solvability.SoftlockRiskRooms.Num());
+	}
+
 	for (int i = 0; i < DungeonSpace.Num(); i++)
 	{
 		FString floorName = "Floor ";
@@ -50,6 +93,9 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 		Floors.Add(floor);
 		floor->SpawnRooms(Rng, GlobalGroundScatter);
 	}
+	TileGrid.Build(this);
+	Pathfinder.Initialize(this);
+	Visibility.Initialize(&TileGrid);
 
 
 	if (bDebugDungeon)
@@ -71,7 +117,11 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 
 					ASpaceMeshActor* floorMeshComponent = (ASpaceMeshActor*)GetWorld()->SpawnActor(ASpaceMeshActor::StaticClass());
 					floorMeshComponent->Rename(*componentName);
-					floorMeshComponent->SetStaticMesh(tile, tile->GroundMesh);
+					floorMeshComponent->SetStaticMesh(tile, tile->GroundMesh, bTileMeshesAffectNavigation);
+					if (tile->WallColumnMode == EWallColumnMode::TallMeshes)
+					{
+						floorMeshComponent->AddColumnMeshes(tile->ColumnMeshes, bTileMeshesAffectNavigation);
+					}
 					FloorComponentLookup.Add(tile, floorMeshComponent);
 				}
 				if (!CeilingComponentLookup.Contains(tile) && tile->CeilingMesh.Num() > 0)
@@ -82,7 +132,7 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 
 					ASpaceMeshActor* ceilingMeshComponent = (ASpaceMeshActor*)GetWorld()->SpawnActor(ASpaceMeshActor::StaticClass());
 					ceilingMeshComponent->Rename(*componentName);
-					ceilingMeshComponent->SetStaticMesh(tile, tile->CeilingMesh);
+					ceilingMeshComponent->SetStaticMesh(tile, tile->CeilingMesh, bTileMeshesAffectNavigation);
 					CeilingComponentLookup.Add(tile, ceilingMeshComponent);
 				}
 			}
@@ -111,6 +161,66 @@ bool UDungeonSpaceGenerator::CreateDungeonSpace(UDungeonMissionNode* Head, int32
 	return true;
 }
 
+int32 UDungeonSpaceGenerator::FitFloorToMission(UDungeonMissionNode* Head, int32 SymbolCount) const
+{
+	FDungeonMissionGraphAnalysis mission;
+	mission.Build(Head);
+
+	int32 maxBranching = 0;
+	int32 maxNeighborsNeeded = 1;
+	// Every extra branch is a dead end which closes off some of the space around it
+	int32 extraBranches = 0;
+	// Nodes linked together by tight coupling, which all have to be next to each other
+	int32 largestTightCluster = 0;
+	TArray<int32> tightClusterSize;
+	tightClusterSize.SetNumZeroed(mission.Num());
+
+	const TArray<int32>& order = mission.GetTopologicalOrder();
+	for (int32 i = order.Num() - 1; i >= 0; i--)
+	{
+		int32 node = order[i];
+		int32 childCount = mission.GetChildCount(node);
+		int32 tightChildCount = 0;
+		tightClusterSize[node] = 1;
+		for (int32 j = 0; j < childCount; j++)
+		{
+			int32 child = mission.GetChild(node, j);
+			if (mission.GetNode(child)->bTightlyCoupledToParent)
+			{
+				tightChildCount++;
+				tightClusterSize[node] += tightClusterSize[child];
+			}
+		}
+
+		maxBranching = FMath::Max(maxBranching, childCount);
+		extraBranches += FMath::Max(0, childCount - 1);
+		largestTightCluster = FMath::Max(largestTightCluster, tightClusterSize[node]);
+		// Tightly-coupled children need to be right next to this room, as does the room we came from
+		int32 neighborsNeeded = tightChildCount + (mission.GetParentCount(node) > 0 ? 1 : 0);
+		maxNeighborsNeeded = FMath::Max(maxNeighborsNeeded, neighborsNeeded);
+	}
+
+	// Fitted missions all go on one floor, so the up and down directions are never available
+	const int32 maxNeighbors = FFloorRoom::DIRECTION_COUNT - 2;
+	if (maxNeighborsNeeded > maxNeighbors)
+	{
+		UE_LOG(LogSpaceGen, Warning, TEXT("A room in this mission needs %d neighbors, but rooms on a single floor can only have %d!"),
+			maxNeighborsNeeded, maxNeighbors);
+	}
+
+	// Corner rooms have 2 neighbors, edge rooms have 3, and it takes a 3x3 floor to have either of the latter
+	int32 minSideSize = maxNeighborsNeeded > 2 ? 3 : 2;
+	minSideSize = FMath::Max(minSideSize, FMath::CeilToInt(FMath::Sqrt((float)largestTightCluster)));
+
+	float occupancy = FMath::Clamp(MaxFloorOccupancy, 0.1f, 1.0f);
+	int32 cellsNeeded = FMath::CeilToInt((SymbolCount + extraBranches) / occupancy);
+	int32 sideSize = FMath::Max(minSideSize, FMath::CeilToInt(FMath::Sqrt((float)cellsNeeded)));
+
+	UE_LOG(LogSpaceGen, Log, TEXT("Fit floor to mission: %d x %d (%d symbols, depth %d, max branching %d, largest tightly-coupled cluster %d)."),
+		sideSize, sideSize, SymbolCount, mission.GetDepthCount(), maxBranching, largestTightCluster);
+	return sideSize;
+}
+
 void UDungeonSpaceGenerator::DrawDebugSpace()
 {
 	MissionSpaceHandler->DrawDebugSpace();
@@ -128,4 +238,9 @@ FIntVector UDungeonSpaceGenerator::ConvertToFloorSpace(FIntVector TileSpaceLocat
 FFloorRoom UDungeonSpaceGenerator::GetRoomFromFloorCoordinates(FIntVector FloorSpaceLocation)
 {
 	return MissionSpaceHandler->GetRoomFromFloorCoordinates(FloorSpaceLocation);
+}
+
+const FFloorRoom* UDungeonSpaceGenerator::FindRoom(FIntVector FloorSpaceLocation) const
+{
+	return MissionSpaceHandler->FindRoom(FloorSpaceLocation);
 }
\ No newline at end of file
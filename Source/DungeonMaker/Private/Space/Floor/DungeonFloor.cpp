@@ -31,22 +31,22 @@ void FDungeonFloor::DrawDungeonFloor(AActor* Context, int32 RoomSize, int32 ZOff
 
 			// Label the center with the type of tile this is
 			FVector midpoint((xOffset + 0.5f) * offset, (yOffset + 0.5f) * offset, (ZOffset * offset) + 100.0f);
-			TSubclassOf<ADungeonRoom> room = DungeonRooms[y][x].RoomClass;
-			if (room != NULL)
+			const FFloorRoom& room = Get(x, y);
+			if (room.RoomClass != NULL)
 			{
-				FString symbolDescription = DungeonRooms[y][x].DungeonSymbol.GetSymbolDescription();
+				FString symbolDescription = room.DungeonSymbol.GetSymbolDescription();
 				symbolDescription += " (";
-				symbolDescription.AppendInt(DungeonRooms[y][x].DungeonSymbol.SymbolID);
+				symbolDescription.AppendInt(room.DungeonSymbol.SymbolID);
 				symbolDescription += ")";
 				DrawDebugString(Context->GetWorld(), midpoint, symbolDescription);
 			}
 
-			for (FIntVector neighborLocation : DungeonRooms[y][x].NeighboringRooms)
+			for (FIntVector neighborLocation : room.GetNeighborLocations(room.NeighborMask))
 			{
 				FVector otherMidpoint = FVector((neighborLocation.X + 0.5f) * offset, (neighborLocation.Y + 0.5f) * offset, neighborLocation.Z * offset);
 				DrawDebugLine(Context->GetWorld(), midpoint, otherMidpoint, randomColor, true);
 			}
-			for (FIntVector neighborLocation : DungeonRooms[y][x].NeighboringTightlyCoupledRooms)
+			for (FIntVector neighborLocation : room.GetNeighborLocations(room.TightlyCoupledNeighborMask))
 			{
 				FVector otherMidpoint = FVector((neighborLocation.X + 0.5f) * offset, (neighborLocation.Y + 0.5f) * offset, neighborLocation.Z * offset);
 				DrawDebugLine(Context->GetWorld(), midpoint, otherMidpoint, randomColor, true);
@@ -56,14 +56,14 @@ void FDungeonFloor::DrawDungeonFloor(AActor* Context, int32 RoomSize, int32 ZOff
 	}
 }
 
-void FDungeonFloor::Set(FFloorRoom Room)
+void FDungeonFloor::Set(const FFloorRoom& Room)
 {
-	DungeonRooms[Room.Location.Y].Set(Room, Room.Location.X);
+	Get(Room.Location.X, Room.Location.Y) = Room;
 }
 
 void FDungeonFloor::UpdateChildren(FIntVector A, FIntVector B)
 {
 	UE_LOG(LogSpaceGen, Log, TEXT("(%d, %d, %d) neighbors (%d, %d, %d)."), A.X, A.Y, A.Z, B.X, B.Y, B.Z);
-	DungeonRooms[A.Y][A.X].NeighboringRooms.Add(B);
-	DungeonRooms[B.Y][B.X].NeighboringRooms.Add(A);
+	Get(A.X, A.Y).AddNeighbor(B, false);
+	Get(B.X, B.Y).AddNeighbor(A, false);
 }
@@ -12,6 +12,7 @@ void UDungeonFloorManager::InitializeFloorManager(UDungeonSpaceGenerator* SpaceG
 	RoomSize = DungeonSpaceGenerator->RoomSize;
 	PreGenerationRoomReplacementPhases = DungeonSpaceGenerator->PreGenerationRoomReplacementPhases;
 	PostGenerationRoomReplacementPhases = DungeonSpaceGenerator->PostGenerationRoomReplacementPhases;
+	Autotiler = DungeonSpaceGenerator->Autotiler;
 
 	DefaultFloorTile = DungeonSpaceGenerator->DefaultFloorTile;
 	DefaultWallTile = DungeonSpaceGenerator->DefaultWallTile;
@@ -27,12 +28,13 @@ void UDungeonFloorManager::SpawnRooms(FRandomStream& Rng, const FGroundScatterPa
 	{
 		for (int y = 0; y < floor.YSize(); y++)
 		{
-			if (floor[y][x].RoomClass == NULL)
+			FFloorRoom& room = floor.Get(x, y);
+			if (room.RoomClass == NULL)
 			{
 				// This room is empty
 				continue;
 			}
-			floor.DungeonRooms[y].DungeonRooms[x].SpawnedRoom = CreateRoom(floor[y][x], Rng, GlobalGroundScatter);
+			room.SpawnedRoom = CreateRoom(room, Rng, GlobalGroundScatter);
 		}
 	}
 
@@ -42,11 +44,12 @@ void UDungeonFloorManager::SpawnRooms(FRandomStream& Rng, const FGroundScatterPa
 	{
 		for (int y = 0; y < floor.YSize(); y++)
 		{
-			if (floor[y][x].SpawnedRoom == NULL)
+			ADungeonRoom* room = floor.Get(x, y).SpawnedRoom;
+			if (room == NULL)
 			{
 				continue;
 			}
-			CreateEntrances(floor[y][x].SpawnedRoom, Rng);
+			CreateEntrances(room, Rng);
 		}
 	}
 
@@ -55,28 +58,31 @@ void UDungeonFloorManager::SpawnRooms(FRandomStream& Rng, const FGroundScatterPa
 	{
 		for (int y = 0; y < floor.YSize(); y++)
 		{
-			if (floor[y][x].SpawnedRoom == NULL)
+			ADungeonRoom* room = floor.Get(x, y).SpawnedRoom;
+			if (room == NULL)
 			{
 				continue;
 			}
-			DoTileReplacement(floor[y][x].SpawnedRoom, Rng);
+			DoTileReplacement(room, Rng);
 		}
 	}
 	DoFloorWideTileReplacement(PostGenerationRoomReplacementPhases, Rng);
+	DoFloorWideAutotiling();
 }
 
 void UDungeonFloorManager::DrawDebugSpace()
 {
-	FDungeonFloor floor = GetDungeonFloor();
+	const FDungeonFloor& floor = GetDungeonFloor();
 	for (int x = 0; x < floor.XSize(); x++)
 	{
 		for (int y = 0; y < floor.YSize(); y++)
 		{
-			if (floor[y][x].SpawnedRoom == NULL)
+			ADungeonRoom* room = floor.Get(x, y).SpawnedRoom;
+			if (room == NULL)
 			{
 				continue;
 			}
-			floor[y][x].SpawnedRoom->DrawDebugRoom();
+			room->DrawDebugRoom();
 		}
 	}
 }
@@ -88,29 +94,34 @@ FFloorRoom UDungeonFloorManager::GetRoomFromTileSpace(FIntVector TileSpaceLocati
 	return DungeonSpaceGenerator->GetRoomFromFloorCoordinates(floorSpaceLocation);
 }
 
+const FFloorRoom* UDungeonFloorManager::FindRoomFromTileSpace(FIntVector TileSpaceLocation) const
+{
+	FIntVector floorSpaceLocation = DungeonSpaceGenerator->ConvertToFloorSpace(TileSpaceLocation);
+	return DungeonSpaceGenerator->FindRoom(floorSpaceLocation);
+}
+
 const UDungeonTile* UDungeonFloorManager::GetTileFromTileSpace(FIntVector TileSpaceLocation)
 {
 	FIntVector floorSpaceLocation = DungeonSpaceGenerator->ConvertToFloorSpace(TileSpaceLocation);
-	FFloorRoom room = DungeonSpaceGenerator->GetRoomFromFloorCoordinates(floorSpaceLocation);
-	if (room.SpawnedRoom == NULL)
+	const FFloorRoom* room = DungeonSpaceGenerator->FindRoom(floorSpaceLocation);
+	if (room == NULL || room->SpawnedRoom == NULL)
 	{
 		return NULL;
 	}
 	FIntVector localTileOffset = TileSpaceLocation - (floorSpaceLocation * RoomSize);
-	return room.SpawnedRoom->GetTile(localTileOffset.X, localTileOffset.Y);
+	return room->SpawnedRoom->GetTile(localTileOffset.X, localTileOffset.Y);
 }
 
 void UDungeonFloorManager::UpdateTileFromTileSpace(FIntVector TileSpaceLocation, const UDungeonTile* NewTile)
 {
 	FIntVector floorSpaceLocation = DungeonSpaceGenerator->ConvertToFloorSpace(TileSpaceLocation);
-	FFloorRoom room = DungeonSpaceGenerator->GetRoomFromFloorCoordinates(floorSpaceLocation);
-	if (room.SpawnedRoom == NULL)
+	const FFloorRoom* room = DungeonSpaceGenerator->FindRoom(floorSpaceLocation);
+	if (room == NULL || room->SpawnedRoom == NULL)
 	{
 		UE_LOG(LogSpaceGen, Warning, TEXT("Tile has not been placed yet at (%d, %d, %d)."), TileSpaceLocation.X, TileSpaceLocation.Y, TileSpaceLocation.Z);
 		return;
 	}
-	FIntVector localTileOffset = TileSpaceLocation - floorSpaceLocation;
-	room.SpawnedRoom->SetTileGridCoordinates(localTileOffset, NewTile);
+	room->SpawnedRoom->SetTileGridCoordinates(TileSpaceLocation, NewTile);
 }
 
 void UDungeonFloorManager::SpawnRoomMeshes(TMap<const UDungeonTile*, ASpaceMeshActor*>& FloorComponentLookup,
@@ -122,13 +133,18 @@ void UDungeonFloorManager::SpawnRoomMeshes(TMap<const UDungeonTile*, ASpaceMeshA
 	{
 		for (int y = 0; y < floor.YSize(); y++)
 		{
-			if (floor[y][x].SpawnedRoom == NULL)
+			ADungeonRoom* room = floor.Get(x, y).SpawnedRoom;
+			if (room == NULL)
 			{
 				// This room is empty
 				continue;
 			}
-			floor.DungeonRooms[y].DungeonRooms[x].SpawnedRoom->PlaceRoomTiles(FloorComponentLookup, CeilingComponentLookup, Rng);
-			floor.DungeonRooms[y].DungeonRooms[x].SpawnedRoom->OnRoomGenerationComplete();
+			room->PlaceRoomTiles(FloorComponentLookup, CeilingComponentLookup, Rng);
+			// Each room has to be finished before the next one starts, since
+			// OnRoomGenerationComplete is free to change things later rooms look at
+			room->BuildTileInstances();
+			room->AddTileInstances();
+			room->OnRoomGenerationComplete();
 		}
 	}
 }
@@ -145,16 +161,22 @@ int UDungeonFloorManager::YSize() const
 
 TSet<FIntVector> UDungeonFloorManager::GetAllTilesOfType(ETileType Type)
 {
+	// Each room already knows where its tiles are, so we only need to visit each room once
 	TSet<FIntVector> tileTypes;
-	for (int x = 0; x < XSize(); x++)
+	TArray<FIntVector> roomTiles;
+	for (const FFloorRoom& room : GetDungeonFloor().Rooms)
 	{
-		for (int y = 0; y < YSize(); y++)
+		if (room.SpawnedRoom == NULL)
 		{
-			FFloorRoom room = GetRoomFromTileSpace(FIntVector(x, y, DungeonLevel));
-			if (room.SpawnedRoom != NULL)
-			{
-				tileTypes.Append(room.SpawnedRoom->GetAllTilesOfType(Type));
-			}
+			continue;
+		}
+		roomTiles.Reset();
+		room.SpawnedRoom->RoomTiles.GetTileLocationsOfType(Type, roomTiles);
+		FIntVector roomPosition = room.SpawnedRoom->GetRoomTileSpacePosition();
+		roomPosition.Z = DungeonLevel;
+		for (const FIntVector& tile : roomTiles)
+		{
+			tileTypes.Add(roomPosition + tile);
 		}
 	}
 	return tileTypes;
@@ -212,7 +234,7 @@ ADungeonRoom* UDungeonFloorManager::CreateRoom(const FFloorRoom& Room, FRandomSt
 	return room;
 }
 
-FDungeonFloor UDungeonFloorManager::GetDungeonFloor() const
+const FDungeonFloor& UDungeonFloorManager::GetDungeonFloor() const
 {
 	return DungeonSpaceGenerator->DungeonSpace[DungeonLevel];
 }
@@ -229,6 +251,19 @@ void UDungeonFloorManager::DoTileReplacement(ADungeonRoom* Room, FRandomStream&
 
 void UDungeonFloorManager::DoFloorWideTileReplacement(TArray<FRoomReplacements> ReplacementPhases, FRandomStream &Rng)
 {
+	if (ReplacementPhases.Num() == 0)
+	{
+		return;
+	}
+	// Replacements check against these as they go, so they don't wall off any entrances
+	for (const FFloorRoom& room : DungeonSpaceGenerator->DungeonSpace[DungeonLevel].Rooms)
+	{
+		if (room.SpawnedRoom != NULL)
+		{
+			room.SpawnedRoom->EntranceConnectivity.Initialize(room.SpawnedRoom->RoomTiles, room.SpawnedRoom->EntranceLocations);
+		}
+	}
+
 	// Replace them based on our replacement rules
 	for (int i = 0; i < ReplacementPhases.Num(); i++)
 	{
@@ -243,4 +278,54 @@ void UDungeonFloorManager::DoFloorWideTileReplacement(TArray<FRoomReplacements>
 			}
 		}
 	}
+}
+
+void UDungeonFloorManager::DoFloorWideAutotiling()
+{
+	if (Autotiler == NULL)
+	{
+		return;
+	}
+
+	// Work out every room's variants before changing any, so each room sees its neighbors as they were
+	TArray<ADungeonRoom*> rooms;
+	TArray<TArray<const UDungeonTile*>> roomVariants;
+	TArray<const UDungeonTile*> paddedTiles;
+	for (const FFloorRoom& room : GetDungeonFloor().Rooms)
+	{
+		ADungeonRoom* spawnedRoom = room.SpawnedRoom;
+		if (spawnedRoom == NULL)
+		{
+			continue;
+		}
+		int32 width = spawnedRoom->XSize();
+		int32 height = spawnedRoom->YSize();
+		FIntVector roomLocation = room.Location * RoomSize;
+		roomLocation.Z = room.Location.Z;
+
+		// The room's tiles, with a border of whatever's next to it
+		paddedTiles.SetNumUninitialized((width + 2) * (height + 2));
+		for (int32 y = -1; y <= height; y++)
+		{
+			for (int32 x = -1; x <= width; x++)
+			{
+				bool bInRoom = x >= 0 && y >= 0 && x < width && y < height;
+				paddedTiles[(y + 1) * (width + 2) + x + 1] = bInRoom ? spawnedRoom->GetTile(x, y) :
+					GetTileFromTileSpace(roomLocation + FIntVector(x, y, 0));
+			}
+		}
+
+		rooms.Add(spawnedRoom);
+		int32 index = roomVariants.AddDefaulted();
+		Autotiler->Autotile(paddedTiles, width + 2, height + 2, roomVariants[index]);
+	}
+
+	for (int32 i = 0; i < rooms.Num(); i++)
+	{
+		int32 width = rooms[i]->XSize();
+		for (int32 tile = 0; tile < roomVariants[i].Num(); tile++)
+		{
+			rooms[i]->Set(tile % width, tile / width, roomVariants[i][tile]);
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,450 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonLayoutSolver.h"
+#include "DungeonMissionNode.h"
+#include "DungeonMissionSymbol.h"
+#include "DungeonMissionGraphAnalysis.h"
+#include "DungeonRoom.h"
+
+// Directions are stored so that flipping the lowest bit gives the opposite direction
+static const FIntVector DIRECTIONS[4] = { FIntVector(1, 0, 0), FIntVector(-1, 0, 0), FIntVector(0, 1, 0), FIntVector(0, -1, 0) };
+
+FDungeonLayoutSolver::FDungeonLayoutSolver()
+{
+	FreeCellCount = 0;
+	StartCell = INVALID_INDEX;
+	StepCount = 0;
+	BacktrackCount = 0;
+}
+
+void FDungeonLayoutSolver::Initialize(const TArray<FDungeonFloor>& DungeonSpace)
+{
+	FloorXSizes.SetNum(DungeonSpace.Num());
+	FloorYSizes.SetNum(DungeonSpace.Num());
+	FloorOffsets.SetNum(DungeonSpace.Num() + 1);
+	FloorOffsets[0] = 0;
+	for (int z = 0; z < DungeonSpace.Num(); z++)
+	{
+		FloorXSizes[z] = DungeonSpace[z].XSize();
+		FloorYSizes[z] = DungeonSpace[z].YSize();
+		FloorOffsets[z + 1] = FloorOffsets[z] + FloorXSizes[z] * FloorYSizes[z];
+	}
+
+	int32 cellCount = FloorOffsets[DungeonSpace.Num()];
+	CellNeighbors.SetNumUninitialized(cellCount * 4);
+	for (int32 cell = 0; cell < cellCount; cell++)
+	{
+		FIntVector location = ToLocation(cell);
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			CellNeighbors[cell * 4 + direction] = ToCell(location + DIRECTIONS[direction]);
+		}
+	}
+
+	ClearGrid();
+}
+
+void FDungeonLayoutSolver::ClearGrid()
+{
+	int32 cellCount = FloorOffsets.Num() > 0 ? FloorOffsets.Last() : 0;
+	FreeNeighbors.SetNumUninitialized(cellCount);
+	for (int32 cell = 0; cell < cellCount; cell++)
+	{
+		uint8 neighbors = 0;
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			if (GetNeighbor(cell, direction) != INVALID_INDEX)
+			{
+				neighbors |= 1 << direction;
+			}
+		}
+		FreeNeighbors[cell] = neighbors;
+	}
+	OpenNeighbors.Init(0, cellCount);
+	CellStep.Init(INVALID_INDEX, cellCount);
+	FreeCellCount = cellCount;
+}
+
+int32 FDungeonLayoutSolver::ToCell(const FIntVector& Location) const
+{
+	if (Location.Z < 0 || Location.Z >= FloorXSizes.Num())
+	{
+		return INVALID_INDEX;
+	}
+	if (Location.X < 0 || Location.Y < 0 || Location.X >= FloorXSizes[Location.Z] || Location.Y >= FloorYSizes[Location.Z])
+	{
+		return INVALID_INDEX;
+	}
+	return FloorOffsets[Location.Z] + Location.Y * FloorXSizes[Location.Z] + Location.X;
+}
+
+FIntVector FDungeonLayoutSolver::ToLocation(int32 Cell) const
+{
+	int32 z = 0;
+	while (Cell >= FloorOffsets[z + 1])
+	{
+		z++;
+	}
+	int32 floorCell = Cell - FloorOffsets[z];
+	return FIntVector(floorCell % FloorXSizes[z], floorCell / FloorXSizes[z], z);
+}
+
+void FDungeonLayoutSolver::OrderNodes(const FDungeonMissionGraphAnalysis& Mission)
+{
+	int32 nodeCount = Mission.Num();
+	Order.Reset(nodeCount);
+	Anchors.Reset(nodeCount);
+	AllowsChildren.Reset(nodeCount);
+	ParentSteps.Reset(nodeCount);
+
+	TArray<int32> stepOf;
+	stepOf.Init(INVALID_INDEX, nodeCount);
+	TArray<int32> remainingParents;
+	remainingParents.SetNumUninitialized(nodeCount);
+	TArray<int32> tightChildCount;
+	tightChildCount.SetNumZeroed(nodeCount);
+	for (int32 i = 0; i < nodeCount; i++)
+	{
+		remainingParents[i] = Mission.GetParentCount(i);
+		for (int32 j = 0; j < Mission.GetChildCount(i); j++)
+		{
+			if (Mission.GetNode(Mission.GetChild(i, j))->bTightlyCoupledToParent)
+			{
+				tightChildCount[i]++;
+			}
+		}
+	}
+
+	auto byRank = [&Mission](int32 A, int32 B)
+	{
+		return Mission.GetTopologicalRank(A) < Mission.GetTopologicalRank(B);
+	};
+	auto mostConstrained = [&tightChildCount](int32 A, int32 B)
+	{
+		return tightChildCount[A] > tightChildCount[B];
+	};
+
+	// Tightly-coupled nodes go right after the node they have to be next to, so a bad spot
+	// for the parent gets noticed as early as possible.
+	TArray<int32> tightQueue;
+	int32 nextTightNode = 0;
+	TArray<int32> anchorNodes;
+	anchorNodes.Init(INVALID_INDEX, nodeCount);
+	TArray<int32> ready;
+	ready.Add(0);
+	int32 nextInTopologicalOrder = 0;
+	TArray<int32> readyTight;
+
+	while (Order.Num() < nodeCount)
+	{
+		int32 node;
+		if (nextTightNode < tightQueue.Num())
+		{
+			node = tightQueue[nextTightNode++];
+		}
+		else if (ready.Num() > 0)
+		{
+			ready.HeapPop(node, byRank);
+		}
+		else
+		{
+			// Only nodes in a cycle are left, which will never have all their parents placed
+			const TArray<int32>& topologicalOrder = Mission.GetTopologicalOrder();
+			while (stepOf[topologicalOrder[nextInTopologicalOrder]] != INVALID_INDEX)
+			{
+				nextInTopologicalOrder++;
+			}
+			node = topologicalOrder[nextInTopologicalOrder];
+		}
+		if (stepOf[node] != INVALID_INDEX)
+		{
+			continue;
+		}
+
+		UDungeonMissionNode* missionNode = (UDungeonMissionNode*)Mission.GetNode(node);
+		int32 step = Order.Add(missionNode);
+		stepOf[node] = step;
+		Anchors.Add(anchorNodes[node] != INVALID_INDEX ? stepOf[anchorNodes[node]] : INVALID_INDEX);
+		AllowsChildren.Add(((UDungeonMissionSymbol*)missionNode->NodeType)->bAllowedToHaveChildren);
+		TArray<int32>& parentSteps = ParentSteps[ParentSteps.AddDefaulted()];
+		for (int32 i = 0; i < Mission.GetParentCount(node); i++)
+		{
+			int32 parent = Mission.GetParent(node, i);
+			if (stepOf[parent] != INVALID_INDEX)
+			{
+				parentSteps.AddUnique(stepOf[parent]);
+			}
+		}
+
+		readyTight.Reset();
+		for (int32 i = 0; i < Mission.GetChildCount(node); i++)
+		{
+			int32 child = Mission.GetChild(node, i);
+			remainingParents[child]--;
+			if (remainingParents[child] != 0 || stepOf[child] != INVALID_INDEX)
+			{
+				continue;
+			}
+			if (Mission.GetNode(child)->bTightlyCoupledToParent)
+			{
+				anchorNodes[child] = node;
+				readyTight.Add(child);
+			}
+			else
+			{
+				ready.HeapPush(child, byRank);
+			}
+		}
+		readyTight.StableSort(mostConstrained);
+		tightQueue.Append(readyTight);
+	}
+
+	PendingTightNodes.Init(0, nodeCount);
+	for (int32 anchor : Anchors)
+	{
+		if (anchor != INVALID_INDEX)
+		{
+			PendingTightNodes[anchor]++;
+		}
+	}
+	Candidates.SetNum(nodeCount);
+	NextCandidate.Init(0, nodeCount);
+	StepCells.Init(INVALID_INDEX, nodeCount);
+	StepEntrances.Init(INVALID_INDEX, nodeCount);
+}
+
+bool FDungeonLayoutSolver::Solve(const FDungeonMissionGraphAnalysis& Mission, FIntVector StartLocation,
+	FRandomStream& Rng, int32 MaxSteps)
+{
+	Placements.Reset();
+	StepCount = 0;
+	BacktrackCount = 0;
+	ClearGrid();
+
+	StartCell = ToCell(StartLocation);
+	if (Mission.Num() == 0 || StartCell == INVALID_INDEX)
+	{
+		return false;
+	}
+
+	OrderNodes(Mission);
+	if (Order.Num() > FreeCellCount)
+	{
+		UE_LOG(LogSpaceGen, Warning, TEXT("There are %d rooms to place, but only space for %d."), Order.Num(), FreeCellCount);
+		return false;
+	}
+
+	int32 step = 0;
+	FindCandidates(step, Rng);
+	while (step >= 0 && step < Order.Num())
+	{
+		if (NextCandidate[step] >= Candidates[step].Num())
+		{
+			// Nowhere left for this node to go; move the node before it instead
+			step--;
+			if (step >= 0)
+			{
+				Unplace(step);
+				BacktrackCount++;
+			}
+			continue;
+		}
+		if (ShouldCancel && (StepCount & 63) == 0 && ShouldCancel())
+		{
+			UE_LOG(LogSpaceGen, Log, TEXT("Layout was cancelled after %d placements."), StepCount);
+			return false;
+		}
+		if (StepCount >= MaxSteps)
+		{
+			UE_LOG(LogSpaceGen, Warning, TEXT("Gave up on laying out rooms after %d placements (%d backtracks)."), StepCount, BacktrackCount);
+			return false;
+		}
+
+		StepCount++;
+		int32 cell = Candidates[step][NextCandidate[step]++];
+		Place(step, cell);
+		if (!IsConsistent(cell))
+		{
+			Unplace(step);
+			continue;
+		}
+
+		step++;
+		if (step < Order.Num())
+		{
+			FindCandidates(step, Rng);
+		}
+	}
+
+	if (step < 0)
+	{
+		UE_LOG(LogSpaceGen, Warning, TEXT("There's no way to lay out these rooms. Tried %d placements."), StepCount);
+		return false;
+	}
+
+	Placements.SetNum(Order.Num());
+	for (int32 i = 0; i < Order.Num(); i++)
+	{
+		FDungeonLayoutPlacement& placement = Placements[i];
+		placement.Node = Order[i];
+		placement.Location = ToLocation(StepCells[i]);
+		placement.EntranceLocation = StepEntrances[i] != INVALID_INDEX ? ToLocation(StepEntrances[i]) : FIntVector(-1, -1, -1);
+		placement.bIsTightlyCoupled = Anchors[i] != INVALID_INDEX;
+	}
+	UE_LOG(LogSpaceGen, Log, TEXT("Laid out %d rooms in %d placements (%d backtracks)."), Order.Num(), StepCount, BacktrackCount);
+	return true;
+}
+
+void FDungeonLayoutSolver::FindCandidates(int32 Step, FRandomStream& Rng)
+{
+	TArray<int32>& candidates = Candidates[Step];
+	candidates.Reset();
+	NextCandidate[Step] = 0;
+
+	if (Step == 0)
+	{
+		candidates.Add(StartCell);
+	}
+	else if (Anchors[Step] != INVALID_INDEX)
+	{
+		// Has to go right next to its parent
+		int32 anchorCell = StepCells[Anchors[Step]];
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			if (FreeNeighbors[anchorCell] & (1 << direction))
+			{
+				candidates.Add(GetNeighbor(anchorCell, direction));
+			}
+		}
+	}
+	else
+	{
+		// Can go anywhere next to a room which allows children
+		for (int32 cell = 0; cell < CellStep.Num(); cell++)
+		{
+			if (CellStep[cell] == INVALID_INDEX && OpenNeighbors[cell] > 0)
+			{
+				candidates.Add(cell);
+			}
+		}
+	}
+
+	for (int32 i = candidates.Num() - 1; i > 0; i--)
+	{
+		candidates.Swap(i, Rng.RandRange(0, i));
+	}
+}
+
+void FDungeonLayoutSolver::Place(int32 Step, int32 Cell)
+{
+	StepCells[Step] = Cell;
+	CellStep[Cell] = Step;
+	FreeCellCount--;
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		int32 neighbor = GetNeighbor(Cell, direction);
+		if (neighbor == INVALID_INDEX)
+		{
+			continue;
+		}
+		FreeNeighbors[neighbor] &= ~(1 << (direction ^ 1));
+		if (AllowsChildren[Step])
+		{
+			OpenNeighbors[neighbor]++;
+		}
+	}
+	if (Anchors[Step] != INVALID_INDEX)
+	{
+		PendingTightNodes[Anchors[Step]]--;
+	}
+	StepEntrances[Step] = FindEntrance(Step, Cell);
+}
+
+void FDungeonLayoutSolver::Unplace(int32 Step)
+{
+	int32 cell = StepCells[Step];
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		int32 neighbor = GetNeighbor(cell, direction);
+		if (neighbor == INVALID_INDEX)
+		{
+			continue;
+		}
+		FreeNeighbors[neighbor] |= 1 << (direction ^ 1);
+		if (AllowsChildren[Step])
+		{
+			OpenNeighbors[neighbor]--;
+		}
+	}
+	if (Anchors[Step] != INVALID_INDEX)
+	{
+		PendingTightNodes[Anchors[Step]]++;
+	}
+	CellStep[cell] = INVALID_INDEX;
+	FreeCellCount++;
+	StepCells[Step] = INVALID_INDEX;
+	StepEntrances[Step] = INVALID_INDEX;
+}
+
+bool FDungeonLayoutSolver::IsConsistent(int32 Cell) const
+{
+	int32 step = CellStep[Cell];
+	if (CountFreeNeighbors(Cell) < PendingTightNodes[step])
+	{
+		// Not enough room around us for our own tightly-coupled nodes
+		return false;
+	}
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		int32 neighbor = GetNeighbor(Cell, direction);
+		if (neighbor == INVALID_INDEX || CellStep[neighbor] == INVALID_INDEX)
+		{
+			continue;
+		}
+		if (CountFreeNeighbors(neighbor) < PendingTightNodes[CellStep[neighbor]])
+		{
+			// We took a spot one of our neighbors was counting on
+			return false;
+		}
+	}
+	return FreeCellCount >= Order.Num() - step - 1;
+}
+
+int32 FDungeonLayoutSolver::FindEntrance(int32 Step, int32 Cell) const
+{
+	if (Step == 0)
+	{
+		return INVALID_INDEX;
+	}
+	if (Anchors[Step] != INVALID_INDEX)
+	{
+		return StepCells[Anchors[Step]];
+	}
+
+	// Prefer to be entered from our parent; otherwise, from whichever room was placed last
+	int32 entrance = INVALID_INDEX;
+	int32 entranceStep = INVALID_INDEX;
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		int32 neighbor = GetNeighbor(Cell, direction);
+		if (neighbor == INVALID_INDEX)
+		{
+			continue;
+		}
+		int32 neighborStep = CellStep[neighbor];
+		if (neighborStep == INVALID_INDEX || !AllowsChildren[neighborStep])
+		{
+			continue;
+		}
+		if (ParentSteps[Step].Contains(neighborStep))
+		{
+			return neighbor;
+		}
+		if (neighborStep > entranceStep)
+		{
+			entrance = neighbor;
+			entranceStep = neighborStep;
+		}
+	}
+	return entrance;
+}
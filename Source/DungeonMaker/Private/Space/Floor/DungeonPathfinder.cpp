@@ -0,0 +1,512 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonPathfinder.h"
+#include "DungeonSpaceGenerator.h"
+#include "DungeonRoom.h"
+#include "Algo/Reverse.h"
+
+static const FIntVector STEPS[4] = { FIntVector(1, 0, 0), FIntVector(-1, 0, 0), FIntVector(0, 1, 0), FIntVector(0, -1, 0) };
+
+struct FSearchNode
+{
+	int32 Cost;
+	int32 Index;
+
+	bool operator<(const FSearchNode& Other) const
+	{
+		return Cost < Other.Cost;
+	}
+};
+
+FDungeonPathfinder::FDungeonPathfinder()
+{
+	MaxCachedFlowFields = 8;
+	Reset();
+}
+
+void FDungeonPathfinder::Reset()
+{
+	Grid = NULL;
+	RoomSize = 0;
+	Rooms.Reset();
+	RoomIndices.Reset();
+	Portals.Reset();
+	PortalVersion = 0;
+	FlowFields.Reset();
+	FlowFieldClock = 0;
+	SearchCosts.Reset();
+	SearchParents.Reset();
+	SearchStamps.Reset();
+	SearchStamp = 0;
+}
+
+void FDungeonPathfinder::Initialize(const UDungeonSpaceGenerator* SpaceGenerator)
+{
+	Reset();
+	Grid = &SpaceGenerator->TileGrid;
+	RoomSize = SpaceGenerator->RoomSize;
+
+	TMap<FIntVector, int32> portalAt;
+	for (const FDungeonFloor& floor : SpaceGenerator->DungeonSpace)
+	{
+		for (const FFloorRoom& room : floor.Rooms)
+		{
+			if (room.SpawnedRoom == NULL)
+			{
+				continue;
+			}
+			int32 roomIndex = Rooms.AddDefaulted();
+			Rooms[roomIndex].Location = room.Location;
+			RoomIndices.Add(room.Location, roomIndex);
+
+			FIntVector origin(room.Location.X * RoomSize, room.Location.Y * RoomSize, room.Location.Z);
+			for (const FIntVector& entrance : room.SpawnedRoom->EntranceLocations)
+			{
+				FPortal portal;
+				portal.Tile = FIntVector(origin.X + entrance.X, origin.Y + entrance.Y, origin.Z);
+				portal.Room = roomIndex;
+				portal.LinkedPortal = INVALID_INDEX;
+				int32 portalIndex = Portals.Add(portal);
+				Rooms[roomIndex].Portals.Add(portalIndex);
+				portalAt.Add(portal.Tile, portalIndex);
+			}
+		}
+	}
+
+	// Entrances are placed in pairs, on either side of the wall between two rooms
+	for (FPortal& portal : Portals)
+	{
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			int32* other = portalAt.Find(portal.Tile + STEPS[direction]);
+			if (other != NULL && Portals[*other].Room != portal.Room)
+			{
+				portal.LinkedPortal = *other;
+				break;
+			}
+		}
+	}
+
+	for (int32 room = 0; room < Rooms.Num(); room++)
+	{
+		BuildRoom(room);
+	}
+	PortalVersion = Grid->GetVersion();
+}
+
+int32 FDungeonPathfinder::FindRoom(const FIntVector& TileSpaceLocation) const
+{
+	if (Grid == NULL || RoomSize <= 0 || !Grid->IsLocationValid(TileSpaceLocation))
+	{
+		return INVALID_INDEX;
+	}
+	FIntVector roomLocation(TileSpaceLocation.X / RoomSize, TileSpaceLocation.Y / RoomSize, TileSpaceLocation.Z);
+	const int32* room = RoomIndices.Find(roomLocation);
+	return room == NULL ? INVALID_INDEX : *room;
+}
+
+bool FDungeonPathfinder::IsWalkable(const FIntVector& TileSpaceLocation) const
+{
+	return Grid != NULL && Grid->IsTileOfType(TileSpaceLocation, ETileType::Floor);
+}
+
+void FDungeonPathfinder::FloodFill(const FIntVector& Start, int32 Room, TArray<int32>& Distances) const
+{
+	// When limited to a room, distances are indexed by tile within the room instead
+	int32 minX = 0;
+	int32 minY = 0;
+	int32 width = Grid->XSize(Start.Z);
+	int32 height = Grid->YSize(Start.Z);
+	if (Room != INVALID_INDEX)
+	{
+		minX = Rooms[Room].Location.X * RoomSize;
+		minY = Rooms[Room].Location.Y * RoomSize;
+		width = FMath::Min(RoomSize, width - minX);
+		height = FMath::Min(RoomSize, height - minY);
+	}
+	Distances.Init(INVALID_INDEX, width * height);
+	if (!IsWalkable(Start) || Start.X < minX || Start.Y < minY || Start.X >= minX + width || Start.Y >= minY + height)
+	{
+		return;
+	}
+
+	const TBitArray<>& walkable = Grid->GetLayer(Start.Z, ETileType::Floor);
+	int32 floorWidth = Grid->XSize(Start.Z);
+	TArray<int32> queue;
+	queue.Reserve(width * height);
+	int32 startIndex = (Start.Y - minY) * width + (Start.X - minX);
+	Distances[startIndex] = 0;
+	queue.Add(startIndex);
+	for (int32 next = 0; next < queue.Num(); next++)
+	{
+		int32 current = queue[next];
+		int32 x = current % width;
+		int32 y = current / width;
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			int32 neighborX = x + STEPS[direction].X;
+			int32 neighborY = y + STEPS[direction].Y;
+			if (neighborX < 0 || neighborY < 0 || neighborX >= width || neighborY >= height)
+			{
+				continue;
+			}
+			int32 neighbor = neighborY * width + neighborX;
+			if (Distances[neighbor] != INVALID_INDEX || !walkable[(neighborY + minY) * floorWidth + neighborX + minX])
+			{
+				continue;
+			}
+			Distances[neighbor] = Distances[current] + 1;
+			queue.Add(neighbor);
+		}
+	}
+}
+
+void FDungeonPathfinder::UpdatePortalGraph()
+{
+	if (PortalVersion == Grid->GetVersion())
+	{
+		return;
+	}
+	PortalVersion = Grid->GetVersion();
+
+	int32 rebuiltRooms = 0;
+	for (int32 room = 0; room < Rooms.Num(); room++)
+	{
+		if (Rooms[room].Version != Grid->GetRoomVersion(Rooms[room].Location))
+		{
+			BuildRoom(room);
+			rebuiltRooms++;
+		}
+	}
+	UE_LOG(LogSpaceGen, Verbose, TEXT("Rebuilt pathfinding for %d of %d rooms."), rebuiltRooms, Rooms.Num());
+}
+
+void FDungeonPathfinder::BuildRoom(int32 Room)
+{
+	FRoomNode& node = Rooms[Room];
+	node.Version = Grid->GetRoomVersion(node.Location);
+	int32 portalCount = node.Portals.Num();
+	node.PortalDistances.Init(INVALID_INDEX, portalCount * portalCount);
+	FIntVector origin(node.Location.X * RoomSize, node.Location.Y * RoomSize, 0);
+	TArray<int32> distances;
+	for (int32 i = 0; i < portalCount; i++)
+	{
+		FloodFill(Portals[node.Portals[i]].Tile, Room, distances);
+		for (int32 j = 0; j < portalCount; j++)
+		{
+			const FIntVector& tile = Portals[node.Portals[j]].Tile;
+			node.PortalDistances[i * portalCount + j] = distances[(tile.Y - origin.Y) * RoomSize + (tile.X - origin.X)];
+		}
+	}
+}
+
+bool FDungeonPathfinder::FindRoomRoute(const FIntVector& Start, int32 StartRoom, const FIntVector& Goal, int32 GoalRoom,
+	TBitArray<>& OutRooms)
+{
+	TArray<int32> startDistances;
+	TArray<int32> goalDistances;
+	FloodFill(Start, StartRoom, startDistances);
+	FloodFill(Goal, GoalRoom, goalDistances);
+	auto localIndex = [this](int32 Room, const FIntVector& Tile)
+	{
+		return (Tile.Y - Rooms[Room].Location.Y * RoomSize) * RoomSize + (Tile.X - Rooms[Room].Location.X * RoomSize);
+	};
+
+	// Dijkstra over the portals
+	TArray<int32> costs;
+	costs.Init(MAX_int32, Portals.Num());
+	TArray<int32> parents;
+	parents.Init(INVALID_INDEX, Portals.Num());
+	TArray<FSearchNode> open;
+	for (int32 portal : Rooms[StartRoom].Portals)
+	{
+		int32 distance = startDistances[localIndex(StartRoom, Portals[portal].Tile)];
+		if (distance != INVALID_INDEX)
+		{
+			costs[portal] = distance;
+			open.HeapPush({ distance, portal });
+		}
+	}
+
+	int32 bestCost = MAX_int32;
+	int32 bestPortal = INVALID_INDEX;
+	while (open.Num() > 0)
+	{
+		FSearchNode current;
+		open.HeapPop(current);
+		if (current.Cost >= bestCost)
+		{
+			break;
+		}
+		if (current.Cost > costs[current.Index])
+		{
+			continue;
+		}
+
+		const FPortal& portal = Portals[current.Index];
+		if (portal.Room == GoalRoom)
+		{
+			int32 remaining = goalDistances[localIndex(GoalRoom, portal.Tile)];
+			if (remaining != INVALID_INDEX && current.Cost + remaining < bestCost)
+			{
+				bestCost = current.Cost + remaining;
+				bestPortal = current.Index;
+			}
+		}
+
+		auto relax = [&](int32 Next, int32 Cost)
+		{
+			if (Cost < costs[Next])
+			{
+				costs[Next] = Cost;
+				parents[Next] = current.Index;
+				open.HeapPush({ Cost, Next });
+			}
+		};
+		if (portal.LinkedPortal != INVALID_INDEX)
+		{
+			relax(portal.LinkedPortal, current.Cost + 1);
+		}
+		const FRoomNode& room = Rooms[portal.Room];
+		int32 from = room.Portals.IndexOfByKey(current.Index);
+		for (int32 to = 0; to < room.Portals.Num(); to++)
+		{
+			int32 distance = room.PortalDistances[from * room.Portals.Num() + to];
+			if (to != from && distance != INVALID_INDEX)
+			{
+				relax(room.Portals[to], current.Cost + distance);
+			}
+		}
+	}
+
+	if (bestPortal == INVALID_INDEX)
+	{
+		return false;
+	}
+	OutRooms.Init(false, Rooms.Num());
+	OutRooms[StartRoom] = true;
+	for (int32 portal = bestPortal; portal != INVALID_INDEX; portal = parents[portal])
+	{
+		OutRooms[Portals[portal].Room] = true;
+	}
+	return true;
+}
+
+bool FDungeonPathfinder::FindTilePath(const FIntVector& Start, const FIntVector& Goal, const TBitArray<>* AllowedRooms,
+	TArray<FIntVector>& OutPath)
+{
+	int32 width = Grid->XSize(Start.Z);
+	int32 height = Grid->YSize(Start.Z);
+	int32 tileCount = width * height;
+	if (SearchStamps.Num() != tileCount)
+	{
+		SearchCosts.SetNumUninitialized(tileCount);
+		SearchParents.SetNumUninitialized(tileCount);
+		SearchStamps.Init(0, tileCount);
+		SearchStamp = 0;
+	}
+	SearchStamp++;
+	if (SearchStamp == 0)
+	{
+		// Wrapped around, so old stamps could look current
+		SearchStamps.Init(0, tileCount);
+		SearchStamp = 1;
+	}
+
+	const TBitArray<>& walkable = Grid->GetLayer(Start.Z, ETileType::Floor);
+	auto heuristic = [&Goal](int32 X, int32 Y)
+	{
+		return FMath::Abs(X - Goal.X) + FMath::Abs(Y - Goal.Y);
+	};
+
+	int32 startIndex = Start.Y * width + Start.X;
+	int32 goalIndex = Goal.Y * width + Goal.X;
+	SearchStamps[startIndex] = SearchStamp;
+	SearchCosts[startIndex] = 0;
+	SearchParents[startIndex] = INVALID_INDEX;
+	TArray<FSearchNode> open;
+	open.HeapPush({ heuristic(Start.X, Start.Y), startIndex });
+
+	bool bFoundGoal = false;
+	while (open.Num() > 0)
+	{
+		FSearchNode current;
+		open.HeapPop(current);
+		if (current.Index == goalIndex)
+		{
+			bFoundGoal = true;
+			break;
+		}
+		int32 x = current.Index % width;
+		int32 y = current.Index / width;
+		if (current.Cost - heuristic(x, y) > SearchCosts[current.Index])
+		{
+			// We've already been here more cheaply
+			continue;
+		}
+
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			int32 neighborX = x + STEPS[direction].X;
+			int32 neighborY = y + STEPS[direction].Y;
+			if (neighborX < 0 || neighborY < 0 || neighborX >= width || neighborY >= height)
+			{
+				continue;
+			}
+			int32 neighbor = neighborY * width + neighborX;
+			if (!walkable[neighbor])
+			{
+				continue;
+			}
+			int32 cost = SearchCosts[current.Index] + 1;
+			if (SearchStamps[neighbor] == SearchStamp && SearchCosts[neighbor] <= cost)
+			{
+				continue;
+			}
+			if (AllowedRooms != NULL)
+			{
+				int32 room = FindRoom(FIntVector(neighborX, neighborY, Start.Z));
+				if (room == INVALID_INDEX || !(*AllowedRooms)[room])
+				{
+					continue;
+				}
+			}
+			SearchStamps[neighbor] = SearchStamp;
+			SearchCosts[neighbor] = cost;
+			SearchParents[neighbor] = current.Index;
+			open.HeapPush({ cost + heuristic(neighborX, neighborY), neighbor });
+		}
+	}
+
+	if (!bFoundGoal)
+	{
+		return false;
+	}
+	OutPath.Reset();
+	for (int32 tile = goalIndex; tile != INVALID_INDEX; tile = SearchParents[tile])
+	{
+		OutPath.Add(FIntVector(tile % width, tile / width, Start.Z));
+	}
+	Algo::Reverse(OutPath);
+	return true;
+}
+
+bool FDungeonPathfinder::FindPath(const FIntVector& Start, const FIntVector& Goal, TArray<FIntVector>& OutPath)
+{
+	OutPath.Reset();
+	if (Start.Z != Goal.Z || !IsWalkable(Start) || !IsWalkable(Goal))
+	{
+		return false;
+	}
+
+	int32 startRoom = FindRoom(Start);
+	int32 goalRoom = FindRoom(Goal);
+	if (startRoom != INVALID_INDEX && goalRoom != INVALID_INDEX)
+	{
+		TBitArray<> allowedRooms;
+		bool bHasRoute = true;
+		if (startRoom == goalRoom)
+		{
+			allowedRooms.Init(false, Rooms.Num());
+			allowedRooms[startRoom] = true;
+		}
+		else
+		{
+			UpdatePortalGraph();
+			bHasRoute = FindRoomRoute(Start, startRoom, Goal, goalRoom, allowedRooms);
+		}
+		if (bHasRoute && FindTilePath(Start, Goal, &allowedRooms, OutPath))
+		{
+			return true;
+		}
+	}
+
+	// The portals couldn't get us there, so fall back to searching the whole floor
+	return FindTilePath(Start, Goal, NULL, OutPath);
+}
+
+const FDungeonPathfinder::FFlowField* FDungeonPathfinder::GetFlowField(const FIntVector& Target)
+{
+	if (Grid == NULL || !Grid->IsLocationValid(Target))
+	{
+		return NULL;
+	}
+	FlowFieldClock++;
+
+	FFlowField* field = FlowFields.FindByPredicate([&Target](const FFlowField& Field)
+	{
+		return Field.Target == Target;
+	});
+	if (field == NULL)
+	{
+		if (FlowFields.Num() < FMath::Max(MaxCachedFlowFields, 1))
+		{
+			field = &FlowFields[FlowFields.AddDefaulted()];
+		}
+		else
+		{
+			// Replace whichever field was used least recently
+			field = &FlowFields[0];
+			for (FFlowField& other : FlowFields)
+			{
+				if (other.LastUsed < field->LastUsed)
+				{
+					field = &other;
+				}
+			}
+		}
+		field->Target = Target;
+		field->Version = Grid->GetVersion() + 1;
+	}
+
+	if (field->Version != Grid->GetVersion())
+	{
+		FloodFill(Target, INVALID_INDEX, field->Distances);
+		field->Version = Grid->GetVersion();
+	}
+	field->LastUsed = FlowFieldClock;
+	return field;
+}
+
+int32 FDungeonPathfinder::GetFlowDistance(const FIntVector& Target, const FIntVector& From)
+{
+	const FFlowField* field = GetFlowField(Target);
+	if (field == NULL || From.Z != Target.Z || !Grid->IsLocationValid(From))
+	{
+		return INVALID_INDEX;
+	}
+	return field->Distances[From.Y * Grid->XSize(From.Z) + From.X];
+}
+
+FIntVector FDungeonPathfinder::GetFlowDirection(const FIntVector& Target, const FIntVector& From)
+{
+	const FFlowField* field = GetFlowField(Target);
+	if (field == NULL || From.Z != Target.Z || !Grid->IsLocationValid(From))
+	{
+		return From;
+	}
+
+	int32 width = Grid->XSize(From.Z);
+	int32 height = Grid->YSize(From.Z);
+	int32 bestDistance = field->Distances[From.Y * width + From.X];
+	if (bestDistance == INVALID_INDEX)
+	{
+		return From;
+	}
+	FIntVector bestStep = From;
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		FIntVector neighbor = From + STEPS[direction];
+		if (neighbor.X < 0 || neighbor.Y < 0 || neighbor.X >= width || neighbor.Y >= height)
+		{
+			continue;
+		}
+		int32 distance = field->Distances[neighbor.Y * width + neighbor.X];
+		if (distance != INVALID_INDEX && distance < bestDistance)
+		{
+			bestDistance = distance;
+			bestStep = neighbor;
+		}
+	}
+	return bestStep;
+}
@@ -0,0 +1,277 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonSolvabilityAnalyzer.h"
+#include "DungeonMissionNode.h"
+#include "DungeonMissionGraphAnalysis.h"
+#include "DungeonRoom.h"
+#include "LockedRoom.h"
+#include "KeyRoom.h"
+#include "Algo/Reverse.h"
+
+bool FDungeonSolvabilityAnalyzer::IsKeyRoom(const FFloorRoom& Room)
+{
+	return Room.RoomClass != NULL && Room.RoomClass->ImplementsInterface(UKeyRoom::StaticClass());
+}
+
+bool FDungeonSolvabilityAnalyzer::IsLockedRoom(const FFloorRoom& Room)
+{
+	return Room.RoomClass != NULL && Room.RoomClass->ImplementsInterface(ULockedRoom::StaticClass());
+}
+
+FDungeonSolvabilityReport FDungeonSolvabilityAnalyzer::Analyze(const TArray<FDungeonFloor>& DungeonSpace,
+	UDungeonMissionNode* Head, const UGraphNode* GoalSymbol)
+{
+	FDungeonSolvabilityReport report;
+	if (Head == NULL)
+	{
+		return report;
+	}
+
+	FDungeonMissionGraphAnalysis missionAnalysis;
+	missionAnalysis.Build(Head);
+
+	// Give every room a flat index
+	TArray<int32> floorOffsets;
+	floorOffsets.SetNumUninitialized(DungeonSpace.Num() + 1);
+	floorOffsets[0] = 0;
+	for (int z = 0; z < DungeonSpace.Num(); z++)
+	{
+		floorOffsets[z + 1] = floorOffsets[z] + DungeonSpace[z].XSize() * DungeonSpace[z].YSize();
+	}
+	int32 roomCount = floorOffsets[DungeonSpace.Num()];
+
+	auto toIndex = [&DungeonSpace, &floorOffsets](const FIntVector& Location)
+	{
+		if (Location.Z < 0 || Location.Z >= DungeonSpace.Num())
+		{
+			return (int32)INDEX_NONE;
+		}
+		const FDungeonFloor& floor = DungeonSpace[Location.Z];
+		if (Location.X < 0 || Location.Y < 0 || Location.X >= floor.XSize() || Location.Y >= floor.YSize())
+		{
+			return (int32)INDEX_NONE;
+		}
+		return floorOffsets[Location.Z] + Location.Y * floor.XSize() + Location.X;
+	};
+
+	TArray<const FFloorRoom*> rooms;
+	rooms.SetNumZeroed(roomCount);
+	TArray<int32> missionRank;
+	missionRank.SetNumUninitialized(roomCount);
+	int32 startIndex = INDEX_NONE;
+	int32 goalIndex = INDEX_NONE;
+	int32 goalDepth = -1;
+	int32 goalID = -1;
+	int32 totalRooms = 0;
+
+	for (int z = 0; z < DungeonSpace.Num(); z++)
+	{
+		const FDungeonFloor& floor = DungeonSpace[z];
+		for (int y = 0; y < floor.YSize(); y++)
+		{
+			for (int x = 0; x < floor.XSize(); x++)
+			{
+				const FFloorRoom& room = floor.Get(x, y);
+				int32 index = toIndex(FIntVector(x, y, z));
+				missionRank[index] = MAX_int32;
+				if (room.RoomClass == NULL)
+				{
+					continue;
+				}
+				rooms[index] = &room;
+				totalRooms++;
+
+				int32 node = missionAnalysis.IndexOf(room.RoomNode);
+				if (node == FDungeonMissionGraphAnalysis::INVALID_INDEX)
+				{
+					continue;
+				}
+				missionRank[index] = missionAnalysis.GetTopologicalRank(node);
+				if (room.RoomNode == Head)
+				{
+					startIndex = index;
+				}
+
+				// Find our goal
+				if (GoalSymbol != NULL)
+				{
+					if (goalIndex == INDEX_NONE && room.DungeonSymbol.Symbol == GoalSymbol)
+					{
+						goalIndex = index;
+					}
+				}
+				else
+				{
+					int32 depth = missionAnalysis.GetDepth(node);
+					if (depth > goalDepth || (depth == goalDepth && room.DungeonSymbol.SymbolID > goalID))
+					{
+						goalIndex = index;
+						goalDepth = depth;
+						goalID = room.DungeonSymbol.SymbolID;
+					}
+				}
+			}
+		}
+	}
+
+	if (startIndex == INDEX_NONE || goalIndex == INDEX_NONE)
+	{
+		UE_LOG(LogSpaceGen, Warning, TEXT("Could not find a start and goal room to check the dungeon with."));
+		report.UnreachableRoomCount = totalRooms;
+		return report;
+	}
+	report.StartRoom = rooms[startIndex]->Location;
+	report.GoalRoom = rooms[goalIndex]->Location;
+
+	// How far a walk through the dungeon has got. Copied to try out opening a different lock.
+	struct FWalkState
+	{
+		// 0 = not seen, 1 = reachable, 2 = behind a locked door
+		TArray<uint8> State;
+		TArray<int32> ToVisit;
+		int32 Next = 0;
+		// Locked rooms we've found, with the earliest one in the mission on top
+		TArray<int32> LockedRooms;
+		int32 KeyCount = 0;
+	};
+
+	TArray<int32> previousRoom;
+	previousRoom.Init(INDEX_NONE, roomCount);
+	auto missionOrder = [&missionRank](int32 A, int32 B)
+	{
+		return missionRank[A] < missionRank[B];
+	};
+
+	// Explore everything we can get to without opening any more doors.
+	// Only the real walk records keys and paths; trial walks just need to know where they end up.
+	auto explore = [&](FWalkState& Walk, bool bRecord)
+	{
+		for (; Walk.Next < Walk.ToVisit.Num(); Walk.Next++)
+		{
+			int32 current = Walk.ToVisit[Walk.Next];
+			const FFloorRoom& room = *rooms[current];
+			if (IsKeyRoom(room))
+			{
+				Walk.KeyCount++;
+				if (bRecord)
+				{
+					report.KeyOrder.Add(room.Location);
+				}
+			}
+
+			uint8 neighbors = room.GetAllNeighborsMask();
+			for (int32 direction = 0; direction < FFloorRoom::DIRECTION_COUNT; direction++)
+			{
+				if ((neighbors & (1 << direction)) == 0)
+				{
+					continue;
+				}
+				int32 neighborIndex = toIndex(room.GetNeighborLocation(direction));
+				if (neighborIndex == INDEX_NONE || rooms[neighborIndex] == NULL || Walk.State[neighborIndex] != 0)
+				{
+					continue;
+				}
+				if (bRecord)
+				{
+					previousRoom[neighborIndex] = current;
+				}
+				if (IsLockedRoom(*rooms[neighborIndex]))
+				{
+					Walk.State[neighborIndex] = 2;
+					Walk.LockedRooms.HeapPush(neighborIndex, missionOrder);
+				}
+				else
+				{
+					Walk.State[neighborIndex] = 1;
+					Walk.ToVisit.Add(neighborIndex);
+				}
+			}
+		}
+	};
+
+	auto openLock = [](FWalkState& Walk, int32 LockedRoom)
+	{
+		Walk.KeyCount--;
+		Walk.State[LockedRoom] = 1;
+		Walk.ToVisit.Add(LockedRoom);
+	};
+
+	// Plays out the rest of a trial walk, opening locks in mission order, and returns whether it gets to the goal.
+	auto canReachGoal = [&](FWalkState& Walk)
+	{
+		while (true)
+		{
+			explore(Walk, false);
+			if (Walk.State[goalIndex] == 1)
+			{
+				return true;
+			}
+			if (Walk.LockedRooms.Num() == 0 || Walk.KeyCount == 0)
+			{
+				return false;
+			}
+			int32 opened;
+			Walk.LockedRooms.HeapPop(opened, missionOrder);
+			openLock(Walk, opened);
+		}
+	};
+
+	FWalkState walk;
+	walk.State.SetNumZeroed(roomCount);
+	walk.ToVisit.Reserve(totalRooms);
+	walk.ToVisit.Add(startIndex);
+	walk.State[startIndex] = 1;
+	TSet<int32> riskyRooms;
+
+	while (true)
+	{
+		explore(walk, true);
+
+		if (walk.State[goalIndex] == 1 || walk.LockedRooms.Num() == 0 || walk.KeyCount == 0)
+		{
+			break;
+		}
+
+		// The room on top of the heap is the one we open. The player could spend the key on any
+		// of the others instead; that's only a problem if the goal is out of reach afterwards.
+		for (int32 lockIndex = 1; lockIndex < walk.LockedRooms.Num(); lockIndex++)
+		{
+			int32 otherRoom = walk.LockedRooms[lockIndex];
+			if (riskyRooms.Contains(otherRoom))
+			{
+				continue;
+			}
+			FWalkState trial = walk;
+			trial.LockedRooms.HeapRemoveAt(lockIndex, missionOrder);
+			openLock(trial, otherRoom);
+			if (!canReachGoal(trial))
+			{
+				riskyRooms.Add(otherRoom);
+			}
+		}
+
+		int32 opened;
+		walk.LockedRooms.HeapPop(opened, missionOrder);
+		openLock(walk, opened);
+		report.LockOrder.Add(rooms[opened]->Location);
+	}
+
+	report.bIsSolvable = walk.State[goalIndex] == 1;
+	report.UnreachableRoomCount = totalRooms - walk.ToVisit.Num();
+	for (int32 riskyRoom : riskyRooms)
+	{
+		report.SoftlockRiskRooms.Add(rooms[riskyRoom]->Location);
+	}
+	report.bHasSoftlockRisk = report.SoftlockRiskRooms.Num() > 0;
+
+	if (report.bIsSolvable)
+	{
+		for (int32 current = goalIndex; current != INDEX_NONE; current = previousRoom[current])
+		{
+			report.CriticalPath.Add(rooms[current]->Location);
+		}
+		Algo::Reverse(report.CriticalPath);
+	}
+
+	return report;
+}
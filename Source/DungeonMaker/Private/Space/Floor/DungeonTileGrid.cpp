@@ -0,0 +1,349 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonTileGrid.h"
+#include "DungeonSpaceGenerator.h"
+#include "DungeonRoom.h"
+
+const int32 FDungeonTileGrid::LEVEL_SHIFTS[FDungeonTileGrid::LEVEL_COUNT] = { 3, 6 };
+
+FDungeonTileGrid::FDungeonTileGrid()
+{
+	RoomSize = 1;
+	Version = 0;
+}
+
+void FDungeonTileGrid::Reset()
+{
+	Floors.Reset();
+	Version++;
+}
+
+void FDungeonTileGrid::InitializeFloor(FFloorGrid& Floor, int32 Width, int32 Height)
+{
+	Floor.Width = Width;
+	Floor.Height = Height;
+	for (int32 type = 0; type < TILE_TYPE_COUNT; type++)
+	{
+		Floor.Layers[type].Init(false, Width * Height);
+	}
+	for (int32 level = 0; level < LEVEL_COUNT; level++)
+	{
+		int32 blockSize = 1 << LEVEL_SHIFTS[level];
+		Floor.BlockWidths[level] = (Width + blockSize - 1) >> LEVEL_SHIFTS[level];
+		Floor.BlockHeights[level] = (Height + blockSize - 1) >> LEVEL_SHIFTS[level];
+		for (int32 type = 0; type < TILE_TYPE_COUNT; type++)
+		{
+			Floor.BlockCounts[level][type].Init(0, Floor.BlockWidths[level] * Floor.BlockHeights[level]);
+		}
+	}
+	Floor.RoomColumns = (Width + RoomSize - 1) / RoomSize;
+	Floor.RoomVersions.Init(Version, Floor.RoomColumns * ((Height + RoomSize - 1) / RoomSize));
+}
+
+void FDungeonTileGrid::Build(const UDungeonSpaceGenerator* SpaceGenerator)
+{
+	Reset();
+	int32 roomSize = SpaceGenerator->RoomSize;
+	RoomSize = FMath::Max(roomSize, 1);
+	Floors.SetNum(SpaceGenerator->DungeonSpace.Num());
+
+	TArray<FIntVector> roomTiles;
+	for (int32 z = 0; z < Floors.Num(); z++)
+	{
+		const FDungeonFloor& floor = SpaceGenerator->DungeonSpace[z];
+		FFloorGrid& grid = Floors[z];
+		InitializeFloor(grid, floor.XSize() * roomSize, floor.YSize() * roomSize);
+
+		for (const FFloorRoom& room : floor.Rooms)
+		{
+			if (room.SpawnedRoom == NULL)
+			{
+				continue;
+			}
+			int32 xOffset = room.Location.X * roomSize;
+			int32 yOffset = room.Location.Y * roomSize;
+			for (int32 type = 0; type < TILE_TYPE_COUNT; type++)
+			{
+				roomTiles.Reset();
+				room.SpawnedRoom->RoomTiles.GetTileLocationsOfType((ETileType)type, roomTiles);
+				for (const FIntVector& tile : roomTiles)
+				{
+					int32 x = xOffset + tile.X;
+					int32 y = yOffset + tile.Y;
+					if (x < grid.Width && y < grid.Height)
+					{
+						SetBit(grid, x, y, type, true);
+					}
+				}
+			}
+		}
+	}
+}
+
+void FDungeonTileGrid::SetBit(FFloorGrid& Floor, int32 X, int32 Y, int32 Type, bool bValue)
+{
+	int32 bit = Y * Floor.Width + X;
+	if (Floor.Layers[Type][bit] == bValue)
+	{
+		return;
+	}
+	Floor.Layers[Type][bit] = bValue;
+	Version++;
+	Floor.RoomVersions[(Y / RoomSize) * Floor.RoomColumns + X / RoomSize] = Version;
+	for (int32 level = 0; level < LEVEL_COUNT; level++)
+	{
+		int32 block = (Y >> LEVEL_SHIFTS[level]) * Floor.BlockWidths[level] + (X >> LEVEL_SHIFTS[level]);
+		Floor.BlockCounts[level][Type][block] += bValue ? 1 : -1;
+	}
+}
+
+bool FDungeonTileGrid::IsLocationValid(const FIntVector& TileSpaceLocation) const
+{
+	if (!Floors.IsValidIndex(TileSpaceLocation.Z))
+	{
+		return false;
+	}
+	const FFloorGrid& floor = Floors[TileSpaceLocation.Z];
+	return TileSpaceLocation.X >= 0 && TileSpaceLocation.Y >= 0 && TileSpaceLocation.X < floor.Width && TileSpaceLocation.Y < floor.Height;
+}
+
+uint32 FDungeonTileGrid::GetRoomVersion(const FIntVector& FloorSpaceLocation) const
+{
+	if (!Floors.IsValidIndex(FloorSpaceLocation.Z) || FloorSpaceLocation.X < 0 || FloorSpaceLocation.Y < 0)
+	{
+		return Version;
+	}
+	const FFloorGrid& floor = Floors[FloorSpaceLocation.Z];
+	int32 room = FloorSpaceLocation.Y * floor.RoomColumns + FloorSpaceLocation.X;
+	if (FloorSpaceLocation.X >= floor.RoomColumns || !floor.RoomVersions.IsValidIndex(room))
+	{
+		return Version;
+	}
+	return floor.RoomVersions[room];
+}
+
+void FDungeonTileGrid::SetTile(const FIntVector& TileSpaceLocation, const UDungeonTile* Tile)
+{
+	if (!IsLocationValid(TileSpaceLocation))
+	{
+		return;
+	}
+	FFloorGrid& floor = Floors[TileSpaceLocation.Z];
+	for (int32 type = 0; type < TILE_TYPE_COUNT; type++)
+	{
+		bool bIsType = Tile != NULL && (int32)Tile->TileType == type;
+		SetBit(floor, TileSpaceLocation.X, TileSpaceLocation.Y, type, bIsType);
+	}
+}
+
+bool FDungeonTileGrid::IsTileOfType(const FIntVector& TileSpaceLocation, ETileType Type) const
+{
+	if (!IsLocationValid(TileSpaceLocation))
+	{
+		return false;
+	}
+	const FFloorGrid& floor = Floors[TileSpaceLocation.Z];
+	return floor.Layers[(int32)Type][TileSpaceLocation.Y * floor.Width + TileSpaceLocation.X];
+}
+
+bool FDungeonTileGrid::VisitRectangle(const FFloorGrid& Floor, int32 Z, int32 Type, int32 MinX, int32 MinY,
+	int32 MaxX, int32 MaxY, TFunctionRef<bool(const FIntVector&)> Visitor) const
+{
+	MinX = FMath::Max(MinX, 0);
+	MinY = FMath::Max(MinY, 0);
+	MaxX = FMath::Min(MaxX, Floor.Width - 1);
+	MaxY = FMath::Min(MaxY, Floor.Height - 1);
+	if (MinX > MaxX || MinY > MaxY)
+	{
+		return true;
+	}
+
+	const int32 coarseShift = LEVEL_SHIFTS[1];
+	const int32 fineShift = LEVEL_SHIFTS[0];
+	const TBitArray<>& layer = Floor.Layers[Type];
+	for (int32 coarseY = MinY >> coarseShift; coarseY <= MaxY >> coarseShift; coarseY++)
+	{
+		for (int32 coarseX = MinX >> coarseShift; coarseX <= MaxX >> coarseShift; coarseX++)
+		{
+			if (GetBlockCount(Floor, 1, coarseX, coarseY, Type) == 0)
+			{
+				continue;
+			}
+			int32 fineMinY = FMath::Max(MinY, coarseY << coarseShift) >> fineShift;
+			int32 fineMaxY = FMath::Min(MaxY, ((coarseY + 1) << coarseShift) - 1) >> fineShift;
+			int32 fineMinX = FMath::Max(MinX, coarseX << coarseShift) >> fineShift;
+			int32 fineMaxX = FMath::Min(MaxX, ((coarseX + 1) << coarseShift) - 1) >> fineShift;
+			for (int32 fineY = fineMinY; fineY <= fineMaxY; fineY++)
+			{
+				for (int32 fineX = fineMinX; fineX <= fineMaxX; fineX++)
+				{
+					if (GetBlockCount(Floor, 0, fineX, fineY, Type) == 0)
+					{
+						continue;
+					}
+					int32 startY = FMath::Max(MinY, fineY << fineShift);
+					int32 endY = FMath::Min(MaxY, ((fineY + 1) << fineShift) - 1);
+					int32 startX = FMath::Max(MinX, fineX << fineShift);
+					int32 endX = FMath::Min(MaxX, ((fineX + 1) << fineShift) - 1);
+					for (int32 y = startY; y <= endY; y++)
+					{
+						for (int32 x = startX; x <= endX; x++)
+						{
+							if (layer[y * Floor.Width + x] && !Visitor(FIntVector(x, y, Z)))
+							{
+								return false;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void FDungeonTileGrid::ForEachTileInRectangle(ETileType Type, const FIntVector& Min, const FIntVector& Max,
+	TFunctionRef<bool(const FIntVector&)> Visitor) const
+{
+	if (!Floors.IsValidIndex(Min.Z))
+	{
+		return;
+	}
+	VisitRectangle(Floors[Min.Z], Min.Z, (int32)Type, Min.X, Min.Y, Max.X, Max.Y, Visitor);
+}
+
+void FDungeonTileGrid::ForEachTileInRadius(ETileType Type, const FIntVector& Center, float Radius,
+	TFunctionRef<bool(const FIntVector&)> Visitor) const
+{
+	if (!Floors.IsValidIndex(Center.Z) || Radius < 0.0f)
+	{
+		return;
+	}
+	int32 extent = FMath::FloorToInt(Radius);
+	float radiusSquared = Radius * Radius;
+	VisitRectangle(Floors[Center.Z], Center.Z, (int32)Type, Center.X - extent, Center.Y - extent, Center.X + extent, Center.Y + extent,
+		[&](const FIntVector& Location)
+	{
+		int32 dx = Location.X - Center.X;
+		int32 dy = Location.Y - Center.Y;
+		if (dx * dx + dy * dy > radiusSquared)
+		{
+			return true;
+		}
+		return Visitor(Location);
+	});
+}
+
+void FDungeonTileGrid::GetAllTiles(ETileType Type, TArray<FIntVector>& OutLocations) const
+{
+	for (int32 z = 0; z < Floors.Num(); z++)
+	{
+		const FFloorGrid& floor = Floors[z];
+		for (TConstSetBitIterator<> bit(floor.Layers[(int32)Type]); bit; ++bit)
+		{
+			OutLocations.Add(FIntVector(bit.GetIndex() % floor.Width, bit.GetIndex() / floor.Width, z));
+		}
+	}
+}
+
+void FDungeonTileGrid::GetTilesInRectangle(ETileType Type, const FIntVector& Min, const FIntVector& Max,
+	TArray<FIntVector>& OutLocations) const
+{
+	ForEachTileInRectangle(Type, Min, Max, [&OutLocations](const FIntVector& Location)
+	{
+		OutLocations.Add(Location);
+		return true;
+	});
+}
+
+void FDungeonTileGrid::GetTilesInRadius(ETileType Type, const FIntVector& Center, float Radius,
+	TArray<FIntVector>& OutLocations) const
+{
+	ForEachTileInRadius(Type, Center, Radius, [&OutLocations](const FIntVector& Location)
+	{
+		OutLocations.Add(Location);
+		return true;
+	});
+}
+
+bool FDungeonTileGrid::FindNearestTileOfType(ETileType Type, const FIntVector& Origin, int32 MaxDistance,
+	FIntVector& OutLocation) const
+{
+	if (!IsLocationValid(Origin))
+	{
+		return false;
+	}
+	const FFloorGrid& floor = Floors[Origin.Z];
+	const int32 type = (int32)Type;
+	const int32 fineShift = LEVEL_SHIFTS[0];
+	const int32 blockSize = 1 << fineShift;
+	const int32 coarseShift = LEVEL_SHIFTS[1] - fineShift;
+	const int32 originBlockX = Origin.X >> fineShift;
+	const int32 originBlockY = Origin.Y >> fineShift;
+	const int32 maxRing = FMath::Max(FMath::Max(originBlockX, floor.BlockWidths[0] - originBlockX),
+		FMath::Max(originBlockY, floor.BlockHeights[0] - originBlockY));
+	const int64 maxDistanceSquared = MaxDistance > 0 ? (int64)MaxDistance * MaxDistance : MAX_int64;
+
+	int64 bestDistanceSquared = MAX_int64;
+	auto searchBlock = [&](int32 BlockX, int32 BlockY)
+	{
+		if (BlockX < 0 || BlockY < 0 || BlockX >= floor.BlockWidths[0] || BlockY >= floor.BlockHeights[0])
+		{
+			return;
+		}
+		if (GetBlockCount(floor, 1, BlockX >> coarseShift, BlockY >> coarseShift, type) == 0 ||
+			GetBlockCount(floor, 0, BlockX, BlockY, type) == 0)
+		{
+			return;
+		}
+		int32 endX = FMath::Min((BlockX + 1) << fineShift, floor.Width);
+		int32 endY = FMath::Min((BlockY + 1) << fineShift, floor.Height);
+		for (int32 y = BlockY << fineShift; y < endY; y++)
+		{
+			for (int32 x = BlockX << fineShift; x < endX; x++)
+			{
+				if (!floor.Layers[type][y * floor.Width + x])
+				{
+					continue;
+				}
+				int64 dx = x - Origin.X;
+				int64 dy = y - Origin.Y;
+				int64 distanceSquared = dx * dx + dy * dy;
+				if (distanceSquared < bestDistanceSquared && distanceSquared <= maxDistanceSquared)
+				{
+					bestDistanceSquared = distanceSquared;
+					OutLocation = FIntVector(x, y, Origin.Z);
+				}
+			}
+		}
+	};
+
+	// Search outward in rings of blocks, until no block further out could be closer
+	for (int32 ring = 0; ring <= maxRing; ring++)
+	{
+		if (ring > 0)
+		{
+			int64 closestPossible = (int64)(ring - 1) * blockSize + 1;
+			if (closestPossible * closestPossible > FMath::Min(bestDistanceSquared, maxDistanceSquared))
+			{
+				break;
+			}
+		}
+		if (ring == 0)
+		{
+			searchBlock(originBlockX, originBlockY);
+			continue;
+		}
+		for (int32 x = originBlockX - ring; x <= originBlockX + ring; x++)
+		{
+			searchBlock(x, originBlockY - ring);
+			searchBlock(x, originBlockY + ring);
+		}
+		for (int32 y = originBlockY - ring + 1; y <= originBlockY + ring - 1; y++)
+		{
+			searchBlock(originBlockX - ring, y);
+			searchBlock(originBlockX + ring, y);
+		}
+	}
+	return bestDistanceSquared != MAX_int64;
+}
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonVisibility.h"
+
+// Multipliers for each of the eight octants: XX, XY, YX, YY
+static const int32 OCTANTS[8][4] =
+{
+	{ 1, 0, 0, 1 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { -1, 0, 0, 1 },
+	{ -1, 0, 0, -1 }, { 0, -1, -1, 0 }, { 0, 1, -1, 0 }, { 1, 0, 0, -1 }
+};
+
+FDungeonVisibility::FDungeonVisibility()
+{
+	Reset();
+}
+
+void FDungeonVisibility::Reset()
+{
+	Grid = NULL;
+	Explored.Reset();
+	FogView.Floor = -1;
+	FogView.Bits.Empty();
+	FogView.Tiles.Reset();
+	ScratchView.Floor = -1;
+	ScratchView.Bits.Empty();
+	ScratchView.Tiles.Reset();
+	FogOrigin = FIntVector(-1, -1, -1);
+	FogRadius = -1;
+	FogVersion = 0;
+}
+
+void FDungeonVisibility::Initialize(const FDungeonTileGrid* TileGrid)
+{
+	Reset();
+	Grid = TileGrid;
+	Explored.SetNum(Grid->NumFloors());
+	for (int32 floor = 0; floor < Explored.Num(); floor++)
+	{
+		Explored[floor].Init(false, Grid->XSize(floor) * Grid->YSize(floor));
+	}
+}
+
+bool FDungeonVisibility::IsTransparent(int32 Floor, int32 X, int32 Y) const
+{
+	if (X < 0 || Y < 0 || X >= Grid->XSize(Floor) || Y >= Grid->YSize(Floor))
+	{
+		return false;
+	}
+	return Grid->GetLayer(Floor, ETileType::Floor)[Y * Grid->XSize(Floor) + X];
+}
+
+bool FDungeonVisibility::HasLineOfSight(const FIntVector& From, const FIntVector& To) const
+{
+	if (Grid == NULL || From.Z != To.Z || !Grid->IsLocationValid(From) || !Grid->IsLocationValid(To))
+	{
+		return false;
+	}
+
+	// Walk from tile center to tile center, one tile boundary at a time
+	int32 deltaX = FMath::Abs(To.X - From.X);
+	int32 deltaY = FMath::Abs(To.Y - From.Y);
+	int32 stepX = To.X > From.X ? 1 : -1;
+	int32 stepY = To.Y > From.Y ? 1 : -1;
+	// The line crosses its Nth tile boundary on an axis at (N - 0.5) / delta of the way along.
+	// These get cross-multiplied to stay in integers.
+	int32 nextX = 1;
+	int32 nextY = 1;
+	int32 x = From.X;
+	int32 y = From.Y;
+	for (int32 remaining = deltaX + deltaY; remaining > 0;)
+	{
+		int64 crossX = deltaX == 0 ? MAX_int64 : (int64)(2 * nextX - 1) * deltaY;
+		int64 crossY = deltaY == 0 ? MAX_int64 : (int64)(2 * nextY - 1) * deltaX;
+		if (crossX < crossY)
+		{
+			x += stepX;
+			nextX++;
+			remaining--;
+		}
+		else if (crossY < crossX)
+		{
+			y += stepY;
+			nextY++;
+			remaining--;
+		}
+		else
+		{
+			// Straight through a corner; only blocked if both tiles beside it are
+			if (!IsTransparent(From.Z, x + stepX, y) && !IsTransparent(From.Z, x, y + stepY))
+			{
+				return false;
+			}
+			x += stepX;
+			y += stepY;
+			nextX++;
+			nextY++;
+			remaining -= 2;
+		}
+		if (remaining > 0 && !IsTransparent(From.Z, x, y))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FDungeonVisibility::MarkVisible(int32 Floor, int32 X, int32 Y, FViewShed& OutView) const
+{
+	int32 index = Y * Grid->XSize(Floor) + X;
+	if (!OutView.Bits[index])
+	{
+		OutView.Bits[index] = true;
+		OutView.Tiles.Add(index);
+	}
+}
+
+void FDungeonVisibility::ClearView(FViewShed& View) const
+{
+	for (int32 index : View.Tiles)
+	{
+		View.Bits[index] = false;
+	}
+	View.Tiles.Reset();
+}
+
+void FDungeonVisibility::CastLight(const FIntVector& Origin, int32 Radius, int32 Row, float StartSlope, float EndSlope,
+	int32 XX, int32 XY, int32 YX, int32 YY, FViewShed& OutView) const
+{
+	if (StartSlope < EndSlope)
+	{
+		return;
+	}
+	int32 radiusSquared = Radius * Radius;
+	float nextStartSlope = StartSlope;
+	for (int32 distance = Row; distance <= Radius; distance++)
+	{
+		bool bBlocked = false;
+		for (int32 deltaX = -distance, deltaY = -distance; deltaX <= 0; deltaX++)
+		{
+			// Slopes of the tile's two far corners
+			float leftSlope = (deltaX - 0.5f) / (deltaY + 0.5f);
+			float rightSlope = (deltaX + 0.5f) / (deltaY - 0.5f);
+			if (StartSlope < rightSlope)
+			{
+				continue;
+			}
+			if (EndSlope > leftSlope)
+			{
+				break;
+			}
+
+			int32 x = Origin.X + deltaX * XX + deltaY * XY;
+			int32 y = Origin.Y + deltaX * YX + deltaY * YY;
+			bool bInBounds = x >= 0 && y >= 0 && x < Grid->XSize(Origin.Z) && y < Grid->YSize(Origin.Z);
+			if (bInBounds && deltaX * deltaX + deltaY * deltaY <= radiusSquared)
+			{
+				MarkVisible(Origin.Z, x, y, OutView);
+			}
+
+			bool bOpaque = !bInBounds || !IsTransparent(Origin.Z, x, y);
+			if (bBlocked)
+			{
+				if (bOpaque)
+				{
+					nextStartSlope = rightSlope;
+				}
+				else
+				{
+					bBlocked = false;
+					StartSlope = nextStartSlope;
+				}
+			}
+			else if (bOpaque && distance < Radius)
+			{
+				// The rest of this octant beyond here is in shadow, so scan around it
+				bBlocked = true;
+				CastLight(Origin, Radius, distance + 1, StartSlope, leftSlope, XX, XY, YX, YY, OutView);
+				nextStartSlope = rightSlope;
+			}
+		}
+		if (bBlocked)
+		{
+			break;
+		}
+	}
+}
+
+void FDungeonVisibility::ComputeFieldOfView(const FIntVector& Origin, int32 Radius, FViewShed& OutView) const
+{
+	ClearView(OutView);
+	if (Grid == NULL || !Grid->IsLocationValid(Origin) || Radius < 0)
+	{
+		return;
+	}
+	if (OutView.Floor != Origin.Z)
+	{
+		OutView.Floor = Origin.Z;
+		OutView.Bits.Init(false, Grid->XSize(Origin.Z) * Grid->YSize(Origin.Z));
+	}
+
+	MarkVisible(Origin.Z, Origin.X, Origin.Y, OutView);
+	for (int32 octant = 0; octant < 8; octant++)
+	{
+		CastLight(Origin, Radius, 1, 1.0f, 0.0f, OCTANTS[octant][0], OCTANTS[octant][1],
+			OCTANTS[octant][2], OCTANTS[octant][3], OutView);
+	}
+}
+
+void FDungeonVisibility::GetVisibleTiles(const FIntVector& Origin, int32 Radius, TArray<FIntVector>& OutTiles)
+{
+	ComputeFieldOfView(Origin, Radius, ScratchView);
+	int32 width = Grid == NULL ? 0 : Grid->XSize(Origin.Z);
+	for (int32 index : ScratchView.Tiles)
+	{
+		OutTiles.Add(FIntVector(index % width, index / width, Origin.Z));
+	}
+}
+
+void FDungeonVisibility::UpdateFogOfWar(const FIntVector& Origin, int32 Radius)
+{
+	if (Grid == NULL)
+	{
+		return;
+	}
+	if (Origin == FogOrigin && Radius == FogRadius && FogVersion == Grid->GetVersion())
+	{
+		// Nothing the viewer could see has changed
+		return;
+	}
+	FogOrigin = Origin;
+	FogRadius = Radius;
+	FogVersion = Grid->GetVersion();
+
+	ComputeFieldOfView(Origin, Radius, FogView);
+	if (Explored.IsValidIndex(Origin.Z))
+	{
+		TBitArray<>& explored = Explored[Origin.Z];
+		for (int32 index : FogView.Tiles)
+		{
+			explored[index] = true;
+		}
+	}
+}
+
+bool FDungeonVisibility::IsTileVisible(const FIntVector& TileSpaceLocation) const
+{
+	if (Grid == NULL || TileSpaceLocation.Z != FogView.Floor || !Grid->IsLocationValid(TileSpaceLocation))
+	{
+		return false;
+	}
+	return FogView.Bits[TileSpaceLocation.Y * Grid->XSize(TileSpaceLocation.Z) + TileSpaceLocation.X];
+}
+
+bool FDungeonVisibility::IsTileExplored(const FIntVector& TileSpaceLocation) const
+{
+	if (Grid == NULL || !Grid->IsLocationValid(TileSpaceLocation) || !Explored.IsValidIndex(TileSpaceLocation.Z))
+	{
+		return false;
+	}
+	return Explored[TileSpaceLocation.Z][TileSpaceLocation.Y * Grid->XSize(TileSpaceLocation.Z) + TileSpaceLocation.X];
+}
@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CaveAutomaton.h"
+
+static const int32 DIRECTION_X[4] = { -1, 1, 0, 0 };
+static const int32 DIRECTION_Y[4] = { 0, 0, -1, 1 };
+
+// Adds one bit plane into a bit-sliced 4-bit counter
+static FORCEINLINE void AddPlane(uint64 Plane, uint64& Count0, uint64& Count1, uint64& Count2, uint64& Count3)
+{
+	uint64 carry = Count0 & Plane;
+	Count0 ^= Plane;
+	uint64 nextCarry = Count1 & carry;
+	Count1 ^= carry;
+	carry = nextCarry;
+	nextCarry = Count2 & carry;
+	Count2 ^= carry;
+	Count3 |= nextCarry;
+}
+
+// Bits set where the bit-sliced count is at least Limit
+static FORCEINLINE uint64 AtLeast(int32 Limit, uint64 Count0, uint64 Count1, uint64 Count2, uint64 Count3)
+{
+	if (Limit <= 0)
+	{
+		return ~0ull;
+	}
+	if (Limit > 15)
+	{
+		return 0;
+	}
+	// Compare from the top bit down: greater as soon as a count bit is set where the limit's isn't
+	const uint64 counts[4] = { Count0, Count1, Count2, Count3 };
+	uint64 greater = 0;
+	uint64 equal = ~0ull;
+	for (int32 bit = 3; bit >= 0; bit--)
+	{
+		if ((Limit >> bit) & 1)
+		{
+			equal &= counts[bit];
+		}
+		else
+		{
+			greater |= equal & counts[bit];
+			equal &= ~counts[bit];
+		}
+	}
+	return greater | equal;
+}
+
+FCaveAutomaton::FCaveAutomaton()
+{
+	Width = 0;
+	Height = 0;
+	WordsPerRow = 0;
+	PaddingMask = 0;
+}
+
+void FCaveAutomaton::Initialize(int32 CaveWidth, int32 CaveHeight)
+{
+	Width = FMath::Max(CaveWidth, 0);
+	Height = FMath::Max(CaveHeight, 0);
+	WordsPerRow = (Width + 63) >> 6;
+	int32 usedBits = Width & 63;
+	PaddingMask = usedBits == 0 ? 0 : ~0ull << usedBits;
+
+	int32 wordCount = WordsPerRow * Height;
+	Walls.Init(~0ull, wordCount);
+	NextWalls.Init(~0ull, wordCount);
+	FixedMask.Init(0, wordCount);
+	FixedWalls.Init(0, wordCount);
+	SolidRow.Init(~0ull, WordsPerRow);
+}
+
+void FCaveAutomaton::SetFixed(int32 X, int32 Y, bool bWall)
+{
+	if (X < 0 || Y < 0 || X >= Width || Y >= Height)
+	{
+		return;
+	}
+	SetBit(FixedMask, X, Y, true);
+	SetBit(FixedWalls, X, Y, bWall);
+	SetBit(Walls, X, Y, bWall);
+}
+
+void FCaveAutomaton::ApplyFixedCells(TArray<uint64>& Bits) const
+{
+	for (int32 i = 0; i < Bits.Num(); i++)
+	{
+		Bits[i] = (Bits[i] & ~FixedMask[i]) | FixedWalls[i];
+	}
+	if (PaddingMask != 0)
+	{
+		for (int32 y = 0; y < Height; y++)
+		{
+			Bits[y * WordsPerRow + WordsPerRow - 1] |= PaddingMask;
+		}
+	}
+}
+
+void FCaveAutomaton::Randomize(float WallChance, FRandomStream& Rng)
+{
+	for (int32 y = 0; y < Height; y++)
+	{
+		for (int32 x = 0; x < Width; x++)
+		{
+			SetBit(Walls, x, y, Rng.FRand() < WallChance);
+		}
+	}
+	ApplyFixedCells(Walls);
+}
+
+void FCaveAutomaton::Step(int32 BirthLimit, int32 SurvivalLimit)
+{
+	for (int32 y = 0; y < Height; y++)
+	{
+		const uint64* above = y > 0 ? &Walls[(y - 1) * WordsPerRow] : SolidRow.GetData();
+		const uint64* row = &Walls[y * WordsPerRow];
+		const uint64* below = y < Height - 1 ? &Walls[(y + 1) * WordsPerRow] : SolidRow.GetData();
+		uint64* next = &NextWalls[y * WordsPerRow];
+
+		for (int32 word = 0; word < WordsPerRow; word++)
+		{
+			bool bHasPrevious = word > 0;
+			bool bHasNext = word < WordsPerRow - 1;
+			// Shifting in a set bit at either end keeps everything outside the grid as wall
+			auto fromLeft = [word, bHasPrevious](const uint64* Row)
+			{
+				return (Row[word] << 1) | (bHasPrevious ? Row[word - 1] >> 63 : 1ull);
+			};
+			auto fromRight = [word, bHasNext](const uint64* Row)
+			{
+				return (Row[word] >> 1) | ((bHasNext ? Row[word + 1] : ~0ull) << 63);
+			};
+
+			uint64 count0 = 0;
+			uint64 count1 = 0;
+			uint64 count2 = 0;
+			uint64 count3 = 0;
+			AddPlane(fromLeft(above), count0, count1, count2, count3);
+			AddPlane(above[word], count0, count1, count2, count3);
+			AddPlane(fromRight(above), count0, count1, count2, count3);
+			AddPlane(fromLeft(row), count0, count1, count2, count3);
+			AddPlane(fromRight(row), count0, count1, count2, count3);
+			AddPlane(fromLeft(below), count0, count1, count2, count3);
+			AddPlane(below[word], count0, count1, count2, count3);
+			AddPlane(fromRight(below), count0, count1, count2, count3);
+
+			uint64 births = AtLeast(BirthLimit, count0, count1, count2, count3) & ~row[word];
+			uint64 survivors = AtLeast(SurvivalLimit, count0, count1, count2, count3) & row[word];
+			next[word] = births | survivors;
+		}
+	}
+	ApplyFixedCells(NextWalls);
+	Swap(Walls, NextWalls);
+}
+
+void FCaveAutomaton::LabelRegions(TArray<int32>& OutLabels, TArray<int32>& OutRegionSizes) const
+{
+	OutLabels.Init(INDEX_NONE, Width * Height);
+	OutRegionSizes.Reset();
+	TArray<int32> queue;
+	for (int32 start = 0; start < Width * Height; start++)
+	{
+		if (OutLabels[start] != INDEX_NONE || IsWall(start % Width, start / Width))
+		{
+			continue;
+		}
+		int32 region = OutRegionSizes.Add(0);
+		OutLabels[start] = region;
+		queue.Reset();
+		queue.Add(start);
+		for (int32 next = 0; next < queue.Num(); next++)
+		{
+			int32 x = queue[next] % Width;
+			int32 y = queue[next] / Width;
+			for (int32 direction = 0; direction < 4; direction++)
+			{
+				int32 neighborX = x + DIRECTION_X[direction];
+				int32 neighborY = y + DIRECTION_Y[direction];
+				if (IsWall(neighborX, neighborY))
+				{
+					continue;
+				}
+				int32 neighbor = neighborY * Width + neighborX;
+				if (OutLabels[neighbor] == INDEX_NONE)
+				{
+					OutLabels[neighbor] = region;
+					queue.Add(neighbor);
+				}
+			}
+		}
+		OutRegionSizes[region] = queue.Num();
+	}
+}
+
+void FCaveAutomaton::ConnectRegions(const TArray<FIntVector>& Anchors, int32 MinRegionSize)
+{
+	if (Anchors.Num() == 0)
+	{
+		return;
+	}
+	for (const FIntVector& anchor : Anchors)
+	{
+		if (anchor.X >= 0 && anchor.Y >= 0 && anchor.X < Width && anchor.Y < Height && !IsFixed(anchor.X, anchor.Y))
+		{
+			SetBit(Walls, anchor.X, anchor.Y, false);
+		}
+	}
+
+	TArray<int32> labels;
+	TArray<int32> regionSizes;
+	LabelRegions(labels, regionSizes);
+	// Regions holding an anchor or a fixed open cell always get kept
+	TBitArray<> anchoredRegions(false, regionSizes.Num());
+	for (const FIntVector& anchor : Anchors)
+	{
+		if (!IsWall(anchor.X, anchor.Y))
+		{
+			anchoredRegions[labels[anchor.Y * Width + anchor.X]] = true;
+		}
+	}
+	for (int32 cell = 0; cell < labels.Num(); cell++)
+	{
+		if (labels[cell] != INDEX_NONE && IsFixed(cell % Width, cell / Width))
+		{
+			anchoredRegions[labels[cell]] = true;
+		}
+	}
+
+	// Small pockets aren't worth a tunnel
+	TBitArray<> connected(false, regionSizes.Num());
+	int32 remainingRegions = 0;
+	for (int32 cell = 0; cell < labels.Num(); cell++)
+	{
+		int32 region = labels[cell];
+		if (region == INDEX_NONE || anchoredRegions[region] || regionSizes[region] >= MinRegionSize)
+		{
+			continue;
+		}
+		SetBit(Walls, cell % Width, cell / Width, true);
+		labels[cell] = INDEX_NONE;
+	}
+	for (int32 region = 0; region < regionSizes.Num(); region++)
+	{
+		if (anchoredRegions[region] || regionSizes[region] >= MinRegionSize)
+		{
+			remainingRegions++;
+		}
+	}
+
+	const FIntVector& firstAnchor = Anchors[0];
+	if (IsWall(firstAnchor.X, firstAnchor.Y))
+	{
+		return;
+	}
+	connected[labels[firstAnchor.Y * Width + firstAnchor.X]] = true;
+	remainingRegions--;
+
+	// Breadth-first out from everything connected so far, through any wall we're allowed to dig.
+	// The first unconnected region we reach gets a tunnel back along the search.
+	TArray<int32> parents;
+	TArray<int32> queue;
+	while (remainingRegions > 0)
+	{
+		parents.Init(INDEX_NONE, Width * Height);
+		queue.Reset();
+		for (int32 cell = 0; cell < labels.Num(); cell++)
+		{
+			if (labels[cell] != INDEX_NONE && connected[labels[cell]])
+			{
+				parents[cell] = cell;
+				queue.Add(cell);
+			}
+		}
+
+		int32 reached = INDEX_NONE;
+		for (int32 next = 0; next < queue.Num() && reached == INDEX_NONE; next++)
+		{
+			int32 x = queue[next] % Width;
+			int32 y = queue[next] / Width;
+			for (int32 direction = 0; direction < 4; direction++)
+			{
+				int32 neighborX = x + DIRECTION_X[direction];
+				int32 neighborY = y + DIRECTION_Y[direction];
+				if (neighborX < 0 || neighborY < 0 || neighborX >= Width || neighborY >= Height)
+				{
+					continue;
+				}
+				int32 neighbor = neighborY * Width + neighborX;
+				if (parents[neighbor] != INDEX_NONE || (IsFixed(neighborX, neighborY) && IsWall(neighborX, neighborY)))
+				{
+					continue;
+				}
+				parents[neighbor] = queue[next];
+				if (labels[neighbor] != INDEX_NONE && !connected[labels[neighbor]])
+				{
+					reached = neighbor;
+					break;
+				}
+				queue.Add(neighbor);
+			}
+		}
+		if (reached == INDEX_NONE)
+		{
+			// Whatever's left is sealed off by fixed walls
+			return;
+		}
+
+		connected[labels[reached]] = true;
+		remainingRegions--;
+		for (int32 cell = parents[reached]; parents[cell] != cell; cell = parents[cell])
+		{
+			SetBit(Walls, cell % Width, cell / Width, false);
+			// Count the tunnel as part of the connected area, so later tunnels can branch off it
+			labels[cell] = labels[reached];
+		}
+	}
+}
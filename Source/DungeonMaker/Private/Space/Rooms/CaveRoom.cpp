@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CaveRoom.h"
+#include "CaveAutomaton.h"
+
+void ACaveRoom::DoTileReplacementPreprocessing(FRandomStream& Rng)
+{
+	if (CaveWallTile == NULL)
+	{
+		UE_LOG(LogSpaceGen, Error, TEXT("%s has no cave wall tile!"), *GetName());
+		return;
+	}
+	if (XSize() <= 3 || YSize() <= 3)
+	{
+		// Not big enough to make a cave
+		return;
+	}
+
+	// The walls may already be set, but (1, 1) is guaranteed to be the room's default floor
+	const UDungeonTile* defaultTile = GetTile(1, 1);
+
+	// Anything that isn't default floor is left as it is
+	FCaveAutomaton cave;
+	cave.Initialize(XSize(), YSize());
+	for (int x = 0; x < XSize(); x++)
+	{
+		for (int y = 0; y < YSize(); y++)
+		{
+			const UDungeonTile* tile = GetTile(x, y);
+			if (tile != defaultTile)
+			{
+				cave.SetFixed(x, y, tile == NULL || tile->TileType == ETileType::Wall);
+			}
+		}
+	}
+
+	// Keep the ground just inside each entrance open
+	TArray<FIntVector> anchors;
+	for (const FIntVector& entrance : EntranceLocations)
+	{
+		anchors.Add(entrance);
+		for (int x = entrance.X - 1; x <= entrance.X + 1; x++)
+		{
+			for (int y = entrance.Y - 1; y <= entrance.Y + 1; y++)
+			{
+				if (GetTile(x, y) == defaultTile)
+				{
+					cave.SetFixed(x, y, false);
+				}
+			}
+		}
+	}
+
+	cave.Randomize(InitialWallChance, Rng);
+	for (int32 i = 0; i < SmoothingSteps; i++)
+	{
+		cave.Step(WallBirthLimit, WallSurvivalLimit);
+	}
+	cave.ConnectRegions(anchors, MinRegionSize);
+
+	for (int x = 0; x < XSize(); x++)
+	{
+		for (int y = 0; y < YSize(); y++)
+		{
+			if (GetTile(x, y) == defaultTile && cave.IsWall(x, y))
+			{
+				Set(x, y, CaveWallTile);
+			}
+		}
+	}
+}
@@ -0,0 +1,355 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonMaze.h"
+
+// -X, +X, -Y, +Y
+static const int32 DIRECTION_X[4] = { -1, 1, 0, 0 };
+static const int32 DIRECTION_Y[4] = { 0, 0, -1, 1 };
+
+FDungeonMaze::FDungeonMaze()
+{
+	Width = 0;
+	Height = 0;
+}
+
+void FDungeonMaze::Initialize(int32 MazeWidth, int32 MazeHeight)
+{
+	Width = FMath::Max(MazeWidth, 0);
+	Height = FMath::Max(MazeHeight, 0);
+	Carvable.Init(false, Width * Height);
+	Passages.Init(false, Width * Height);
+}
+
+void FDungeonMaze::SetCarvable(int32 X, int32 Y, bool bCarvable)
+{
+	if (IsInBounds(X, Y))
+	{
+		Carvable[ToIndex(X, Y)] = bCarvable;
+	}
+}
+
+void FDungeonMaze::ClearPassages()
+{
+	Passages.Init(false, Width * Height);
+}
+
+void FDungeonMaze::SetPassage(int32 X, int32 Y)
+{
+	if (IsInBounds(X, Y))
+	{
+		Passages[ToIndex(X, Y)] = true;
+	}
+}
+
+void FDungeonMaze::Generate(EMazeAlgorithm Algorithm, const FIntVector& Start, FRandomStream& Rng)
+{
+	if (!IsInBounds(Start.X, Start.Y))
+	{
+		return;
+	}
+	SetPassage(Start.X, Start.Y);
+	switch (Algorithm)
+	{
+	case EMazeAlgorithm::Prim:
+		GeneratePrim(Start, Rng);
+		break;
+	case EMazeAlgorithm::Eller:
+		GenerateEller(Start, Rng);
+		break;
+	default:
+		GenerateBacktracker(Start, Rng);
+		break;
+	}
+}
+
+bool FDungeonMaze::CanGrowInto(int32 X, int32 Y) const
+{
+	if (!IsCarvable(X, Y))
+	{
+		return false;
+	}
+	int32 adjacentCount = 0;
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		if (IsPassage(X + DIRECTION_X[direction], Y + DIRECTION_Y[direction]))
+		{
+			adjacentCount++;
+		}
+	}
+	return adjacentCount <= 1;
+}
+
+bool FDungeonMaze::CarveLatticeStep(int32 FromX, int32 FromY, int32 ToX, int32 ToY)
+{
+	int32 betweenX = (FromX + ToX) / 2;
+	int32 betweenY = (FromY + ToY) / 2;
+	if (!IsInBounds(ToX, ToY) || !IsInBounds(betweenX, betweenY) ||
+		!(Carvable[ToIndex(ToX, ToY)] || Passages[ToIndex(ToX, ToY)]) ||
+		!(Carvable[ToIndex(betweenX, betweenY)] || Passages[ToIndex(betweenX, betweenY)]))
+	{
+		return false;
+	}
+	SetPassage(betweenX, betweenY);
+	SetPassage(ToX, ToY);
+	return true;
+}
+
+void FDungeonMaze::GenerateBacktracker(const FIntVector& Start, FRandomStream& Rng)
+{
+	struct FFrame
+	{
+		int32 X;
+		int32 Y;
+		int32 Directions[4];
+		int32 NextDirection;
+	};
+
+	TArray<FFrame> stack;
+	auto push = [&stack, &Rng](int32 X, int32 Y)
+	{
+		FFrame frame;
+		frame.X = X;
+		frame.Y = Y;
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			frame.Directions[direction] = direction;
+		}
+		// Shuffle
+		for (int32 i = 0; i < 4; i++)
+		{
+			Swap(frame.Directions[Rng.RandRange(0, 3)], frame.Directions[Rng.RandRange(0, 3)]);
+		}
+		frame.NextDirection = 0;
+		stack.Add(frame);
+	};
+
+	push(Start.X, Start.Y);
+	while (stack.Num() > 0)
+	{
+		FFrame& frame = stack.Last();
+		if (frame.NextDirection >= 4)
+		{
+			stack.Pop(false);
+			continue;
+		}
+		int32 direction = frame.Directions[frame.NextDirection++];
+		int32 x = frame.X + DIRECTION_X[direction];
+		int32 y = frame.Y + DIRECTION_Y[direction];
+		if (!CanGrowInto(x, y))
+		{
+			continue;
+		}
+		SetPassage(x, y);
+		push(x, y);
+	}
+}
+
+void FDungeonMaze::GeneratePrim(const FIntVector& Start, FRandomStream& Rng)
+{
+	// Pairs of (from, to) tile indices, two tiles apart
+	TArray<TPair<int32, int32>> frontier;
+	auto addFrontier = [this, &frontier](int32 X, int32 Y)
+	{
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			int32 x = X + DIRECTION_X[direction] * 2;
+			int32 y = Y + DIRECTION_Y[direction] * 2;
+			if (IsCarvable(x, y))
+			{
+				frontier.Add(TPair<int32, int32>(ToIndex(X, Y), ToIndex(x, y)));
+			}
+		}
+	};
+
+	addFrontier(Start.X, Start.Y);
+	while (frontier.Num() > 0)
+	{
+		int32 next = Rng.RandRange(0, frontier.Num() - 1);
+		TPair<int32, int32> step = frontier[next];
+		frontier.RemoveAtSwap(next, 1, false);
+		if (Passages[step.Value])
+		{
+			continue;
+		}
+		int32 x = step.Value % Width;
+		int32 y = step.Value / Width;
+		if (!CarveLatticeStep(step.Key % Width, step.Key / Width, x, y))
+		{
+			continue;
+		}
+		addFrontier(x, y);
+	}
+}
+
+void FDungeonMaze::GenerateEller(const FIntVector& Start, FRandomStream& Rng)
+{
+	// Line the lattice up with the start, so it ends up in the maze
+	int32 originX = Start.X % 2;
+	int32 originY = Start.Y % 2;
+	int32 columns = (Width - originX + 1) / 2;
+	int32 rows = (Height - originY + 1) / 2;
+	if (columns <= 0 || rows <= 0)
+	{
+		return;
+	}
+	auto isCellOpen = [this](int32 X, int32 Y)
+	{
+		return IsInBounds(X, Y) && (Carvable[ToIndex(X, Y)] || Passages[ToIndex(X, Y)]);
+	};
+
+	// Which set each cell in the current row belongs to; 0 if the cell can't be carved
+	TArray<int32> sets;
+	sets.Init(0, columns);
+	TArray<int32> nextSets;
+	TMap<int32, int32> downCandidates;
+	TMap<int32, int32> downChoices;
+	TSet<int32> setsGoingDown;
+	int32 nextSetId = 1;
+
+	for (int32 row = 0; row < rows; row++)
+	{
+		int32 y = originY + row * 2;
+		bool bLastRow = row == rows - 1;
+		for (int32 column = 0; column < columns; column++)
+		{
+			int32 x = originX + column * 2;
+			if (!isCellOpen(x, y))
+			{
+				sets[column] = 0;
+				continue;
+			}
+			SetPassage(x, y);
+			if (sets[column] == 0)
+			{
+				sets[column] = nextSetId++;
+			}
+		}
+
+		// Randomly join neighbors in different sets; the last row joins all of them
+		for (int32 column = 0; column < columns - 1; column++)
+		{
+			int32 left = sets[column];
+			int32 right = sets[column + 1];
+			if (left == 0 || right == 0 || left == right)
+			{
+				continue;
+			}
+			if (!bLastRow && Rng.FRand() < 0.5f)
+			{
+				continue;
+			}
+			int32 x = originX + column * 2;
+			if (!CarveLatticeStep(x, y, x + 2, y))
+			{
+				continue;
+			}
+			for (int32& set : sets)
+			{
+				if (set == right)
+				{
+					set = left;
+				}
+			}
+		}
+		if (bLastRow)
+		{
+			break;
+		}
+
+		// Every set has to carry on into the next row at least once
+		nextSets.Init(0, columns);
+		downCandidates.Reset();
+		downChoices.Reset();
+		setsGoingDown.Reset();
+		for (int32 column = 0; column < columns; column++)
+		{
+			int32 set = sets[column];
+			int32 x = originX + column * 2;
+			if (set == 0 || !isCellOpen(x, y + 1) || !isCellOpen(x, y + 2))
+			{
+				continue;
+			}
+			if (Rng.FRand() < 0.5f)
+			{
+				CarveLatticeStep(x, y, x, y + 2);
+				nextSets[column] = set;
+				setsGoingDown.Add(set);
+				continue;
+			}
+			// Keep one random column per set, in case none of them go down
+			int32& candidateCount = downCandidates.FindOrAdd(set);
+			candidateCount++;
+			if (Rng.RandRange(0, candidateCount - 1) == 0)
+			{
+				downChoices.Add(set, column);
+			}
+		}
+		for (const TPair<int32, int32>& choice : downChoices)
+		{
+			if (setsGoingDown.Contains(choice.Key))
+			{
+				continue;
+			}
+			int32 x = originX + choice.Value * 2;
+			CarveLatticeStep(x, y, x, y + 2);
+			nextSets[choice.Value] = choice.Key;
+		}
+		Swap(sets, nextSets);
+	}
+}
+
+bool FDungeonMaze::AreAllReachable(const FIntVector& Start, const TArray<FIntVector>& Goals) const
+{
+	if (!IsPassage(Start.X, Start.Y))
+	{
+		return Goals.Num() == 0;
+	}
+
+	TBitArray<> goals(false, Width * Height);
+	int32 remainingGoals = 0;
+	for (const FIntVector& goal : Goals)
+	{
+		if (!IsPassage(goal.X, goal.Y))
+		{
+			return false;
+		}
+		int32 index = ToIndex(goal.X, goal.Y);
+		if (!goals[index])
+		{
+			goals[index] = true;
+			remainingGoals++;
+		}
+	}
+
+	TBitArray<> visited(false, Width * Height);
+	TArray<int32> queue;
+	int32 startIndex = ToIndex(Start.X, Start.Y);
+	visited[startIndex] = true;
+	queue.Add(startIndex);
+	for (int32 next = 0; next < queue.Num() && remainingGoals > 0; next++)
+	{
+		int32 current = queue[next];
+		if (goals[current])
+		{
+			remainingGoals--;
+		}
+		int32 x = current % Width;
+		int32 y = current / Width;
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			int32 neighborX = x + DIRECTION_X[direction];
+			int32 neighborY = y + DIRECTION_Y[direction];
+			if (!IsPassage(neighborX, neighborY))
+			{
+				continue;
+			}
+			int32 neighbor = ToIndex(neighborX, neighborY);
+			if (!visited[neighbor])
+			{
+				visited[neighbor] = true;
+				queue.Add(neighbor);
+			}
+		}
+	}
+	return remainingGoals == 0;
+}
@@ -9,6 +9,9 @@
 #include "Trials/TrialRoom.h"
 #include "LockedRoom.h"
 #include "KeyRoom.h"
+#include "TileSynthesisRules.h"
+#include "TileSynthesizer.h"
+#include "AI/Navigation/NavigationSystem.h"
 
 DEFINE_LOG_CATEGORY(LogSpaceGen);
 
@@ -20,6 +23,8 @@ ADungeonRoom::ADungeonRoom()
 
 	RoomTiles = FDungeonRoomMetadata();
 	Symbol = NULL;
+	TileSynthesisRules = NULL;
+	PendingNavigationBounds = FBox(ForceInit);
 	DummyRoot = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
 	SetRootComponent(DummyRoot);
 	GroundScatter = CreateDefaultSubobject<UGroundScatterManager>(TEXT("Ground Scatter"));
@@ -78,16 +83,7 @@ ADungeonRoom::ADungeonRoom()
 TArray<FIntVector> ADungeonRoom::GetTileLocations(const UDungeonTile* Tile)
 {
 	TArray<FIntVector> locations;
-	for (int x = 0; x < RoomTiles.XSize(); x++)
-	{
-		for (int y = 0; y < RoomTiles.YSize(); y++)
-		{
-			if (RoomTiles[y][x] == Tile)
-			{
-				locations.Add(FIntVector(x, y, 0));
-			}
-		}
-	}
+	RoomTiles.GetTileLocations(Tile, locations);
 	return locations;
 }
 
@@ -224,6 +220,13 @@ void ADungeonRoom::DoTileReplacement(FRandomStream &Rng)
 {
 	OnPreRoomTilesReplaced();
 	DoTileReplacementPreprocessing(Rng);
+	EntranceConnectivity.Initialize(RoomTiles, EntranceLocations);
+
+	if (TileSynthesisRules != NULL && SynthesizeTiles(Rng))
+	{
+		OnRoomTilesReplaced();
+		return;
+	}
 
 	// Replace them based on our replacement rules
 	TArray<FRoomReplacements> replacementPhases = RoomReplacementPhases;
@@ -245,7 +248,7 @@ void ADungeonRoom::DoTileReplacement(FRandomStream &Rng)
 				continue;
 			}
 
-			if (!replacementPatterns[rngIndex]->FindAndReplace(RoomTiles, Rng))
+			if (!replacementPatterns[rngIndex]->FindAndReplace(RoomTiles, &EntranceConnectivity, Rng))
 			{
 				// Couldn't find a replacement in this room
 				replacementPatterns.RemoveAt(rngIndex);
@@ -270,6 +273,9 @@ void ADungeonRoom::PlaceRoomTiles(TMap<const UDungeonTile*, ASpaceMeshActor*>& F
 	TMap<const UDungeonTile*, ASpaceMeshActor*>& CeilingComponentLookup,
 	FRandomStream& Rng)
 {
+	// Capture the room's frame once, rather than for every tile
+	TileInstances.Initialize(GetActorTransform(), GetRoomTileSpacePosition(), XSize(), YSize());
+
 	TMap<const UDungeonTile*, TArray<FIntVector>> tileLocations;
 	for (int x = 0; x < XSize(); x++)
 	{
@@ -328,6 +334,16 @@ void ADungeonRoom::PlaceRoomTiles(TMap<const UDungeonTile*, ASpaceMeshActor*>& F
 	CreateAllRoomTiles(tileLocations, FloorComponentLookup, CeilingComponentLookup, Rng);
 }
 
+void ADungeonRoom::BuildTileInstances()
+{
+	TileInstances.ComputeTransforms();
+}
+
+void ADungeonRoom::AddTileInstances()
+{
+	TileInstances.Submit();
+}
+
 void ADungeonRoom::DetermineGroundScatter(TMap<const UDungeonTile*, TArray<FIntVector>> TileLocations, FRandomStream& Rng)
 {
 	GroundScatter->DetermineGroundScatter(TileLocations, Rng, this);
@@ -342,6 +358,12 @@ FTransform ADungeonRoom::GetTileTransform(const FIntVector& LocalLocation) const
 
 FTransform ADungeonRoom::GetTileTransformFromTileSpace(const FIntVector& WorldLocation) const
 {
+	if (TileInstances.IsInitialized())
+	{
+		// We're in the middle of placing tiles, so the room's frame is already worked out
+		return TileInstances.GetTileTransform(WorldLocation);
+	}
+
 	float tileSize = UDungeonTile::TILE_SIZE;
 	float halfTileSize = tileSize * 0.5f;
 
@@ -393,6 +415,20 @@ FTransform ADungeonRoom::GetTileTransformFromTileSpace(const FIntVector& WorldLo
 	return FTransform(rotation, location, scale);
 }
 
+TArray<FTransform> ADungeonRoom::GetTileTransformsFromTileSpace(const TArray<FIntVector>& WorldLocations) const
+{
+	TArray<FTransform> transforms;
+	if (TileInstances.IsInitialized())
+	{
+		TileInstances.GetTileTransforms(WorldLocations, transforms);
+		return transforms;
+	}
+	FRoomTransformBatch frame;
+	frame.Initialize(GetActorTransform(), GetRoomTileSpacePosition(), XSize(), YSize());
+	frame.GetTileTransforms(WorldLocations, transforms);
+	return transforms;
+}
+
 TSet<const UDungeonTile*> ADungeonRoom::FindAllTiles()
 {
 	return RoomTiles.FindAllTiles();
@@ -400,17 +436,13 @@ TSet<const UDungeonTile*> ADungeonRoom::FindAllTiles()
 
 TSet<FIntVector> ADungeonRoom::GetAllTilesOfType(ETileType Type) const
 {
+	TArray<FIntVector> tiles;
+	RoomTiles.GetTileLocationsOfType(Type, tiles);
 	TSet<FIntVector> locations;
-	for (int x = 0; x < XSize(); x++)
+	locations.Reserve(tiles.Num());
+	for (const FIntVector& tile : tiles)
 	{
-		for (int y = 0; y < YSize(); y++)
-		{
-			const UDungeonTile* tile = GetTile(x, y);
-			if (tile != NULL && tile->TileType == Type)
-			{
-				locations.Add(FIntVector(x, y, RoomLevel));
-			}
-		}
+		locations.Add(FIntVector(tile.X, tile.Y, RoomLevel));
 	}
 	return locations;
 }
@@ -423,6 +455,39 @@ void ADungeonRoom::Set(int32 X, int32 Y, const UDungeonTile* Tile)
 		return;
 	}
 	RoomTiles.Set(X, Y, Tile);
+
+	// Once the dungeon's tile grid exists, it needs to hear about any changes
+	if (DungeonSpace != NULL && DungeonSpace->TileGrid.IsBuilt())
+	{
+		FIntVector roomPosition = RoomMetadata.Location * DungeonSpace->RoomSize;
+		DungeonSpace->TileGrid.SetTile(FIntVector(roomPosition.X + X, roomPosition.Y + Y, RoomLevel), Tile);
+
+		// The engine's navmesh was built over our old tiles, so it needs rebuilding here.
+		// Every change this tick gets sent at once, rather than one dirty area per tile.
+		if (DungeonSpace->bTileMeshesAffectNavigation)
+		{
+			bool bAlreadyPending = PendingNavigationBounds.IsValid != 0;
+			PendingNavigationBounds += GetTileBounds(FIntVector(X, Y, 0), FIntVector(X, Y, 0));
+			if (!bAlreadyPending)
+			{
+				GetWorldTimerManager().SetTimerForNextTick(this, &ADungeonRoom::FlushNavigationChanges);
+			}
+		}
+	}
+}
+
+void ADungeonRoom::FlushNavigationChanges()
+{
+	if (!PendingNavigationBounds.IsValid)
+	{
+		return;
+	}
+	UNavigationSystem* navigation = UNavigationSystem::GetCurrent<UNavigationSystem>(GetWorld());
+	if (navigation != NULL)
+	{
+		navigation->AddDirtyArea(PendingNavigationBounds, ENavigationDirtyFlag::All);
+	}
+	PendingNavigationBounds = FBox(ForceInit);
 }
 
 const UDungeonTile* ADungeonRoom::GetTile(int32 X, int32 Y) const
@@ -476,14 +541,14 @@ void ADungeonRoom::DrawDebugRoom()
 	float midY = (yPosition + halfY) * UDungeonTile::TILE_SIZE;
 	FVector startingLocation = FVector(midX, midY, zPosition);
 
-	for (FIntVector neighborLocation : RoomMetadata.NeighboringRooms)
+	for (FIntVector neighborLocation : RoomMetadata.GetNeighborLocations(RoomMetadata.NeighborMask))
 	{
-		FFloorRoom room = DungeonSpace->GetRoomFromFloorCoordinates(neighborLocation);
-		if (room.SpawnedRoom == NULL)
+		const FFloorRoom* room = DungeonSpace->FindRoom(neighborLocation);
+		if (room == NULL || room->SpawnedRoom == NULL)
 		{
 			continue;
 		}
-		ADungeonRoom* neighbor = room.SpawnedRoom;
+		ADungeonRoom* neighbor = room->SpawnedRoom;
 		float neighborHalfX = neighbor->XSize() / 2.0f;
 		float neighborHalfY = neighbor->YSize() / 2.0f;
 
@@ -499,14 +564,14 @@ void ADungeonRoom::DrawDebugRoom()
 		DrawDebugLine(GetWorld(), startingLocation, endingLocation, randomColor, true, -1.0f, (uint8)'\000', 100.0f);
 	}
 
-	for (FIntVector neighborLocation : RoomMetadata.NeighboringTightlyCoupledRooms)
+	for (FIntVector neighborLocation : RoomMetadata.GetNeighborLocations(RoomMetadata.TightlyCoupledNeighborMask))
 	{
-		FFloorRoom room = DungeonSpace->GetRoomFromFloorCoordinates(neighborLocation);
-		if (room.SpawnedRoom == NULL)
+		const FFloorRoom* room = DungeonSpace->FindRoom(neighborLocation);
+		if (room == NULL || room->SpawnedRoom == NULL)
 		{
 			continue;
 		}
-		ADungeonRoom* neighbor = room.SpawnedRoom;
+		ADungeonRoom* neighbor = room->SpawnedRoom;
 		float neighborHalfX = neighbor->XSize() / 2.0f;
 		float neighborHalfY = neighbor->YSize() / 2.0f;
 
@@ -678,6 +743,21 @@ FIntVector ADungeonRoom::GetRoomTileSpacePosition() const
 	return tileSpacePosition;
 }
 
+FBox ADungeonRoom::GetRoomBounds() const
+{
+	return GetTileBounds(FIntVector(0, 0, 0), FIntVector(XSize() - 1, YSize() - 1, 0));
+}
+
+FBox ADungeonRoom::GetTileBounds(const FIntVector& MinTile, const FIntVector& MaxTile) const
+{
+	// Tile meshes can be offset by up to a tile depending on which edge they're on,
+	// and walls go all the way up to the ceiling
+	FIntVector position = GetRoomTileSpacePosition();
+	FVector min = FVector(position.X + MinTile.X - 1, position.Y + MinTile.Y - 1, position.Z) * UDungeonTile::TILE_SIZE;
+	FVector max = FVector(position.X + MaxTile.X + 2, position.Y + MaxTile.Y + 2, position.Z + FMath::Max((int32)ActualRoomHeight, 1) + 1) * UDungeonTile::TILE_SIZE;
+	return FBox(min, max);
+}
+
 void ADungeonRoom::SetTileGridCoordinates(FIntVector CurrentLocation, const UDungeonTile* Tile)
 {
 	FVector position = GetActorLocation();
@@ -693,16 +773,21 @@ float ADungeonRoom::GetRoomDifficulty() const
 
 void ADungeonRoom::TryToPlaceEntrances(const UDungeonTile* EntranceTile, FRandomStream& Rng)
 {
-	TSet<FIntVector> neighbors = RoomMetadata.NeighboringRooms;
-	for (FIntVector neighbor : neighbors)
+	for (int32 direction = 0; direction < FFloorRoom::DIRECTION_COUNT; direction++)
 	{
-		AddNeighborEntrances(neighbor, Rng, EntranceTile);
+		if (RoomMetadata.NeighborMask & (1 << direction))
+		{
+			AddNeighborEntrances(RoomMetadata.GetNeighborLocation(direction), Rng, EntranceTile);
+		}
 	}
 	// Now process any tightly-coupled neighbors
-	neighbors = RoomMetadata.NeighboringTightlyCoupledRooms;
-	for (FIntVector neighbor : neighbors)
+	for (int32 direction = 0; direction < FFloorRoom::DIRECTION_COUNT; direction++)
 	{
-		ADungeonRoom* roomNeighbor = AddNeighborEntrances(neighbor, Rng, EntranceTile);
+		if ((RoomMetadata.TightlyCoupledNeighborMask & (1 << direction)) == 0)
+		{
+			continue;
+		}
+		ADungeonRoom* roomNeighbor = AddNeighborEntrances(RoomMetadata.GetNeighborLocation(direction), Rng, EntranceTile);
 		if (roomNeighbor != NULL)
 		{
 			TightlyCoupledNeighbors.Add(roomNeighbor);
@@ -716,12 +801,63 @@ void ADungeonRoom::DoTileReplacementPreprocessing(FRandomStream& Rng)
 	/* Empty */
 }
 
+bool ADungeonRoom::SynthesizeTiles(FRandomStream& Rng)
+{
+	// Everything still holding the default floor gets synthesized; walls and entrances stay put
+	const UDungeonTile* freeTile = GetTile(1, 1);
+	if (freeTile == NULL)
+	{
+		return false;
+	}
+
+	FTileSynthesizer synthesizer;
+	synthesizer.Initialize(TileSynthesisRules, RoomTiles, freeTile);
+	// Keep the ground just inside each entrance walkable
+	for (const FIntVector& entrance : EntranceLocations)
+	{
+		synthesizer.RestrictToType(entrance.X - 1, entrance.Y, ETileType::Floor);
+		synthesizer.RestrictToType(entrance.X + 1, entrance.Y, ETileType::Floor);
+		synthesizer.RestrictToType(entrance.X, entrance.Y - 1, ETileType::Floor);
+		synthesizer.RestrictToType(entrance.X, entrance.Y + 1, ETileType::Floor);
+	}
+
+	for (int32 attempt = 0; attempt < TileSynthesisRules->MaxAttempts; attempt++)
+	{
+		if (!synthesizer.Solve(Rng, TileSynthesisRules->MaxBacktracks))
+		{
+			continue;
+		}
+		FDungeonRoomMetadata synthesized = RoomTiles;
+		synthesizer.Apply(synthesized);
+		FRoomConnectivity connectivity;
+		connectivity.Initialize(synthesized, EntranceLocations);
+		if (!connectivity.AreEntrancesConnected())
+		{
+			continue;
+		}
+
+		for (int32 y = 0; y < synthesized.YSize(); y++)
+		{
+			for (int32 x = 0; x < synthesized.XSize(); x++)
+			{
+				Set(x, y, synthesized.DungeonRows[y].DungeonTiles[x]);
+			}
+		}
+		EntranceConnectivity = connectivity;
+		return true;
+	}
+
+	UE_LOG(LogSpaceGen, Warning, TEXT("Could not synthesize tiles for %s after %d attempts; using its replacement phases instead."), *GetName(), TileSynthesisRules->MaxAttempts);
+	return false;
+}
+
 ADungeonRoom* ADungeonRoom::AddNeighborEntrances(const FIntVector& Neighbor, FRandomStream& Rng, 
 	const UDungeonTile* EntranceTile)
 {
 	// We handle spawning the entrance to the room above or to the right of us
 	// The other room will spawn any other entrances
 	ADungeonRoom* roomNeighbor = NULL;
+	const FFloorRoom* neighborRoom = DungeonSpace->FindRoom(Neighbor);
 	FIntVector ourLocation = FIntVector::ZeroValue;
 	FIntVector neighborLocation = FIntVector::ZeroValue;
 	if (Neighbor.X > RoomMetadata.Location.X)
@@ -730,7 +866,7 @@ ADungeonRoom* ADungeonRoom::AddNeighborEntrances(const FIntVector& Neighbor, FRa
 		ourLocation.X = XSize() - 1;
 		ourLocation.Y = entranceLocation;
 		
-		roomNeighbor = DungeonSpace->GetRoomFromFloorCoordinates(Neighbor).SpawnedRoom;
+		roomNeighbor = neighborRoom != NULL ? neighborRoom->SpawnedRoom : NULL;
 		neighborLocation.X = 0;
 		neighborLocation.Y = entranceLocation;
 	}
@@ -740,7 +876,7 @@ ADungeonRoom* ADungeonRoom::AddNeighborEntrances(const FIntVector& Neighbor, FRa
 		ourLocation.X = entranceLocation;
 		ourLocation.Y = YSize() - 1;
 
-		roomNeighbor = DungeonSpace->GetRoomFromFloorCoordinates(Neighbor).SpawnedRoom;
+		roomNeighbor = neighborRoom != NULL ? neighborRoom->SpawnedRoom : NULL;
 		neighborLocation.X = entranceLocation;
 		neighborLocation.Y = 0;
 	}
@@ -766,12 +902,16 @@ void ADungeonRoom::PlaceTile(TMap<const UDungeonTile*, ASpaceMeshActor*>& Compon
 		return;
 	}
 
-	FTransform objectTransform = CreateMeshTransform(MeshTransformOffset, Location);
-	ComponentLookup[Tile]->AddInstance(MeshID, objectTransform);
+	TileInstances.AddInstance(ComponentLookup[Tile], MeshID, MeshTransformOffset, Location);
 }
 
 FTransform ADungeonRoom::CreateMeshTransform(const FTransform &MeshTransformOffset, const FIntVector &Location) const
 {
+	if (TileInstances.IsInitialized())
+	{
+		return TileInstances.GetMeshTransform(MeshTransformOffset, Location);
+	}
+
 	// Fetch Dungeon transform
 	FTransform actorTransform = GetActorTransform();
 	FVector actorPosition = actorTransform.GetLocation();
@@ -788,6 +928,86 @@ FTransform ADungeonRoom::CreateMeshTransform(const FTransform &MeshTransformOffs
 	return FTransform(finalRotation, finalPosition, MeshTransformOffset.GetScale3D());
 }
 
+int32 ADungeonRoom::ChooseWallMeshes(const UDungeonTile* WallTile, TBitArray<>& OutUsableColumns, FRandomStream& Rng) const
+{
+	int32 meshSelection;
+	if (FloorTileMeshSelections.Contains(WallTile))
+	{
+		meshSelection = FloorTileMeshSelections[WallTile];
+	}
+	else
+	{
+		do
+		{
+			meshSelection = Rng.RandRange(0, WallTile->GroundMesh.Num() - 1);
+		} while (WallTile->GroundMesh[meshSelection].SelectionChance < Rng.GetFraction());
+	}
+
+	OutUsableColumns.Init(false, WallTile->ColumnMeshes.Num());
+	if (WallTile->WallColumnMode == EWallColumnMode::TallMeshes)
+	{
+		for (int32 i = 0; i < WallTile->ColumnMeshes.Num(); i++)
+		{
+			OutUsableColumns[i] = WallTile->ColumnMeshes[i].SelectionChance >= Rng.GetFraction();
+		}
+	}
+	return meshSelection;
+}
+
+void ADungeonRoom::PlaceWallColumn(ASpaceMeshActor* MeshActor, const UDungeonTile* WallTile, int32 MeshSelection,
+	const TBitArray<>& UsableColumns, FIntVector Location, int32 Layers)
+{
+	// The ground mesh already covers the bottom layer
+	Location.Z = 1;
+	switch (WallTile->WallColumnMode)
+	{
+	case EWallColumnMode::Stretched:
+	{
+		FTransform offset;
+		offset.SetScale3D(FVector(1.0f, 1.0f, (float)Layers));
+		TileInstances.AddInstance(MeshActor, MeshSelection, offset, Location);
+		return;
+	}
+	case EWallColumnMode::TallMeshes:
+	{
+		// Use the tallest column mesh which still fits, over and over
+		while (Layers > 0)
+		{
+			int32 columnHeight = FMath::Min(Layers, WallTile->ColumnMeshes.Num());
+			UHierarchicalInstancedStaticMeshComponent* columnComponent = NULL;
+			for (; columnHeight > 0; columnHeight--)
+			{
+				if (UsableColumns[columnHeight - 1])
+				{
+					columnComponent = MeshActor->GetColumnComponent(columnHeight - 1);
+					if (columnComponent != NULL)
+					{
+						break;
+					}
+				}
+			}
+			if (columnComponent == NULL)
+			{
+				// Nothing short enough; fill in the rest a layer at a time
+				break;
+			}
+			TileInstances.AddInstance(columnComponent, WallTile->ColumnMeshes[columnHeight - 1].Transform, Location);
+			Location.Z += columnHeight;
+			Layers -= columnHeight;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	for (; Layers > 0; Layers--)
+	{
+		TileInstances.AddInstance(MeshActor, MeshSelection, FTransform(), Location);
+		Location.Z++;
+	}
+}
+
 AActor* ADungeonRoom::SpawnInteraction(const UDungeonTile* Tile, FDungeonTileInteractionOptions TileInteractionOptions, 
 	const FIntVector& Location, FRandomStream& Rng)
 {
@@ -903,23 +1123,39 @@ void ADungeonRoom::CreateAllRoomTiles(TMap<const UDungeonTile*, TArray<FIntVecto
 	// Spawn walls up to the ceiling height
 	if (ActualRoomHeight > 1)
 	{
-		const UDungeonTile* wallTile = GetTile(0, 0);
-		if (FloorComponentLookup.Contains(wallTile))
+		// Every wall tile gets stacked with its own meshes, since the walls may have been
+		// swapped for several different variants (corners, edges, and so on)
+		for (auto& kvp : TileLocations)
 		{
-			int32 meshSelection = FloorTileMeshSelections[wallTile];
-			TArray<FIntVector> wallLocations = GetTileLocations(wallTile);
-			wallLocations.Append(EntranceLocations.Array());
-			for (int i = 1; i < ActualRoomHeight; i++)
+			const UDungeonTile* wallTile = kvp.Key;
+			if (wallTile == NULL || wallTile->TileType != ETileType::Wall || !FloorComponentLookup.Contains(wallTile))
 			{
-				for (int j = 0; j < wallLocations.Num(); j++)
+				continue;
+			}
+			ASpaceMeshActor* wallMeshActor = FloorComponentLookup[wallTile];
+			TBitArray<> usableColumns;
+			int32 meshSelection = ChooseWallMeshes(wallTile, usableColumns, Rng);
+			for (const FIntVector& location : kvp.Value)
+			{
+				if (!EntranceLocations.Contains(location))
 				{
-					FIntVector location = wallLocations[j];
-					location.Z = i;
-					FTransform offset;
-					PlaceTile(FloorComponentLookup, wallTile, FloorTileMeshSelections[wallTile], offset, location);
+					PlaceWallColumn(wallMeshActor, wallTile, meshSelection, usableColumns, location, ActualRoomHeight - 1);
 				}
 			}
 		}
+
+		// Above the entrances, carry on the room's outer wall
+		const UDungeonTile* entranceWallTile = GetTile(0, 0);
+		if (EntranceLocations.Num() > 0 && FloorComponentLookup.Contains(entranceWallTile))
+		{
+			ASpaceMeshActor* wallMeshActor = FloorComponentLookup[entranceWallTile];
+			TBitArray<> usableColumns;
+			int32 meshSelection = ChooseWallMeshes(entranceWallTile, usableColumns, Rng);
+			for (const FIntVector& location : EntranceLocations)
+			{
+				PlaceWallColumn(wallMeshActor, entranceWallTile, meshSelection, usableColumns, location, ActualRoomHeight - 1);
+			}
+		}
 	}
 
 	// Place tile interactions
@@ -212,12 +212,12 @@ bool UGroundScatterManager::IsAdjacencyOkay(ETileDirection Direction, const UGro
 			{
 				for (int y = -1; y <= 1; y++)
 				{
-					FFloorRoom nextRoom = Room->DungeonFloor->GetRoomFromTileSpace(Location + FIntVector(x, y, Location.Z));
-					if (nextRoom.SpawnedRoom == NULL || nextRoom.SpawnedRoom == Room)
+					const FFloorRoom* nextRoom = Room->DungeonFloor->FindRoomFromTileSpace(Location + FIntVector(x, y, Location.Z));
+					if (nextRoom == NULL || nextRoom->SpawnedRoom == NULL || nextRoom->SpawnedRoom == Room)
 					{
 						continue;
 					}
-					if (Room->RoomMetadata.GetOutgoingRooms().Contains(nextRoom.Location))
+					if (Room->RoomMetadata.IsOutgoingRoom(nextRoom->Location))
 					{
 						return false;
 					}
@@ -231,12 +231,12 @@ bool UGroundScatterManager::IsAdjacencyOkay(ETileDirection Direction, const UGro
 			{
 				for (int y = -1; y <= 1; y++)
 				{
-					FFloorRoom nextRoom = Room->DungeonFloor->GetRoomFromTileSpace(Location + FIntVector(x, y, Location.Z));
-					if (nextRoom.SpawnedRoom == NULL || nextRoom.SpawnedRoom == Room)
+					const FFloorRoom* nextRoom = Room->DungeonFloor->FindRoomFromTileSpace(Location + FIntVector(x, y, Location.Z));
+					if (nextRoom == NULL || nextRoom->SpawnedRoom == NULL || nextRoom->SpawnedRoom == Room)
 					{
 						continue;
 					}
-					if (Room->RoomMetadata.IncomingRoom == nextRoom.Location)
+					if (Room->RoomMetadata.IncomingRoom == nextRoom->Location)
 					{
 						return false;
 					}
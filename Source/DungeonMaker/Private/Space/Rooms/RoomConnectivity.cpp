@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RoomConnectivity.h"
+
+static const int32 DIRECTION_X[4] = { -1, 1, 0, 0 };
+static const int32 DIRECTION_Y[4] = { 0, 0, -1, 1 };
+
+FRoomConnectivity::FRoomConnectivity()
+{
+	bInitialized = false;
+	Width = 0;
+	Height = 0;
+	bEntrancesConnected = false;
+	bGroupsValid = false;
+	bPatchRemovedFloor = false;
+	bConnectedBeforePatch = false;
+}
+
+void FRoomConnectivity::Initialize(const FDungeonRoomMetadata& Room, const TSet<FIntVector>& Entrances)
+{
+	bInitialized = true;
+	Width = Room.XSize();
+	Height = Room.YSize();
+	Walkable.Init(false, Width * Height);
+	EntranceBits.Init(false, Width * Height);
+	EntranceTiles.Reset();
+	PatchLog.Reset();
+	bPatchRemovedFloor = false;
+
+	for (const FIntVector& entrance : Entrances)
+	{
+		if (entrance.X < 0 || entrance.Y < 0 || entrance.X >= Width || entrance.Y >= Height)
+		{
+			continue;
+		}
+		int32 index = ToIndex(entrance.X, entrance.Y);
+		EntranceBits[index] = true;
+		EntranceTiles.Add(index);
+	}
+	for (int32 y = 0; y < Height; y++)
+	{
+		for (int32 x = 0; x < Width; x++)
+		{
+			int32 index = ToIndex(x, y);
+			Walkable[index] = EntranceBits[index] || IsWalkable(Room.DungeonRows[y].DungeonTiles[x]);
+		}
+	}
+
+	RebuildGroups();
+	bEntrancesConnected = AreEntrancesInOneGroup();
+}
+
+int32 FRoomConnectivity::FindGroup(int32 Tile)
+{
+	while (Parents[Tile] != Tile)
+	{
+		// Path halving
+		Parents[Tile] = Parents[Parents[Tile]];
+		Tile = Parents[Tile];
+	}
+	return Tile;
+}
+
+void FRoomConnectivity::JoinGroups(int32 A, int32 B)
+{
+	A = FindGroup(A);
+	B = FindGroup(B);
+	if (A == B)
+	{
+		return;
+	}
+	if (GroupSizes[A] < GroupSizes[B])
+	{
+		Swap(A, B);
+	}
+	Parents[B] = A;
+	GroupSizes[A] += GroupSizes[B];
+}
+
+void FRoomConnectivity::JoinNeighbors(int32 Tile)
+{
+	int32 x = Tile % Width;
+	int32 y = Tile / Width;
+	for (int32 direction = 0; direction < 4; direction++)
+	{
+		int32 neighborX = x + DIRECTION_X[direction];
+		int32 neighborY = y + DIRECTION_Y[direction];
+		if (neighborX < 0 || neighborY < 0 || neighborX >= Width || neighborY >= Height)
+		{
+			continue;
+		}
+		int32 neighbor = ToIndex(neighborX, neighborY);
+		if (Walkable[neighbor])
+		{
+			JoinGroups(Tile, neighbor);
+		}
+	}
+}
+
+void FRoomConnectivity::RebuildGroups()
+{
+	int32 tileCount = Width * Height;
+	Parents.SetNumUninitialized(tileCount);
+	GroupSizes.Init(1, tileCount);
+	for (int32 tile = 0; tile < tileCount; tile++)
+	{
+		Parents[tile] = tile;
+	}
+	for (TConstSetBitIterator<> tile(Walkable); tile; ++tile)
+	{
+		JoinNeighbors(tile.GetIndex());
+	}
+	bGroupsValid = true;
+}
+
+bool FRoomConnectivity::AreEntrancesInOneGroup()
+{
+	for (int32 i = 1; i < EntranceTiles.Num(); i++)
+	{
+		if (FindGroup(EntranceTiles[i]) != FindGroup(EntranceTiles[0]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FRoomConnectivity::CanFloodFillReachEntrances()
+{
+	if (EntranceTiles.Num() <= 1)
+	{
+		return true;
+	}
+
+	Visited.Init(false, Width * Height);
+	Queue.Reset();
+	Visited[EntranceTiles[0]] = true;
+	Queue.Add(EntranceTiles[0]);
+	int32 remainingEntrances = EntranceTiles.Num() - 1;
+	for (int32 next = 0; next < Queue.Num(); next++)
+	{
+		int32 x = Queue[next] % Width;
+		int32 y = Queue[next] / Width;
+		for (int32 direction = 0; direction < 4; direction++)
+		{
+			int32 neighborX = x + DIRECTION_X[direction];
+			int32 neighborY = y + DIRECTION_Y[direction];
+			if (neighborX < 0 || neighborY < 0 || neighborX >= Width || neighborY >= Height)
+			{
+				continue;
+			}
+			int32 neighbor = ToIndex(neighborX, neighborY);
+			if (Visited[neighbor] || !Walkable[neighbor])
+			{
+				continue;
+			}
+			Visited[neighbor] = true;
+			if (EntranceBits[neighbor] && --remainingEntrances == 0)
+			{
+				return true;
+			}
+			Queue.Add(neighbor);
+		}
+	}
+	return false;
+}
+
+void FRoomConnectivity::BeginPatch()
+{
+	PatchLog.Reset();
+	bPatchRemovedFloor = false;
+	bConnectedBeforePatch = bEntrancesConnected;
+}
+
+void FRoomConnectivity::SetTile(int32 X, int32 Y, const UDungeonTile* Tile)
+{
+	if (!bInitialized || X < 0 || Y < 0 || X >= Width || Y >= Height)
+	{
+		return;
+	}
+	int32 index = ToIndex(X, Y);
+	bool bWalkable = EntranceBits[index] || IsWalkable(Tile);
+	if (Walkable[index] == bWalkable)
+	{
+		return;
+	}
+	PatchLog.Add(TPair<int32, bool>(index, Walkable[index]));
+	Walkable[index] = bWalkable;
+	if (!bWalkable)
+	{
+		bPatchRemovedFloor = true;
+	}
+	else if (bGroupsValid)
+	{
+		JoinNeighbors(index);
+	}
+}
+
+bool FRoomConnectivity::EndPatch()
+{
+	if (!bInitialized)
+	{
+		return true;
+	}
+	if (bPatchRemovedFloor)
+	{
+		// This might have split a group, so the union-find can't be trusted anymore
+		bGroupsValid = false;
+		bEntrancesConnected = CanFloodFillReachEntrances();
+	}
+	else if (bGroupsValid)
+	{
+		bEntrancesConnected = AreEntrancesInOneGroup();
+	}
+	else if (!bEntrancesConnected && PatchLog.Num() > 0)
+	{
+		RebuildGroups();
+		bEntrancesConnected = AreEntrancesInOneGroup();
+	}
+	// Otherwise we were connected and only added floor, so we still are
+
+	return bEntrancesConnected || !bConnectedBeforePatch;
+}
+
+void FRoomConnectivity::RollBackPatch()
+{
+	for (int32 i = PatchLog.Num() - 1; i >= 0; i--)
+	{
+		Walkable[PatchLog[i].Key] = PatchLog[i].Value;
+	}
+	if (PatchLog.Num() > 0)
+	{
+		// Joined groups can't be split back apart
+		bGroupsValid = false;
+	}
+	PatchLog.Reset();
+	bPatchRemovedFloor = false;
+	bEntrancesConnected = bConnectedBeforePatch;
+}
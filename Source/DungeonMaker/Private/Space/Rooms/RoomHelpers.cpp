@@ -6,6 +6,93 @@
 
 const float UDungeonTile::TILE_SIZE = 500.0f;
 
+void FDungeonRoomMetadata::Set(int X, int Y, const UDungeonTile* Tile)
+{
+	if (TileTypeLayers[0].Num() != XSize() * YSize())
+	{
+		// The grid was filled in without us (probably loaded from an asset)
+		RebuildTileLayers();
+	}
+
+	const UDungeonTile* previousTile = DungeonRows[Y][X];
+	if (previousTile == Tile)
+	{
+		return;
+	}
+
+	int32 bit = ToLayerIndex(X, Y);
+	if (previousTile != NULL)
+	{
+		TileLayers[previousTile][bit] = false;
+		TileTypeLayers[(int32)previousTile->TileType][bit] = false;
+	}
+	if (Tile != NULL)
+	{
+		TBitArray<>* layer = TileLayers.Find(Tile);
+		if (layer == NULL)
+		{
+			layer = &TileLayers.Add(Tile, TBitArray<>(false, XSize() * YSize()));
+		}
+		(*layer)[bit] = true;
+		TileTypeLayers[(int32)Tile->TileType][bit] = true;
+	}
+	DungeonRows[Y].Set(X, Tile);
+}
+
+void FDungeonRoomMetadata::GetTileLocations(const UDungeonTile* Tile, TArray<FIntVector>& OutLocations) const
+{
+	CheckTileLayers();
+	const TBitArray<>* layer = TileLayers.Find(Tile);
+	if (layer == NULL)
+	{
+		return;
+	}
+	int32 ySize = YSize();
+	for (TConstSetBitIterator<> bit(*layer); bit; ++bit)
+	{
+		OutLocations.Add(FIntVector(bit.GetIndex() / ySize, bit.GetIndex() % ySize, 0));
+	}
+}
+
+void FDungeonRoomMetadata::GetTileLocationsOfType(ETileType Type, TArray<FIntVector>& OutLocations) const
+{
+	CheckTileLayers();
+	const TBitArray<>& layer = TileTypeLayers[(int32)Type];
+	int32 ySize = YSize();
+	for (TConstSetBitIterator<> bit(layer); bit; ++bit)
+	{
+		OutLocations.Add(FIntVector(bit.GetIndex() / ySize, bit.GetIndex() % ySize, 0));
+	}
+}
+
+void FDungeonRoomMetadata::RebuildTileLayers()
+{
+	int32 layerSize = XSize() * YSize();
+	TileLayers.Reset();
+	for (int32 i = 0; i < TILE_TYPE_COUNT; i++)
+	{
+		TileTypeLayers[i].Init(false, layerSize);
+	}
+	for (int x = 0; x < XSize(); x++)
+	{
+		for (int y = 0; y < YSize(); y++)
+		{
+			const UDungeonTile* tile = DungeonRows[y].DungeonTiles[x];
+			if (tile == NULL)
+			{
+				continue;
+			}
+			TBitArray<>* layer = TileLayers.Find(tile);
+			if (layer == NULL)
+			{
+				layer = &TileLayers.Add(tile, TBitArray<>(false, layerSize));
+			}
+			(*layer)[ToLayerIndex(x, y)] = true;
+			TileTypeLayers[(int32)tile->TileType][ToLayerIndex(x, y)] = true;
+		}
+	}
+}
+
 FColor FDungeonRoomMetadata::DrawRoom(AActor* ContextObject, FIntVector Position)
 {
 	int32 xPosition = Position.X;
@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RoomTransformBatch.h"
+#include "SpaceMeshActor.h"
+#include "DungeonTile.h"
+
+static const int32 EDGE_LEFT = 1 << 0;
+static const int32 EDGE_RIGHT = 1 << 1;
+static const int32 EDGE_TOP = 1 << 2;
+static const int32 EDGE_BOTTOM = 1 << 3;
+
+// Same precedence as ADungeonRoom::GetTileDirection
+static ETileDirection GetDirectionFromEdges(int32 EdgeMask)
+{
+	bool bIsOnLeft = (EdgeMask & EDGE_LEFT) != 0;
+	bool bIsOnRight = (EdgeMask & EDGE_RIGHT) != 0;
+	bool bIsOnTop = (EdgeMask & EDGE_TOP) != 0;
+	bool bIsOnBottom = (EdgeMask & EDGE_BOTTOM) != 0;
+	if (bIsOnLeft && bIsOnTop)
+	{
+		return ETileDirection::Northwest;
+	}
+	else if (bIsOnRight && bIsOnTop)
+	{
+		return ETileDirection::Northeast;
+	}
+	else if (bIsOnLeft && bIsOnBottom)
+	{
+		return ETileDirection::Southwest;
+	}
+	else if (bIsOnRight && bIsOnBottom)
+	{
+		return ETileDirection::Southeast;
+	}
+	else if (bIsOnTop)
+	{
+		return ETileDirection::North;
+	}
+	else if (bIsOnBottom)
+	{
+		return ETileDirection::South;
+	}
+	else if (bIsOnLeft)
+	{
+		return ETileDirection::West;
+	}
+	else if (bIsOnRight)
+	{
+		return ETileDirection::East;
+	}
+	return ETileDirection::Center;
+}
+
+FRoomTransformBatch::FRoomTransformBatch()
+{
+	bInitialized = false;
+	ActorLocation = FVector::ZeroVector;
+	ActorRotation = FRotator::ZeroRotator;
+	ActorScale = FVector::OneVector;
+	RoomPosition = FIntVector::ZeroValue;
+	XSize = 0;
+	YSize = 0;
+	LastGroup = INDEX_NONE;
+}
+
+void FRoomTransformBatch::Initialize(const FTransform& ActorTransform, const FIntVector& RoomTileSpacePosition, int32 RoomXSize, int32 RoomYSize)
+{
+	bInitialized = true;
+	ActorLocation = ActorTransform.GetLocation();
+	ActorRotation = ActorTransform.Rotator();
+	ActorScale = ActorTransform.GetScale3D();
+	RoomPosition = RoomTileSpacePosition;
+	XSize = RoomXSize;
+	YSize = RoomYSize;
+	Groups.Reset();
+	LastGroup = INDEX_NONE;
+
+	// Matches the offsets and turns in ADungeonRoom::GetTileTransformFromTileSpace
+	float tileSize = UDungeonTile::TILE_SIZE;
+	float halfTileSize = tileSize * 0.5f;
+	for (int32 edgeMask = 0; edgeMask < EDGE_MASK_COUNT; edgeMask++)
+	{
+		FVector offset = FVector::ZeroVector;
+		float yaw = 0.0f;
+		switch (GetDirectionFromEdges(edgeMask))
+		{
+		case ETileDirection::Center:
+			offset.X -= halfTileSize;
+			offset.Y -= halfTileSize;
+			break;
+		case ETileDirection::North:
+			break;
+		case ETileDirection::South:
+			offset.Y -= tileSize;
+			yaw = 180.0f;
+			break;
+		case ETileDirection::East:
+			yaw = 90.0f;
+			break;
+		case ETileDirection::West:
+			offset.X += tileSize;
+			yaw = 270.0f;
+			break;
+		case ETileDirection::Northeast:
+			yaw = 45.0f;
+			break;
+		case ETileDirection::Northwest:
+			offset.X += tileSize;
+			yaw = 315.0f;
+			break;
+		case ETileDirection::Southeast:
+			offset.Y -= tileSize;
+			yaw = 135.0f;
+			break;
+		case ETileDirection::Southwest:
+			offset.X += tileSize;
+			offset.Y -= tileSize;
+			yaw = 225.0f;
+			break;
+		default:
+			checkNoEntry();
+			break;
+		}
+		FRotator rotation = ActorRotation;
+		rotation.Yaw += yaw;
+		EdgeRotations[edgeMask] = rotation.Quaternion();
+		EdgeOffsets[edgeMask] = offset;
+	}
+}
+
+int32 FRoomTransformBatch::GetEdgeMask(const FIntVector& TileSpaceLocation) const
+{
+	int32 edgeMask = 0;
+	if (TileSpaceLocation.X == RoomPosition.X)
+	{
+		edgeMask |= EDGE_LEFT;
+	}
+	if (TileSpaceLocation.X == RoomPosition.X + XSize - 1)
+	{
+		edgeMask |= EDGE_RIGHT;
+	}
+	if (TileSpaceLocation.Y == RoomPosition.Y)
+	{
+		edgeMask |= EDGE_TOP;
+	}
+	if (TileSpaceLocation.Y == RoomPosition.Y + YSize - 1)
+	{
+		edgeMask |= EDGE_BOTTOM;
+	}
+	return edgeMask;
+}
+
+int32 FRoomTransformBatch::FindOrAddGroup(UHierarchicalInstancedStaticMeshComponent* MeshComponent, const FTransform& MeshTransformOffset)
+{
+	auto matches = [MeshComponent, &MeshTransformOffset](const FInstanceGroup& Group)
+	{
+		return Group.MeshComponent == MeshComponent && Group.MeshTransformOffset.Equals(MeshTransformOffset, 0.0f);
+	};
+	if (Groups.IsValidIndex(LastGroup) && matches(Groups[LastGroup]))
+	{
+		return LastGroup;
+	}
+	for (int32 i = 0; i < Groups.Num(); i++)
+	{
+		if (matches(Groups[i]))
+		{
+			LastGroup = i;
+			return i;
+		}
+	}
+
+	LastGroup = Groups.AddDefaulted();
+	FInstanceGroup& group = Groups[LastGroup];
+	group.MeshComponent = MeshComponent;
+	group.MeshTransformOffset = MeshTransformOffset;
+	// Rotations get added as rotators, same as ADungeonRoom::CreateMeshTransform
+	FRotator meshRotation = FRotator(MeshTransformOffset.GetRotation());
+	FRotator rotation = ActorRotation;
+	rotation.Add(meshRotation.Pitch, meshRotation.Yaw, meshRotation.Roll);
+	group.Rotation = rotation.Quaternion();
+	group.Origin = ActorLocation + MeshTransformOffset.GetLocation();
+	return LastGroup;
+}
+
+void FRoomTransformBatch::AddInstance(ASpaceMeshActor* MeshActor, int32 MeshID, const FTransform& MeshTransformOffset, const FIntVector& Location)
+{
+	AddInstance(MeshActor->GetMeshComponent(MeshID), MeshTransformOffset, Location);
+}
+
+void FRoomTransformBatch::AddInstance(UHierarchicalInstancedStaticMeshComponent* MeshComponent, const FTransform& MeshTransformOffset, const FIntVector& Location)
+{
+	check(bInitialized);
+	check(MeshComponent != NULL);
+	FInstanceGroup& group = Groups[FindOrAddGroup(MeshComponent, MeshTransformOffset)];
+	group.X.Add((float)Location.X);
+	group.Y.Add((float)Location.Y);
+	group.Z.Add((float)Location.Z);
+}
+
+void FRoomTransformBatch::ComputeTransforms()
+{
+	const VectorRegister tileSize = VectorSetFloat1(UDungeonTile::TILE_SIZE);
+	TArray<float> positions[3];
+	for (FInstanceGroup& group : Groups)
+	{
+		const int32 count = group.X.Num();
+		const TArray<float>* tiles[3] = { &group.X, &group.Y, &group.Z };
+		const float origin[3] = { group.Origin.X, group.Origin.Y, group.Origin.Z };
+		for (int32 axis = 0; axis < 3; axis++)
+		{
+			positions[axis].SetNumUninitialized(count, false);
+			const float* tile = tiles[axis]->GetData();
+			float* position = positions[axis].GetData();
+			const VectorRegister axisOrigin = VectorSetFloat1(origin[axis]);
+			int32 i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				VectorStore(VectorMultiplyAdd(VectorLoad(tile + i), tileSize, axisOrigin), position + i);
+			}
+			for (; i < count; i++)
+			{
+				position[i] = origin[axis] + tile[i] * UDungeonTile::TILE_SIZE;
+			}
+		}
+
+		const FVector scale = group.MeshTransformOffset.GetScale3D();
+		group.Transforms.SetNumUninitialized(count);
+		for (int32 i = 0; i < count; i++)
+		{
+			group.Transforms[i] = FTransform(group.Rotation, FVector(positions[0][i], positions[1][i], positions[2][i]), scale);
+		}
+	}
+}
+
+void FRoomTransformBatch::Submit()
+{
+	for (const FInstanceGroup& group : Groups)
+	{
+		if (group.Transforms.Num() != group.X.Num())
+		{
+			// Nobody computed these yet
+			ComputeTransforms();
+			break;
+		}
+	}
+	for (const FInstanceGroup& group : Groups)
+	{
+		ASpaceMeshActor::AddInstances(group.MeshComponent, group.Transforms);
+	}
+	Groups.Reset();
+	LastGroup = INDEX_NONE;
+	bInitialized = false;
+}
+
+int32 FRoomTransformBatch::Num() const
+{
+	int32 count = 0;
+	for (const FInstanceGroup& group : Groups)
+	{
+		count += group.X.Num();
+	}
+	return count;
+}
+
+FTransform FRoomTransformBatch::GetMeshTransform(const FTransform& MeshTransformOffset, const FIntVector& Location) const
+{
+	FRotator meshRotation = FRotator(MeshTransformOffset.GetRotation());
+	FRotator rotation = ActorRotation;
+	rotation.Add(meshRotation.Pitch, meshRotation.Yaw, meshRotation.Roll);
+	FVector offset = FVector(Location.X * UDungeonTile::TILE_SIZE, Location.Y * UDungeonTile::TILE_SIZE, Location.Z * UDungeonTile::TILE_SIZE);
+	return FTransform(rotation, ActorLocation + MeshTransformOffset.GetLocation() + offset, MeshTransformOffset.GetScale3D());
+}
+
+FTransform FRoomTransformBatch::GetTileTransform(const FIntVector& TileSpaceLocation) const
+{
+	int32 edgeMask = GetEdgeMask(TileSpaceLocation);
+	FVector location = FVector(TileSpaceLocation.X * UDungeonTile::TILE_SIZE, TileSpaceLocation.Y * UDungeonTile::TILE_SIZE, TileSpaceLocation.Z * UDungeonTile::TILE_SIZE);
+	return FTransform(EdgeRotations[edgeMask], location + EdgeOffsets[edgeMask], ActorScale);
+}
+
+void FRoomTransformBatch::GetTileTransforms(const TArray<FIntVector>& TileSpaceLocations, TArray<FTransform>& OutTransforms) const
+{
+	OutTransforms.SetNumUninitialized(TileSpaceLocations.Num());
+	for (int32 i = 0; i < TileSpaceLocations.Num(); i++)
+	{
+		OutTransforms[i] = GetTileTransform(TileSpaceLocations[i]);
+	}
+}
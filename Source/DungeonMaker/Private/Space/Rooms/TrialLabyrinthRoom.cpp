@@ -19,8 +19,6 @@ void ATrialLabyrinthRoom::DoTileReplacementPreprocessing(FRandomStream& Rng)
 	// The walls may already be set, but (1, 1) is guaranteed to become floor
 	const UDungeonTile* defaultTile = GetTile(1, 1);
 
-	// Maze is made using a recursive backtracker
-	TArray<FIntVector> cellPositions;
 	// Find the list of entrances
 	TArray<FIntVector> entrances = EntranceLocations.Array();
 	TArray<FIntVector> entranceTileLocations;
@@ -63,141 +61,47 @@ void ATrialLabyrinthRoom::DoTileReplacementPreprocessing(FRandomStream& Rng)
 	}
 
 	// Run the maze generator
-	MakeSection(entranceTileLocations[0], defaultTile, true);
-	RecursiveBacktracker(entranceTileLocations[0], defaultTile, Rng);
-
-	for (FIntVector location : EntranceLocations)
+	FDungeonMaze maze;
+	maze.Initialize(XSize(), YSize());
+	for (int x = 0; x < XSize(); x++)
 	{
-		for (int x = -1; x <= 1; x++)
+		for (int y = 0; y < YSize(); y++)
 		{
-			for (int y = -1; y <= 1; y++)
-			{
-				const UDungeonTile* tile = GetTile(location.X + x, location.Y + y);
-				if (tile == defaultTile)
-				{
-					Set(location.X + x, location.Y + y, MazeGroundTile);
-				}
-			}
+			maze.SetCarvable(x, y, GetTile(x, y) == defaultTile);
 		}
 	}
-}
-
-bool ATrialLabyrinthRoom::PositionIsValid(FIntVector Position, const UDungeonTile* DefaultTile, bool bCheckNeighborCount) const
-{
-	// Check to see if a position touches exactly one existing passage
-	if (FloorPositions.Contains(Position))
-	{
-		return false;
-	}
-	if (Position.X < 0 || Position.Y < 0 ||
-		Position.X >= XSize() || Position.Y >= YSize())
+	if (!GenerateMaze(maze, MazeAlgorithm, entranceTileLocations[0], entranceTileLocations, defaultTile, Rng) &&
+		MazeAlgorithm != EMazeAlgorithm::Backtracker)
 	{
-		return false;
+		UE_LOG(LogSpaceGen, Warning, TEXT("%s cut off an entrance; falling back to a backtracking maze."), *GetName());
+		maze.ClearPassages();
+		GenerateMaze(maze, EMazeAlgorithm::Backtracker, entranceTileLocations[0], entranceTileLocations, defaultTile, Rng);
 	}
 
-	const UDungeonTile* tile = GetTile(Position.X, Position.Y);
-	if (tile != DefaultTile)
+	for (TConstSetBitIterator<> passage(maze.GetPassages()); passage; ++passage)
 	{
-		// Not available for carving
-		return false;
-	}
-
-	TArray<FIntVector> neighborLocations;
-	neighborLocations.Add(FIntVector(-1, 0, 0));
-	neighborLocations.Add(FIntVector(1, 0, 0));
-	neighborLocations.Add(FIntVector(0, -1, 0));
-	neighborLocations.Add(FIntVector(0, 1, 0));
-
-	int adjacentCount = 0;
-	for (int i = 0; i < neighborLocations.Num(); i++)
-	{
-		if (FloorPositions.Contains(Position + neighborLocations[i]))
-		{
-			adjacentCount++;
-		}
+		Set(passage.GetIndex() % XSize(), passage.GetIndex() / XSize(), MazeGroundTile);
 	}
-	return adjacentCount <= 1;
 }
 
-bool ATrialLabyrinthRoom::MakeSection(FIntVector Location, const UDungeonTile* DefaultTile, bool bForceGenerate)
+bool ATrialLabyrinthRoom::GenerateMaze(FDungeonMaze& Maze, EMazeAlgorithm Algorithm, const FIntVector& Start,
+	const TArray<FIntVector>& EntranceTiles, const UDungeonTile* DefaultTile, FRandomStream& Rng) const
 {
-	if (!bForceGenerate && !PositionIsValid(Location, DefaultTile))
-	{
-		return false;
-	}
-	FloorPositions.Add(Location);
-	Set(Location.X, Location.Y, MazeGroundTile);
-	return true;
-}
+	Maze.Generate(Algorithm, Start, Rng);
 
-bool ATrialLabyrinthRoom::RecursiveBacktracker(const FIntVector& Start, const UDungeonTile* DefaultTile,
-	FRandomStream& Rng)
-{
-	// Add array of neighbor locations
-	TArray<FIntVector> neighborLocations;
-	neighborLocations.Add(FIntVector(-1, 0, 0));
-	neighborLocations.Add(FIntVector(1, 0, 0));
-	neighborLocations.Add(FIntVector(0, -1, 0));
-	neighborLocations.Add(FIntVector(0, 1, 0));
-	
-	// Shuffle
-	neighborLocations.Swap(Rng.RandRange(0, neighborLocations.Num() - 1), Rng.RandRange(0, neighborLocations.Num() - 1));
-	neighborLocations.Swap(Rng.RandRange(0, neighborLocations.Num() - 1), Rng.RandRange(0, neighborLocations.Num() - 1));
-	neighborLocations.Swap(Rng.RandRange(0, neighborLocations.Num() - 1), Rng.RandRange(0, neighborLocations.Num() - 1));
-	neighborLocations.Swap(Rng.RandRange(0, neighborLocations.Num() - 1), Rng.RandRange(0, neighborLocations.Num() - 1));
-
-	// Place neighbors randomly
-	for (int i = 0; i < neighborLocations.Num(); i++)
+	for (FIntVector location : EntranceLocations)
 	{
-		if (!MakeSection(Start + neighborLocations[i], DefaultTile))
-		{
-			continue;
-		}
-/*		FIntVector next = Start + neighborLocations[i] + neighborLocations[i];
-		if (next.X >= 0 && next.X < XSize() && next.Y >= 0 && next.Y < YSize())
+		for (int x = -1; x <= 1; x++)
 		{
-			MakeSection(Start + neighborLocations[i] + neighborLocations[i], DefaultTile, true);
-			RecursiveBacktracker(Start + neighborLocations[i] + neighborLocations[i], DefaultTile, Rng);
+			for (int y = -1; y <= 1; y++)
+			{
+				const UDungeonTile* tile = GetTile(location.X + x, location.Y + y);
+				if (tile == DefaultTile)
+				{
+					Maze.SetPassage(location.X + x, location.Y + y);
+				}
+			}
 		}
-		else
-		{*/
-			RecursiveBacktracker(Start + neighborLocations[i], DefaultTile, Rng);
-		//}
-	}
-
-	return true;
-}
-
-bool ATrialLabyrinthRoom::RecursiveBacktrackerSearch(const FIntVector& Start, const FIntVector& Goal,
-	TSet<FIntVector>& Visited)
-{
-	if (Start == Goal)
-	{
-		return true;
-	}
-
-	if (Visited.Contains(Start))
-	{
-		return false;
-	}
-
-	const UDungeonTile* tile = GetTile(Start.X, Start.Y);
-	if (tile == NULL)
-	{
-		// Wall tile
-		return false;
-	}
-
-	Visited.Add(Start);
-	if (Start.X < XSize() - 1 && RecursiveBacktrackerSearch(Start + FIntVector(1, 0, 0), Goal, Visited) ||
-		Start.Y < YSize() - 1 && RecursiveBacktrackerSearch(Start + FIntVector(0, 1, 0), Goal, Visited) ||
-		Start.X > 0 && RecursiveBacktrackerSearch(Start + FIntVector(-1, 0, 0), Goal, Visited) ||
-		Start.Y > 0 && RecursiveBacktrackerSearch(Start + FIntVector(0, -1, 0), Goal, Visited))
-	{
-		return true;
-	}
-	else
-	{
-		return false;
 	}
+	return Maze.AreAllReachable(Start, EntranceTiles);
 }
\ No newline at end of file
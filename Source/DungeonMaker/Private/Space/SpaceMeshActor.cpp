@@ -26,7 +26,7 @@ ASpaceMeshActor::ASpaceMeshActor()
 	MeshComponents.Add(meshComponent);*/
 }
 
-void ASpaceMeshActor::SetStaticMesh(const UDungeonTile* Tile, TArray<FDungeonTileMesh> Meshes)
+void ASpaceMeshActor::SetStaticMesh(const UDungeonTile* Tile, TArray<FDungeonTileMesh> Meshes, bool bAffectsNavigation)
 {
 	MeshTile = Tile;
 	UE_LOG(LogSpaceGen, Log, TEXT("Creating %d meshes for tile %s."), Meshes.Num(), *Tile->TileID.ToString());
@@ -38,16 +38,7 @@ void ASpaceMeshActor::SetStaticMesh(const UDungeonTile* Tile, TArray<FDungeonTil
 		}
 		FString meshName = Tile->TileID.ToString() + " Mesh ";
 		meshName.AppendInt(i);
-		UHierarchicalInstancedStaticMeshComponent* meshComponent = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, FName(*meshName));
-
-		meshComponent->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
-		meshComponent->Mobility = EComponentMobility::Movable;
-		meshComponent->bGenerateOverlapEvents = false;
-		meshComponent->bUseDefaultCollision = true;
-
-		meshComponent->SetStaticMesh(Meshes[i].Mesh);
-		meshComponent->RegisterComponent();
-		MeshComponents.Add(meshComponent);
+		MeshComponents.Add(CreateMeshComponent(meshName, Meshes[i].Mesh, bAffectsNavigation));
 	}
 	/*if (Meshes.Num() == 0)
 	{
@@ -56,8 +47,63 @@ void ASpaceMeshActor::SetStaticMesh(const UDungeonTile* Tile, TArray<FDungeonTil
 	MeshComponents[0]->SetStaticMesh(Meshes[0].Mesh);*/
 }
 
+void ASpaceMeshActor::AddColumnMeshes(const TArray<FDungeonTileMesh>& Meshes, bool bAffectsNavigation)
+{
+	ColumnComponents.SetNumZeroed(Meshes.Num());
+	for (int i = 0; i < Meshes.Num(); i++)
+	{
+		if (Meshes[i].Mesh == NULL)
+		{
+			continue;
+		}
+		FString meshName = MeshTile->TileID.ToString() + " Column ";
+		meshName.AppendInt(i);
+		ColumnComponents[i] = CreateMeshComponent(meshName, Meshes[i].Mesh, bAffectsNavigation);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent* ASpaceMeshActor::GetMeshComponent(int32 MeshIndex) const
+{
+	verify(MeshComponents.IsValidIndex(MeshIndex));
+	return MeshComponents[MeshIndex];
+}
+
+UHierarchicalInstancedStaticMeshComponent* ASpaceMeshActor::GetColumnComponent(int32 ColumnIndex) const
+{
+	return ColumnComponents.IsValidIndex(ColumnIndex) ? ColumnComponents[ColumnIndex] : NULL;
+}
+
+UHierarchicalInstancedStaticMeshComponent* ASpaceMeshActor::CreateMeshComponent(const FString& MeshName, UStaticMesh* Mesh, bool bAffectsNavigation)
+{
+	UHierarchicalInstancedStaticMeshComponent* meshComponent = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, FName(*MeshName));
+
+	meshComponent->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	meshComponent->Mobility = EComponentMobility::Movable;
+	meshComponent->bGenerateOverlapEvents = false;
+	meshComponent->bUseDefaultCollision = true;
+	meshComponent->SetCanEverAffectNavigation(bAffectsNavigation);
+
+	meshComponent->SetStaticMesh(Mesh);
+	meshComponent->RegisterComponent();
+	return meshComponent;
+}
+
 int32 ASpaceMeshActor::AddInstance(int32 MeshID, const FTransform& Transform)
 {
-	verify(MeshComponents.IsValidIndex(MeshID));
-	return MeshComponents[MeshID]->AddInstance(Transform);
+	return GetMeshComponent(MeshID)->AddInstance(Transform);
+}
+
+void ASpaceMeshActor::AddInstances(int32 MeshID, const TArray<FTransform>& Transforms)
+{
+	AddInstances(GetMeshComponent(MeshID), Transforms);
+}
+
+void ASpaceMeshActor::AddInstances(UHierarchicalInstancedStaticMeshComponent* MeshComponent, const TArray<FTransform>& Transforms)
+{
+	check(MeshComponent != NULL);
+	MeshComponent->PerInstanceSMData.Reserve(MeshComponent->PerInstanceSMData.Num() + Transforms.Num());
+	for (const FTransform& transform : Transforms)
+	{
+		MeshComponent->AddInstance(transform);
+	}
 }
@@ -3,13 +3,20 @@
 #include "RoomReplacementPattern.h"
 #include "DungeonRoom.h"
 #include "DungeonFloorManager.h"
+#include "RoomConnectivity.h"
 
 URoomReplacementPattern::URoomReplacementPattern()
 {
 	SelectionChance = 1.0f;
+	bCanDisconnectEntrances = false;
 }
 
 bool URoomReplacementPattern::FindAndReplace(FDungeonRoomMetadata& ReplaceRoom, FRandomStream& Rng)
+{
+	return FindAndReplace(ReplaceRoom, NULL, Rng);
+}
+
+bool URoomReplacementPattern::FindAndReplace(FDungeonRoomMetadata& ReplaceRoom, FRoomConnectivity* Connectivity, FRandomStream& Rng)
 {
 	checkf(Input.IsNotNull(), TEXT("You didn't specify any input for replacement data!"));
 
@@ -59,9 +66,8 @@ bool URoomReplacementPattern::FindAndReplace(FDungeonRoomMetadata& ReplaceRoom,
 					// then move on.
 					possibleReplacements.Add(FIntVector(xOffset, yOffset, replacementOutput));
 				}
-				else
+				else if (UpdateFloorTiles(replacementXSize, replacementYSize, xOffset, yOffset, width, height, replacementOutput, NULL, ReplaceRoom, Connectivity))
 				{
-					UpdateFloorTiles(replacementXSize, replacementYSize, xOffset, yOffset, width, height, replacementOutput, NULL, ReplaceRoom);
 					return true;
 				}
 			}
@@ -71,17 +77,18 @@ bool URoomReplacementPattern::FindAndReplace(FDungeonRoomMetadata& ReplaceRoom,
 		xOffset = -replacementXSize;
 	}
 
-	if (bRandomlyPlaced && possibleReplacements.Num() > 0)
+	while (bRandomlyPlaced && possibleReplacements.Num() > 0)
 	{
 		int32 randomVectorID = Rng.RandRange(0, possibleReplacements.Num() - 1);
 		FIntVector randomVector = possibleReplacements[randomVectorID];
-		UpdateFloorTiles(replacementXSize, replacementYSize, randomVector.X, randomVector.Y, width, height, (uint8)randomVector.Z, NULL, ReplaceRoom);
-		return true;
-	}
-	else
-	{
-		return false;
+		if (UpdateFloorTiles(replacementXSize, replacementYSize, randomVector.X, randomVector.Y, width, height, (uint8)randomVector.Z, NULL, ReplaceRoom, Connectivity))
+		{
+			return true;
+		}
+		// That spot would have cut off an entrance; try another
+		possibleReplacements.RemoveAtSwap(randomVectorID);
 	}
+	return false;
 }
 
 bool URoomReplacementPattern::FindAndReplaceFloor(UDungeonFloorManager* ReplaceFloor, FRandomStream& Rng)
@@ -150,10 +157,9 @@ bool URoomReplacementPattern::FindAndReplaceFloor(UDungeonFloorManager* ReplaceF
 						// then move on.
 						possibleReplacements.Add(FIntVector(xOffset, yOffset, replacementOutput));
 					}
-					else
+					else if (UpdateFloorTiles(replacementXSize, replacementYSize, xOffset, yOffset, width, height, replacementOutput, ReplaceFloor, roomReplacement, NULL))
 					{
-						// We match the replacement; update the floor tiles
-						UpdateFloorTiles(replacementXSize, replacementYSize, xOffset, yOffset, width, height, replacementOutput, ReplaceFloor, roomReplacement);
+						// We matched the replacement and updated the floor tiles
 						return true;
 					}
 				}
@@ -164,23 +170,41 @@ bool URoomReplacementPattern::FindAndReplaceFloor(UDungeonFloorManager* ReplaceF
 		xOffset = -replacementXSize;
 	}
 
-	if (bRandomlyPlaced && possibleReplacements.Num() > 0)
+	while (bRandomlyPlaced && possibleReplacements.Num() > 0)
 	{
 		int32 randomVectorID = Rng.RandRange(0, possibleReplacements.Num() - 1);
 		FIntVector randomVector = possibleReplacements[randomVectorID];
-		UpdateFloorTiles(replacementXSize, replacementYSize, randomVector.X, randomVector.Y, width, height, (uint8)randomVector.Z, ReplaceFloor, roomReplacement);
-		return true;
-	}
-	else
-	{
-		return false;
+		if (UpdateFloorTiles(replacementXSize, replacementYSize, randomVector.X, randomVector.Y, width, height, (uint8)randomVector.Z, ReplaceFloor, roomReplacement, NULL))
+		{
+			return true;
+		}
+		possibleReplacements.RemoveAtSwap(randomVectorID);
 	}
+	return false;
 }
 
-void URoomReplacementPattern::UpdateFloorTiles(int ReplacementXSize, int ReplacementYSize,
+bool URoomReplacementPattern::UpdateFloorTiles(int ReplacementXSize, int ReplacementYSize,
 	int XOffset, int YOffset, int Width, int Height, uint8 ReplacementOutput, 
-	UDungeonFloorManager* ReplaceFloor, FDungeonRoomMetadata &ReplaceRoom)
+	UDungeonFloorManager* ReplaceFloor, FDungeonRoomMetadata &ReplaceRoom, FRoomConnectivity* Connectivity)
 {
+	// Every tile we overwrite, so we can put it back if we cut off an entrance
+	TArray<TPair<FIntVector, const UDungeonTile*>> previousTiles;
+	TArray<FRoomConnectivity*, TInlineAllocator<4>> patchedRooms;
+	// Connectivity always has to hear about our writes, even if we're allowed to disconnect entrances
+	auto trackTile = [&patchedRooms](FRoomConnectivity* RoomConnectivity, int32 X, int32 Y, const UDungeonTile* Tile)
+	{
+		if (RoomConnectivity == NULL || !RoomConnectivity->IsInitialized())
+		{
+			return;
+		}
+		if (!patchedRooms.Contains(RoomConnectivity))
+		{
+			RoomConnectivity->BeginPatch();
+			patchedRooms.Add(RoomConnectivity);
+		}
+		RoomConnectivity->SetTile(X, Y, Tile);
+	};
+
 	for (int localXOffset = 0; localXOffset < ReplacementXSize; localXOffset++)
 	{
 		int x = XOffset + localXOffset;
@@ -222,17 +246,59 @@ void URoomReplacementPattern::UpdateFloorTiles(int ReplacementXSize, int Replace
 					outputOffsetY = 0;
 					checkNoEntry();
 				}
+				const UDungeonTile* outputTile = Output[outputOffsetY][outputOffsetX];
 				if (ReplaceFloor == NULL)
 				{
-					ReplaceRoom.Set(x, y, Output[outputOffsetY][outputOffsetX]);
+					previousTiles.Add(TPair<FIntVector, const UDungeonTile*>(location, ReplaceRoom[y][x]));
+					ReplaceRoom.Set(x, y, outputTile);
+					trackTile(Connectivity, x, y, outputTile);
 				}
 				else
 				{
-					ReplaceFloor->UpdateTileFromTileSpace(location, Output[outputOffsetY][outputOffsetX]);
+					previousTiles.Add(TPair<FIntVector, const UDungeonTile*>(location, ReplaceFloor->GetTileFromTileSpace(location)));
+					ReplaceFloor->UpdateTileFromTileSpace(location, outputTile);
+					const FFloorRoom* room = ReplaceFloor->FindRoomFromTileSpace(location);
+					if (room != NULL && room->SpawnedRoom != NULL)
+					{
+						FIntVector localLocation = location - room->SpawnedRoom->GetRoomTileSpacePosition();
+						trackTile(&room->SpawnedRoom->EntranceConnectivity, localLocation.X, localLocation.Y, outputTile);
+					}
 				}
 			}
 		}
 	}
+
+	bool bKeptEntrancesConnected = true;
+	for (FRoomConnectivity* patchedRoom : patchedRooms)
+	{
+		if (!patchedRoom->EndPatch())
+		{
+			bKeptEntrancesConnected = false;
+		}
+	}
+	if (bKeptEntrancesConnected || bCanDisconnectEntrances)
+	{
+		return true;
+	}
+
+	// Undo the whole patch
+	for (FRoomConnectivity* patchedRoom : patchedRooms)
+	{
+		patchedRoom->RollBackPatch();
+	}
+	for (int32 i = previousTiles.Num() - 1; i >= 0; i--)
+	{
+		const FIntVector& location = previousTiles[i].Key;
+		if (ReplaceFloor == NULL)
+		{
+			ReplaceRoom.Set(location.X, location.Y, previousTiles[i].Value);
+		}
+		else
+		{
+			ReplaceFloor->UpdateTileFromTileSpace(location, previousTiles[i].Value);
+		}
+	}
+	return false;
 }
 
 float URoomReplacementPattern::GetActualSelectionChance(ADungeonRoom* InputRoom) const
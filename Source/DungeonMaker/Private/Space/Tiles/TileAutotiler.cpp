@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TileAutotiler.h"
+
+// North, Northeast, East, Southeast, South, Southwest, West, Northwest.
+// North is toward -Y, matching ADungeonRoom::GetTileDirection.
+static const int32 NEIGHBOR_X[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int32 NEIGHBOR_Y[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+// Drops any corner whose two edges don't both connect, since it can't change how the tile looks
+static uint8 ReduceBlobMask(uint8 Mask)
+{
+	const uint8 north = 1 << 0;
+	const uint8 east = 1 << 2;
+	const uint8 south = 1 << 4;
+	const uint8 west = 1 << 6;
+	if ((Mask & north) == 0 || (Mask & east) == 0)
+	{
+		Mask &= ~(1 << 1);
+	}
+	if ((Mask & south) == 0 || (Mask & east) == 0)
+	{
+		Mask &= ~(1 << 3);
+	}
+	if ((Mask & south) == 0 || (Mask & west) == 0)
+	{
+		Mask &= ~(1 << 5);
+	}
+	if ((Mask & north) == 0 || (Mask & west) == 0)
+	{
+		Mask &= ~(1 << 7);
+	}
+	return Mask;
+}
+
+int32 UTileAutotiler::GetBlobIndex(uint8 NeighborMask)
+{
+	struct FBlobTable
+	{
+		uint8 Indices[256];
+
+		FBlobTable()
+		{
+			// Number the reduced masks in ascending order, then point every mask at its reduced one
+			uint8 reducedIndices[256];
+			int32 nextIndex = 0;
+			for (int32 mask = 0; mask < 256; mask++)
+			{
+				if (ReduceBlobMask((uint8)mask) == mask)
+				{
+					reducedIndices[mask] = (uint8)nextIndex++;
+				}
+			}
+			check(nextIndex == BLOB_CASE_COUNT);
+			for (int32 mask = 0; mask < 256; mask++)
+			{
+				Indices[mask] = reducedIndices[ReduceBlobMask((uint8)mask)];
+			}
+		}
+	};
+	static const FBlobTable table;
+	return table.Indices[NeighborMask];
+}
+
+void UTileAutotiler::Autotile(const TArray<const UDungeonTile*>& Tiles, int32 Width, int32 Height,
+	TArray<const UDungeonTile*>& OutTiles) const
+{
+	int32 innerWidth = FMath::Max(Width - 2, 0);
+	int32 innerHeight = FMath::Max(Height - 2, 0);
+	OutTiles.SetNumUninitialized(innerWidth * innerHeight);
+	if (Tiles.Num() < Width * Height)
+	{
+		OutTiles.Reset();
+		return;
+	}
+
+	// Variants belong to the same set as the tile they replace, so running this twice is harmless
+	TMap<const UDungeonTile*, int32> setIndices;
+	TArray<TSet<const UDungeonTile*>> connections;
+	connections.SetNum(TileSets.Num());
+	for (int32 i = 0; i < TileSets.Num(); i++)
+	{
+		const FAutotileSet& set = TileSets[i];
+		if (set.Tile == NULL)
+		{
+			continue;
+		}
+		setIndices.Add(set.Tile, i);
+		connections[i].Add(set.Tile);
+		for (const UDungeonTile* variant : set.Variants)
+		{
+			if (variant != NULL)
+			{
+				if (!setIndices.Contains(variant))
+				{
+					setIndices.Add(variant, i);
+				}
+				connections[i].Add(variant);
+			}
+		}
+		for (const UDungeonTile* other : set.ConnectsTo)
+		{
+			if (other != NULL)
+			{
+				connections[i].Add(other);
+			}
+		}
+	}
+
+	for (int32 y = 1; y < Height - 1; y++)
+	{
+		for (int32 x = 1; x < Width - 1; x++)
+		{
+			const UDungeonTile* tile = Tiles[y * Width + x];
+			int32 outIndex = (y - 1) * innerWidth + (x - 1);
+			OutTiles[outIndex] = tile;
+			const int32* setIndex = tile != NULL ? setIndices.Find(tile) : NULL;
+			if (setIndex == NULL)
+			{
+				continue;
+			}
+			const FAutotileSet& set = TileSets[*setIndex];
+			const TSet<const UDungeonTile*>& connected = connections[*setIndex];
+
+			uint8 mask = 0;
+			int32 step = set.Mode == EAutotileMode::Cardinal ? 2 : 1;
+			for (int32 direction = 0; direction < 8; direction += step)
+			{
+				const UDungeonTile* neighbor = Tiles[(y + NEIGHBOR_Y[direction]) * Width + x + NEIGHBOR_X[direction]];
+				if (neighbor == NULL ? set.bConnectsToEmpty : connected.Contains(neighbor))
+				{
+					mask |= 1 << direction;
+				}
+			}
+
+			int32 variantIndex;
+			if (set.Mode == EAutotileMode::Cardinal)
+			{
+				// Squash the edge bits down to North = 1, East = 2, South = 4, West = 8
+				variantIndex = (mask & 1) | ((mask >> 1) & 2) | ((mask >> 2) & 4) | ((mask >> 3) & 8);
+			}
+			else
+			{
+				variantIndex = GetBlobIndex(mask);
+			}
+			if (set.Variants.IsValidIndex(variantIndex) && set.Variants[variantIndex] != NULL)
+			{
+				OutTiles[outIndex] = set.Variants[variantIndex];
+			}
+		}
+	}
+}
@@ -0,0 +1,548 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TileSynthesizer.h"
+#include "TileSynthesisRules.h"
+
+static const int32 DIRECTION_X[4] = { -1, 1, 0, 0 };
+static const int32 DIRECTION_Y[4] = { 0, 0, -1, 1 };
+
+// Calls Visit with the index of every set bit in a domain, lowest first
+template<typename VisitFunction>
+static FORCEINLINE void ForEachTile(const uint64* Domain, int32 Words, VisitFunction Visit)
+{
+	for (int32 word = 0; word < Words; word++)
+	{
+		uint64 bits = Domain[word];
+		while (bits != 0)
+		{
+			uint64 lowest = bits & (~bits + 1);
+			Visit((word << 6) + (int32)FMath::FloorLog2_64(lowest));
+			bits ^= lowest;
+		}
+	}
+}
+
+FTileSynthesizer::FTileSynthesizer()
+{
+	Width = 0;
+	Height = 0;
+	WordsPerDomain = 1;
+	BacktrackCount = 0;
+}
+
+int32 FTileSynthesizer::AddTile(const UDungeonTile* Tile)
+{
+	if (Tile == NULL)
+	{
+		return INVALID_INDEX;
+	}
+	const int32* existing = TileIndices.Find(Tile);
+	if (existing != NULL)
+	{
+		return *existing;
+	}
+	int32 index = Tiles.Add(Tile);
+	TileIndices.Add(Tile, index);
+	return index;
+}
+
+void FTileSynthesizer::Initialize(const UTileSynthesisRules* Rules, const FDungeonRoomMetadata& Room, const UDungeonTile* FreeTile)
+{
+	Width = Room.XSize();
+	Height = Room.YSize();
+	Tiles.Reset();
+	TileIndices.Reset();
+
+	// Gather every tile first, so we know how big a domain is
+	if (Rules != NULL)
+	{
+		for (const FDungeonRoomMetadata& example : Rules->Examples)
+		{
+			for (const FDungeonRow& row : example.DungeonRows)
+			{
+				for (const UDungeonTile* tile : row.DungeonTiles)
+				{
+					AddTile(tile);
+				}
+			}
+		}
+		for (const FTileAdjacencyRule& rule : Rules->Adjacencies)
+		{
+			AddTile(rule.Tile);
+			AddTile(rule.Neighbor);
+		}
+		for (const TPair<const UDungeonTile*, float>& weight : Rules->TileWeights)
+		{
+			AddTile(weight.Key);
+		}
+	}
+	for (int32 y = 0; y < Height; y++)
+	{
+		for (const UDungeonTile* tile : Room.DungeonRows[y].DungeonTiles)
+		{
+			AddTile(tile);
+		}
+	}
+
+	int32 tileCount = Tiles.Num();
+	WordsPerDomain = FMath::Max(1, (tileCount + 63) >> 6);
+	Allowed.Init(0, DIRECTION_COUNT * FMath::Max(tileCount, 1) * WordsPerDomain);
+	TArray<int32> counts;
+	counts.Init(0, tileCount);
+	TBitArray<> hasRules(false, tileCount);
+
+	auto allow = [this, &hasRules](int32 Tile, int32 Direction, int32 Neighbor)
+	{
+		GetAllowed(Direction, Tile)[Neighbor >> 6] |= 1ull << (Neighbor & 63);
+		GetAllowed(Direction ^ 1, Neighbor)[Tile >> 6] |= 1ull << (Tile & 63);
+		hasRules[Tile] = true;
+		hasRules[Neighbor] = true;
+	};
+
+	if (Rules != NULL)
+	{
+		for (const FDungeonRoomMetadata& example : Rules->Examples)
+		{
+			int32 exampleHeight = example.DungeonRows.Num();
+			for (int32 y = 0; y < exampleHeight; y++)
+			{
+				const TArray<const UDungeonTile*>& row = example.DungeonRows[y].DungeonTiles;
+				for (int32 x = 0; x < row.Num(); x++)
+				{
+					int32 tile = AddTile(row[x]);
+					if (tile == INVALID_INDEX)
+					{
+						continue;
+					}
+					counts[tile]++;
+					if (x + 1 < row.Num())
+					{
+						int32 right = AddTile(row[x + 1]);
+						if (right != INVALID_INDEX)
+						{
+							allow(tile, 1, right);
+						}
+					}
+					if (y + 1 < exampleHeight && example.DungeonRows[y + 1].DungeonTiles.IsValidIndex(x))
+					{
+						int32 below = AddTile(example.DungeonRows[y + 1].DungeonTiles[x]);
+						if (below != INVALID_INDEX)
+						{
+							allow(tile, 3, below);
+						}
+					}
+				}
+			}
+		}
+		for (const FTileAdjacencyRule& rule : Rules->Adjacencies)
+		{
+			int32 tile = AddTile(rule.Tile);
+			int32 neighbor = AddTile(rule.Neighbor);
+			if (tile == INVALID_INDEX || neighbor == INVALID_INDEX)
+			{
+				continue;
+			}
+			// Either order, so allow both sides in both directions
+			if (rule.bHorizontal)
+			{
+				allow(tile, 0, neighbor);
+				allow(tile, 1, neighbor);
+			}
+			if (rule.bVertical)
+			{
+				allow(tile, 2, neighbor);
+				allow(tile, 3, neighbor);
+			}
+		}
+	}
+
+	// Tiles nothing says anything about can go next to anything, and anything can go next to them
+	for (int32 tile = 0; tile < tileCount; tile++)
+	{
+		if (hasRules[tile])
+		{
+			continue;
+		}
+		for (int32 direction = 0; direction < DIRECTION_COUNT; direction++)
+		{
+			uint64* allowed = GetAllowed(direction, tile);
+			for (int32 word = 0; word < WordsPerDomain; word++)
+			{
+				allowed[word] = ~0ull;
+			}
+			for (int32 other = 0; other < tileCount; other++)
+			{
+				GetAllowed(direction, other)[tile >> 6] |= 1ull << (tile & 63);
+			}
+		}
+	}
+
+	Weights.SetNumUninitialized(tileCount);
+	TArray<uint64> freeDomain;
+	freeDomain.Init(0, WordsPerDomain);
+	for (int32 tile = 0; tile < tileCount; tile++)
+	{
+		const float* weight = Rules != NULL ? Rules->TileWeights.Find(Tiles[tile]) : NULL;
+		if (weight != NULL)
+		{
+			Weights[tile] = FMath::Max(*weight, 0.0f);
+		}
+		else if (counts[tile] > 0)
+		{
+			Weights[tile] = (float)counts[tile];
+		}
+		else
+		{
+			// Only authored rules mention it, so give it an even chance; tiles with no rules at all never get picked
+			Weights[tile] = hasRules[tile] ? 1.0f : 0.0f;
+		}
+		if (Weights[tile] > 0.0f)
+		{
+			freeDomain[tile >> 6] |= 1ull << (tile & 63);
+		}
+	}
+
+	int32 cellCount = Width * Height;
+	Domains.Init(0, cellCount * WordsPerDomain);
+	FreeCells.Init(false, cellCount);
+	CellVersions.Init(0, cellCount);
+	for (int32 y = 0; y < Height; y++)
+	{
+		for (int32 x = 0; x < Width; x++)
+		{
+			int32 cell = y * Width + x;
+			const UDungeonTile* tile = Room.DungeonRows[y].DungeonTiles[x];
+			uint64* domain = GetDomain(cell);
+			if (tile == FreeTile)
+			{
+				FreeCells[cell] = true;
+				FMemory::Memcpy(domain, freeDomain.GetData(), WordsPerDomain * sizeof(uint64));
+			}
+			else if (tile != NULL)
+			{
+				int32 index = TileIndices[tile];
+				domain[index >> 6] = 1ull << (index & 63);
+			}
+			// An empty cell is left with an empty domain, so it doesn't constrain anything
+		}
+	}
+
+	Scratch.SetNumUninitialized(WordsPerDomain);
+	EntropyHeap.Reset();
+	ChangedCells.Reset();
+	Decisions.Reset();
+	PropagationStack.Reset();
+	TrailCells.Reset();
+	TrailDomains.Reset();
+	BacktrackCount = 0;
+}
+
+void FTileSynthesizer::RestrictToType(int32 X, int32 Y, ETileType Type)
+{
+	if (X < 0 || Y < 0 || X >= Width || Y >= Height)
+	{
+		return;
+	}
+	int32 cell = Y * Width + X;
+	if (!FreeCells[cell])
+	{
+		return;
+	}
+	uint64* domain = GetDomain(cell);
+	ForEachTile(domain, WordsPerDomain, [this, domain, Type](int32 Tile)
+	{
+		if (Tiles[Tile]->TileType != Type)
+		{
+			domain[Tile >> 6] &= ~(1ull << (Tile & 63));
+		}
+	});
+}
+
+int32 FTileSynthesizer::GetNeighbor(int32 Cell, int32 Direction) const
+{
+	int32 x = Cell % Width + DIRECTION_X[Direction];
+	int32 y = Cell / Width + DIRECTION_Y[Direction];
+	if (x < 0 || y < 0 || x >= Width || y >= Height)
+	{
+		return INVALID_INDEX;
+	}
+	return y * Width + x;
+}
+
+int32 FTileSynthesizer::CountTiles(int32 Cell) const
+{
+	const uint64* domain = GetDomain(Cell);
+	int32 count = 0;
+	for (int32 word = 0; word < WordsPerDomain; word++)
+	{
+		count += FPlatformMath::CountBits(domain[word]);
+	}
+	return count;
+}
+
+bool FTileSynthesizer::SetDomain(int32 Cell, const uint64* Domain)
+{
+	uint64* domain = GetDomain(Cell);
+	TrailCells.Add(Cell);
+	TrailDomains.Append(domain, WordsPerDomain);
+
+	uint64 anyTiles = 0;
+	for (int32 word = 0; word < WordsPerDomain; word++)
+	{
+		domain[word] = Domain[word];
+		anyTiles |= Domain[word];
+	}
+	CellVersions[Cell]++;
+	ChangedCells.Add(Cell);
+	return anyTiles != 0;
+}
+
+bool FTileSynthesizer::Propagate()
+{
+	while (PropagationStack.Num() > 0)
+	{
+		int32 cell = PropagationStack.Pop(false);
+		const uint64* domain = GetDomain(cell);
+		for (int32 direction = 0; direction < DIRECTION_COUNT; direction++)
+		{
+			int32 neighbor = GetNeighbor(cell, direction);
+			if (neighbor == INVALID_INDEX || !FreeCells[neighbor])
+			{
+				continue;
+			}
+
+			// Everything any of our tiles allows on that side
+			for (int32 word = 0; word < WordsPerDomain; word++)
+			{
+				Scratch[word] = 0;
+			}
+			uint64* scratch = Scratch.GetData();
+			ForEachTile(domain, WordsPerDomain, [this, direction, scratch](int32 Tile)
+			{
+				const uint64* allowed = GetAllowed(direction, Tile);
+				for (int32 word = 0; word < WordsPerDomain; word++)
+				{
+					scratch[word] |= allowed[word];
+				}
+			});
+
+			const uint64* neighborDomain = GetDomain(neighbor);
+			bool bChanged = false;
+			for (int32 word = 0; word < WordsPerDomain; word++)
+			{
+				scratch[word] &= neighborDomain[word];
+				bChanged |= scratch[word] != neighborDomain[word];
+			}
+			if (!bChanged)
+			{
+				continue;
+			}
+			if (!SetDomain(neighbor, scratch))
+			{
+				return false;
+			}
+			PropagationStack.Add(neighbor);
+		}
+	}
+	return true;
+}
+
+void FTileSynthesizer::UndoTo(int32 TrailLength)
+{
+	for (int32 i = TrailCells.Num() - 1; i >= TrailLength; i--)
+	{
+		int32 cell = TrailCells[i];
+		FMemory::Memcpy(GetDomain(cell), &TrailDomains[i * WordsPerDomain], WordsPerDomain * sizeof(uint64));
+		CellVersions[cell]++;
+		ChangedCells.Add(cell);
+	}
+	TrailCells.SetNum(TrailLength, false);
+	TrailDomains.SetNum(TrailLength * WordsPerDomain, false);
+}
+
+void FTileSynthesizer::PushChangedCells(FRandomStream& Rng)
+{
+	for (int32 cell : ChangedCells)
+	{
+		if (CountTiles(cell) <= 1)
+		{
+			continue;
+		}
+		// Shannon entropy of the weights left in the cell
+		float totalWeight = 0.0f;
+		float weightedLogs = 0.0f;
+		ForEachTile(GetDomain(cell), WordsPerDomain, [this, &totalWeight, &weightedLogs](int32 Tile)
+		{
+			float weight = Weights[Tile];
+			if (weight > 0.0f)
+			{
+				totalWeight += weight;
+				weightedLogs += weight * FMath::Loge(weight);
+			}
+		});
+		float entropy = totalWeight > 0.0f ? FMath::Loge(totalWeight) - weightedLogs / totalWeight : 0.0f;
+		// A little noise so ties don't always go to the same corner of the room
+		EntropyHeap.HeapPush({ entropy + Rng.FRand() * 0.001f, cell, CellVersions[cell] });
+	}
+	ChangedCells.Reset();
+}
+
+int32 FTileSynthesizer::PopLowestEntropy()
+{
+	while (EntropyHeap.Num() > 0)
+	{
+		FEntropyEntry entry;
+		EntropyHeap.HeapPop(entry, false);
+		if (entry.Version == CellVersions[entry.Cell] && CountTiles(entry.Cell) > 1)
+		{
+			return entry.Cell;
+		}
+	}
+	return INVALID_INDEX;
+}
+
+int32 FTileSynthesizer::ChooseTile(int32 Cell, FRandomStream& Rng) const
+{
+	const uint64* domain = GetDomain(Cell);
+	float totalWeight = 0.0f;
+	int32 firstTile = INVALID_INDEX;
+	ForEachTile(domain, WordsPerDomain, [this, &totalWeight, &firstTile](int32 Tile)
+	{
+		totalWeight += Weights[Tile];
+		if (firstTile == INVALID_INDEX)
+		{
+			firstTile = Tile;
+		}
+	});
+	if (totalWeight <= 0.0f)
+	{
+		return firstTile;
+	}
+
+	float roll = Rng.FRand() * totalWeight;
+	int32 chosen = INVALID_INDEX;
+	ForEachTile(domain, WordsPerDomain, [this, &roll, &chosen](int32 Tile)
+	{
+		if (chosen != INVALID_INDEX || Weights[Tile] <= 0.0f)
+		{
+			return;
+		}
+		roll -= Weights[Tile];
+		if (roll < 0.0f)
+		{
+			chosen = Tile;
+		}
+	});
+	// Rounding can leave a sliver of roll past the last tile
+	if (chosen == INVALID_INDEX)
+	{
+		ForEachTile(domain, WordsPerDomain, [this, &chosen](int32 Tile)
+		{
+			if (Weights[Tile] > 0.0f)
+			{
+				chosen = Tile;
+			}
+		});
+	}
+	return chosen;
+}
+
+bool FTileSynthesizer::Solve(FRandomStream& Rng, int32 MaxBacktracks)
+{
+	// Go back to how things were before the last attempt
+	UndoTo(0);
+	Decisions.Reset();
+	EntropyHeap.Reset();
+	ChangedCells.Reset();
+	PropagationStack.Reset();
+	BacktrackCount = 0;
+
+	int32 cellCount = Width * Height;
+	for (int32 cell = 0; cell < cellCount; cell++)
+	{
+		int32 tileCount = CountTiles(cell);
+		if (FreeCells[cell] && tileCount == 0)
+		{
+			return false;
+		}
+		// Empty cells don't constrain anything
+		if (tileCount > 0)
+		{
+			PropagationStack.Add(cell);
+		}
+	}
+	if (!Propagate())
+	{
+		return false;
+	}
+	for (TConstSetBitIterator<> cell(FreeCells); cell; ++cell)
+	{
+		ChangedCells.Add(cell.GetIndex());
+	}
+
+	TArray<uint64, TInlineAllocator<4>> choice;
+	choice.SetNumUninitialized(WordsPerDomain);
+	while (true)
+	{
+		PushChangedCells(Rng);
+		int32 cell = PopLowestEntropy();
+		if (cell == INVALID_INDEX)
+		{
+			return true;
+		}
+
+		int32 tile = ChooseTile(cell, Rng);
+		Decisions.Add({ cell, tile, TrailCells.Num() });
+		for (int32 word = 0; word < WordsPerDomain; word++)
+		{
+			choice[word] = 0;
+		}
+		choice[tile >> 6] = 1ull << (tile & 63);
+		SetDomain(cell, choice.GetData());
+		PropagationStack.Add(cell);
+
+		bool bConsistent = Propagate();
+		while (!bConsistent)
+		{
+			if (Decisions.Num() == 0 || BacktrackCount >= MaxBacktracks)
+			{
+				return false;
+			}
+			BacktrackCount++;
+
+			// Undo the last choice, and rule out the tile we picked
+			FDecision decision = Decisions.Pop(false);
+			UndoTo(decision.TrailLength);
+			PropagationStack.Reset();
+			FMemory::Memcpy(choice.GetData(), GetDomain(decision.Cell), WordsPerDomain * sizeof(uint64));
+			choice[decision.Tile >> 6] &= ~(1ull << (decision.Tile & 63));
+			bConsistent = SetDomain(decision.Cell, choice.GetData());
+			if (bConsistent)
+			{
+				PropagationStack.Add(decision.Cell);
+				bConsistent = Propagate();
+			}
+		}
+	}
+}
+
+void FTileSynthesizer::Apply(FDungeonRoomMetadata& Room) const
+{
+	for (TConstSetBitIterator<> cell(FreeCells); cell; ++cell)
+	{
+		int32 index = cell.GetIndex();
+		const uint64* domain = GetDomain(index);
+		const UDungeonTile* tile = NULL;
+		ForEachTile(domain, WordsPerDomain, [this, &tile](int32 Tile)
+		{
+			if (tile == NULL)
+			{
+				tile = Tiles[Tile];
+			}
+		});
+		if (tile != NULL)
+		{
+			Room.Set(index % Width, index / Width, tile);
+		}
+	}
+}
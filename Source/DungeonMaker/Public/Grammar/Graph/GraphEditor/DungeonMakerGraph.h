@@ -33,6 +33,13 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "DungeonMaker")
 	TMap<int32, UDungeonMakerNode*> NodeIDLookup;
 
+	// A hash of this graph's contents (symbols, IDs and links).
+	// Used to identify this graph without having to build a string out of it.
+	// This is updated whenever the graph is loaded, edited, or rebuilt in the editor,
+	// so reading it never writes to the graph (grammars are shared between threads).
+	UPROPERTY(VisibleAnywhere, Category = "DungeonMaker")
+	uint32 GraphID;
+
 #if WITH_EDITORONLY_DATA
 	UPROPERTY()
 	class UEdGraph* EdGraph;
@@ -54,6 +61,15 @@ public:
 
 	void ClearGraph();
 	void UpdateIDs();
+	// Recalculates the content hash of this graph.
+	void UpdateGraphID();
+	// Returns the content hash of this graph.
+	uint32 GetGraphID() const;
 	FString ToString() const;
 	int32 Num() const;
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 };
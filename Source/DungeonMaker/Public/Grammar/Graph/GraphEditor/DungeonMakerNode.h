@@ -60,6 +60,8 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeons|Missions|Debug")
 	FString ToString(int32 IndentLevel = 4, bool bPrintChildren = true);
 
+	// Checks every ancestor of this node once.
+	// If you need to check a lot of nodes, FDungeonMissionGraphAnalysis::IsAncestorOf is faster.
 	bool IsChildOf(UDungeonMakerNode* ParentSymbol) const;
 	//////////////////////////////////////////////////////////////////////////
 	UDungeonMakerGraph* GetGraph();
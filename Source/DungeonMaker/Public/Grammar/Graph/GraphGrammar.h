@@ -24,5 +24,11 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	UDungeonMakerGraph* OutputGraph;
 
+	// The graph of nodes this grammar replaces.
+	// If defined, the whole graph gets matched at once (starting from the node with an ID of 1),
+	// and our RuleInput is ignored. This lets one rule match shapes larger than a node and its child.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	UDungeonMakerGraph* InputGraph;
+
 	EGrammarResultType MatchesGrammar(const UObject* ReferenceObject, const TArray<FGraphLink>& DataSource) const;
 };
\ No newline at end of file
@@ -45,10 +45,18 @@ public:
 	UPROPERTY(BlueprintReadOnly)
 	TArray<FGraphLink> MatchedLinks;
 
+	// If this came from a grammar with an input graph, this maps the ID of each input node
+	// to the index of the mission graph node it matched.
+	TMap<int32, int32> MatchedNodes;
+	// Otherwise, the index of the mission graph node MatchedLinks[1] matched, once it's been looked up.
+	// Replacements made later go by this, since other replacements can renumber nodes in the meantime.
+	int32 MatchedChild;
+
 	FGraphOutput()
 	{
 		Weight = 0.0f;
 		MatchedLinks = TArray<FGraphLink>();
+		MatchedChild = INDEX_NONE;
 	}
 };
 
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UDungeonMissionGrammar;
+class UGraphNode;
+
+/*
+* Static facts about a set of mission grammars, worked out without generating anything.
+*
+* Every symbol which can show up in a mission (the head symbol, and anything a rule outputs)
+* gets a node in a dependency graph, with a link from each symbol to every symbol produced by
+* a rule which can consume it. From this we find:
+*  - Which rules can be reached from the head symbol at all.
+*  - Which rules can never fire (no usable input or output).
+*  - Which rules are part of a cycle, and so could keep rewriting forever.
+*  - If there are no cycles, an upper bound on how many rewrites generation can take.
+*
+* Matching is approximated generously: a rule is assumed to match any symbol its first
+* input branch could accept, so this will never call a rule unreachable when it isn't.
+*/
+struct DUNGEONMAKER_API FDungeonGrammarAnalysis
+{
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	FDungeonGrammarAnalysis();
+
+	void Build(const TArray<const UDungeonMissionGrammar*>& Grammars, const UGraphNode* HeadSymbol);
+	void Reset();
+	// Was this analysis built from these grammars?
+	bool IsBuiltFor(const TArray<const UDungeonMissionGrammar*>& Grammars, const UGraphNode* HeadSymbol) const;
+
+	int32 NumRules() const
+	{
+		return Rules.Num();
+	}
+	const UDungeonMissionGrammar* GetRule(int32 Rule) const
+	{
+		return Rules[Rule];
+	}
+	// Does this rule have everything it needs to be matched and replaced?
+	bool CanRuleFire(int32 Rule) const
+	{
+		return RuleCanFire[Rule];
+	}
+	// Can this rule be used at some point when starting from the head symbol?
+	bool IsRuleReachable(int32 Rule) const
+	{
+		return RuleReachable[Rule];
+	}
+	// Can this rule (eventually) produce a symbol which it consumes?
+	bool IsRuleRecursive(int32 Rule) const
+	{
+		return RuleRecursive[Rule];
+	}
+	// Every rule which can be reached from the head symbol, in their original order.
+	void GetReachableGrammars(TArray<const UDungeonMissionGrammar*>& OutGrammars) const;
+
+	// If true, there's a cycle of reachable rules and generation has no guaranteed end.
+	bool HasUnboundedRewriting() const
+	{
+		return bHasCycle;
+	}
+	// The most rewrites generation can make in total, or INVALID_INDEX if unbounded.
+	int32 GetMaxRewriteCount() const
+	{
+		return bHasCycle ? INVALID_INDEX : MaxRewriteCount;
+	}
+	// The most nodes a finished mission can have, or INVALID_INDEX if unbounded.
+	int32 GetMaxNodeCount() const
+	{
+		return bHasCycle ? INVALID_INDEX : MaxNodeCount;
+	}
+	// How many steps the mission generator needs to be sure of finishing, or INVALID_INDEX if unbounded.
+	// Each step is either a rewrite or a move down to a child.
+	int32 GetStepBound() const;
+
+	// Logs anything suspicious about the grammars.
+	void LogWarnings() const;
+
+private:
+	int32 AddSymbol(const UGraphNode* Symbol);
+	bool IsTerminalSymbol(int32 Symbol) const;
+	// Works out which symbols each rule can consume, and which it produces.
+	void ReadRule(int32 Rule);
+	void FindReachableRules(int32 HeadSymbolIndex);
+	// Tarjan's strongly connected components, without recursion.
+	// Components come out with everything they link to before them.
+	void FindComponents();
+	void FindBounds();
+
+	TArray<const UDungeonMissionGrammar*> Rules;
+	const UGraphNode* AnalyzedHeadSymbol;
+
+	TArray<const UGraphNode*> Symbols;
+	TMap<const UGraphNode*, int32> SymbolIndices;
+
+	TArray<bool> RuleCanFire;
+	TArray<bool> RuleReachable;
+	TArray<bool> RuleRecursive;
+	// If true, the rule might consume any symbol, and RuleConsumes doesn't matter.
+	TArray<bool> RuleConsumesAnything;
+	TArray<TArray<int32>> RuleConsumes;
+	// One entry for each node in the rule's output graph, so duplicates are kept.
+	TArray<TArray<int32>> RuleProduces;
+
+	// Every usable rule which can consume each symbol.
+	TArray<TArray<int32>> SymbolRules;
+	TArray<bool> SymbolReachable;
+	TArray<int32> SymbolComponent;
+	// Every reachable symbol, after everything it can turn into.
+	TArray<int32> ComponentOrder;
+
+	bool bHasCycle;
+	int32 MaxRewriteCount;
+	int32 MaxNodeCount;
+};
@@ -6,6 +6,10 @@
 #include "Components/ActorComponent.h"
 #include "DungeonMissionNode.h"
 #include "DungeonMissionGrammar.h"
+#include "DungeonMissionGraph.h"
+#include "DungeonMissionGraphAnalysis.h"
+#include "DungeonGrammarAnalysis.h"
+#include "DungeonMissionPatternMatcher.h"
 #include "DungeonMissionGenerator.generated.h"
 
 USTRUCT(BlueprintType)
@@ -46,12 +50,52 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dungeon Grammar")
 	TArray<const UDungeonMissionGrammar*> Grammars;
 
+	// If true, every node gets matched at once each round (across worker threads),
+	// and then as many non-overlapping replacements as possible are made.
+	// Otherwise, nodes are replaced one at a time, depth-first.
+	// Both modes always give the same results for the same seed, but not the same results as each other.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dungeon Grammar")
+	bool bRewriteInRounds = false;
+
+	// If true, grammars which can never be reached from HeadSymbol are skipped during generation.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dungeon Grammar")
+	bool bPruneUnreachableGrammars = false;
+
+	// The most steps generation can take.
+	// If our grammars are guaranteed to finish in fewer steps than this, that's used instead.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dungeon Grammar")
+	int32 MaxRewriteSteps = 255;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Dungeon Grammar")
 	int32 DungeonSize;
 
+	// The mission currently being generated.
+	// Generation works entirely on this graph; Head only gets created by MaterializeMission.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Dungeon Grammar")
+	FDungeonMissionGraph MissionGraph;
+
+	// The index of the head node within the mission graph.
+	int32 HeadIndex;
+
+	// Levels, depth and ancestry of the finished mission graph.
+	FDungeonMissionGraphAnalysis MissionAnalysis;
+
+	// Which grammars can be reached, and how long they can take to finish.
+	// Built the first time a dungeon is created, and again whenever the grammars change.
+	FDungeonGrammarAnalysis GrammarAnalysis;
+
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeons|Missions")
 	void TryToCreateDungeon(FRandomStream& Stream);
 
+	// Checks our grammars for rules which can't be reached, and works out how many steps they need.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeons|Missions")
+	void AnalyzeGrammars();
+
+	// Creates Head and UnresolvedHooks for the mission graph, once we've decided to lay it out.
+	// Does nothing if they've already been made for this mission.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeons|Missions")
+	void MaterializeMission();
+
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeons|Missions|Debug")
 	void DrawDebugDungeon();
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeons|Missions|Debug")
@@ -59,26 +103,53 @@ public:
 
 
 protected:
-	void TryToCreateDungeon(UDungeonMissionNode* StartingLocation, TArray<const UDungeonMissionGrammar*> AllowedGrammars, 
+	void TryToCreateDungeon(int32 StartingLocation, TArray<const UDungeonMissionGrammar*> AllowedGrammars, 
 		FRandomStream& Rng, int32 RemainingMaxStepCount);
 
 	void FindNodeMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
-		UDungeonMissionNode* StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars);
+		int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars);
 
 	void CheckGrammarMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
-		const TArray<FGraphLink>& Links, UDungeonMissionNode* StartingLocation, bool bFoundMatches,
+		const TArray<FGraphLink>& Links, int32 StartingLocation, bool bFoundMatches,
 		TArray<FGraphOutput>& OutAcceptableGrammars);
 
 	void FindMatchesWithChildren(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
-		UDungeonMissionNode* StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars);
+		int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars);
 
-	void ReplaceDungeonNodes(UDungeonMissionNode* StartingLocation,
-		TArray<FGraphOutput> AcceptableGrammars, FRandomStream& Rng);
+	// Matches grammars which have an input graph against the mission, rooted at StartingLocation.
+	void FindPatternMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
+		int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars);
+	const FDungeonMissionPattern& GetInputPattern(const UDungeonMakerGraph* InputGraph);
 
-	void ReplaceNodes(UDungeonMissionNode* StartingLocation,
+	void ReplaceDungeonNodes(int32 StartingLocation,
+		TArray<FGraphOutput> AcceptableGrammars, FRandomStream& Rng);
+	// Picks one of the acceptable grammars, favoring those with higher weights.
+	// Returns false if none of them can be picked.
+	bool ChooseReplacement(TArray<FGraphOutput> AcceptableGrammars, FRandomStream& Rng, FGraphOutput& OutReplacement) const;
+	// Finds every grammar which can replace the node at StartingLocation.
+	void FindAllMatches(TArray<const UDungeonMissionGrammar*>& AllowedGrammars,
+		int32 StartingLocation, TArray<FGraphOutput>& OutAcceptableGrammars);
+	// Gets every node which would be changed by replacing StartingLocation with Replacement,
+	// and saves them in Replacement so ReplaceNodes changes exactly those.
+	void ResolveMatchedNodes(int32 StartingLocation, FGraphOutput& Replacement, TArray<int32>& OutNodes) const;
+
+	// Rewrites the whole mission a round at a time, until nothing else can be replaced.
+	void RewriteInRounds(FRandomStream& Rng, int32 MaxRounds);
+
+	void ReplaceNodes(int32 StartingLocation,
 		const FGraphOutput& GrammarReplaceResult);
 
-	TMap<FString, int32> GrammarUsageCount;
+	// The grammars actually used for generation.
+	TArray<const UDungeonMissionGrammar*> ActiveGrammars;
+
+	// Indices of all nodes in the mission graph which had no matching grammars.
+	TArray<int32> UnresolvedHookIndices;
+
+	// Compiled versions of each grammar's input graph.
+	TMap<const UDungeonMakerGraph*, FDungeonMissionPattern> InputPatterns;
+
+	// How many times each output graph has been used, keyed by the graph's ID.
+	TMap<uint32, int32> GrammarUsageCount;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dungeon Grammar")
 	TArray<UDungeonMissionNode*> UnresolvedHooks;
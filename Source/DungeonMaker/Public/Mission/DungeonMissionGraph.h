@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphNode.h"
+#include "DungeonMissionGraph.generated.h"
+
+class UDungeonMissionNode;
+
+/*
+* A compact, index-based representation of a dungeon mission.
+* Nodes are stored as parallel arrays (one entry per node), and links are stored
+* in a single edge arena, with each node keeping the head and tail of its child
+* and parent lists. Nothing in here is a UObject, so generating (and throwing away)
+* a mission doesn't create any garbage for the GC to clean up.
+*
+* Once a mission is finished, it can be turned into a tree of UDungeonMissionNodes
+* with Materialize() for anything that needs it (like Blueprints).
+*/
+USTRUCT(BlueprintType)
+struct DUNGEONMAKER_API FDungeonMissionGraph
+{
+	GENERATED_BODY()
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	// The symbol used by each node.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<UGraphNode*> NodeTypes;
+	// The ID of each node.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<int32> NodeIDs;
+	// Whether each node is tightly coupled to its parent.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<bool> TightlyCoupled;
+
+	FDungeonMissionGraph()
+	{
+		Reset();
+	}
+
+	void Reset(int32 ExpectedNodeCount = 0);
+
+	int32 AddNode(UGraphNode* Symbol, int32 NodeID, bool bTightlyCoupledToParent);
+	// Links a parent to a child. Does nothing if the link already exists.
+	void AddLink(int32 Parent, int32 Child, bool bTightlyCoupled);
+	// Removes the link between a parent and a child, if there is one.
+	void BreakLink(int32 Parent, int32 Child);
+
+	int32 Num() const
+	{
+		return NodeTypes.Num();
+	}
+	bool IsValidNode(int32 Node) const
+	{
+		return NodeTypes.IsValidIndex(Node);
+	}
+
+	// Iteration over the children of a node, in the order they were added.
+	// for (int32 edge = FirstChildEdge(n); edge != INVALID_INDEX; edge = NextChildEdge(edge))
+	int32 FirstChildEdge(int32 Node) const
+	{
+		return FirstOutEdge[Node];
+	}
+	int32 NextChildEdge(int32 Edge) const
+	{
+		return NextOutEdge[Edge];
+	}
+	// Iteration over the parents of a node, in the order they were added.
+	int32 FirstParentEdge(int32 Node) const
+	{
+		return FirstInEdge[Node];
+	}
+	int32 NextParentEdge(int32 Edge) const
+	{
+		return NextInEdge[Edge];
+	}
+	int32 GetEdgeChild(int32 Edge) const
+	{
+		return EdgeTo[Edge];
+	}
+	int32 GetEdgeParent(int32 Edge) const
+	{
+		return EdgeFrom[Edge];
+	}
+
+	int32 GetChildCount(int32 Node) const
+	{
+		return OutDegree[Node];
+	}
+	int32 GetParentCount(int32 Node) const
+	{
+		return InDegree[Node];
+	}
+	void GetChildren(int32 Node, TArray<int32>& OutChildren) const;
+	void GetParents(int32 Node, TArray<int32>& OutParents) const;
+
+	// Is Parent directly linked to Child?
+	bool HasLink(int32 Parent, int32 Child) const
+	{
+		return FindEdge(Parent, Child) != INVALID_INDEX;
+	}
+
+	// Returns the first child of a node with the given symbol and ID, or INVALID_INDEX.
+	int32 FindChildFromSymbol(int32 Node, const FNumberedGraphSymbol& ChildSymbol) const;
+
+	FNumberedGraphSymbol ToGraphSymbol(int32 Node) const;
+	bool IsTerminal(int32 Node) const;
+	FString GetSymbolDescription(int32 Node) const;
+	FString ToString(int32 Node, int32 IndentLevel = 0, bool bPrintChildren = true) const;
+
+	// Creates UDungeonMissionNodes for every node in this graph, linked together the same way.
+	// OutNodes is indexed the same way as this graph.
+	UDungeonMissionNode* Materialize(UObject* Outer, int32 Head, TArray<UDungeonMissionNode*>& OutNodes) const;
+
+private:
+	int32 FindEdge(int32 Parent, int32 Child) const;
+
+	// Per-node adjacency list heads
+	TArray<int32> FirstOutEdge;
+	TArray<int32> LastOutEdge;
+	TArray<int32> FirstInEdge;
+	TArray<int32> LastInEdge;
+	TArray<int32> OutDegree;
+	TArray<int32> InDegree;
+
+	// Edge arena
+	TArray<int32> EdgeFrom;
+	TArray<int32> EdgeTo;
+	TArray<int32> NextOutEdge;
+	TArray<int32> PrevOutEdge;
+	TArray<int32> NextInEdge;
+	TArray<int32> PrevInEdge;
+	// Edges which have been broken and can be reused
+	TArray<int32> FreeEdges;
+};
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonMissionGraph.h"
+
+class UDungeonMakerNode;
+
+/*
+* Precomputed facts about the shape of a mission graph.
+* Everything in here is computed once, in O(V + E) (ancestry is O(V * V / 32) words),
+* so callers can ask about levels, depth and ancestry as often as they like
+* without walking the graph again.
+*
+* This can be built from either an FDungeonMissionGraph or from a set of
+* UDungeonMakerNodes. In the latter case, use IndexOf() to find a node's index.
+*/
+struct DUNGEONMAKER_API FDungeonMissionGraphAnalysis
+{
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	FDungeonMissionGraphAnalysis();
+
+	void Build(const FDungeonMissionGraph& Graph);
+	// Builds an analysis of every node reachable from Head, following children.
+	void Build(UDungeonMakerNode* Head);
+	void Reset();
+
+	int32 Num() const
+	{
+		return ChildOffsets.Num() - 1;
+	}
+
+	// Returns the index of a node this analysis was built from, or INVALID_INDEX.
+	int32 IndexOf(const UDungeonMakerNode* Node) const;
+	UDungeonMakerNode* GetNode(int32 Index) const
+	{
+		return Nodes.IsValidIndex(Index) ? Nodes[Index] : NULL;
+	}
+
+	// Every node, with all parents before their children.
+	// Any nodes which are part of a cycle get appended to the end.
+	const TArray<int32>& GetTopologicalOrder() const
+	{
+		return TopologicalOrder;
+	}
+	// Where a node appears in the topological order.
+	int32 GetTopologicalRank(int32 Node) const
+	{
+		return TopologicalRank[Node];
+	}
+	bool IsAcyclic() const
+	{
+		return bIsAcyclic;
+	}
+
+	// Number of nodes on the longest path from this node down to a leaf, including itself.
+	// A leaf has a level count of 1.
+	int32 GetLevelCount(int32 Node) const
+	{
+		return LevelCount[Node];
+	}
+	// Length of the longest path from any root down to this node. Roots have a depth of 0.
+	int32 GetDepth(int32 Node) const
+	{
+		return Depth[Node];
+	}
+	// The largest level count of any node in the graph.
+	int32 GetMaxLevelCount() const
+	{
+		return MaxLevelCount;
+	}
+	// All nodes with the same depth, grouped together.
+	const TArray<int32>& GetNodesAtDepth(int32 NodeDepth) const
+	{
+		return Levels[NodeDepth];
+	}
+	int32 GetDepthCount() const
+	{
+		return Levels.Num();
+	}
+
+	// Is Ancestor somewhere above Node in the graph?
+	bool IsAncestorOf(int32 Ancestor, int32 Node) const;
+
+	// Breadth-first traversal through children, starting at Start.
+	void GetBreadthFirstOrder(int32 Start, TArray<int32>& OutOrder) const;
+
+	// Iteration over the children and parents of a node.
+	int32 GetChildCount(int32 Node) const
+	{
+		return ChildOffsets[Node + 1] - ChildOffsets[Node];
+	}
+	int32 GetChild(int32 Node, int32 ChildIndex) const
+	{
+		return ChildIndices[ChildOffsets[Node] + ChildIndex];
+	}
+	int32 GetParentCount(int32 Node) const
+	{
+		return ParentOffsets[Node + 1] - ParentOffsets[Node];
+	}
+	int32 GetParent(int32 Node, int32 ParentIndex) const
+	{
+		return ParentIndices[ParentOffsets[Node] + ParentIndex];
+	}
+
+private:
+	// Builds the parent lists from the child lists, then computes everything else
+	void Analyze();
+	void ComputeTopologicalOrder();
+	void ComputeLevels();
+	void ComputeAncestors();
+
+	// Children of node i are ChildIndices[ChildOffsets[i]] to ChildIndices[ChildOffsets[i + 1] - 1]
+	TArray<int32> ChildOffsets;
+	TArray<int32> ChildIndices;
+	TArray<int32> ParentOffsets;
+	TArray<int32> ParentIndices;
+
+	// Only used when built from UDungeonMakerNodes
+	TArray<UDungeonMakerNode*> Nodes;
+	TMap<const UDungeonMakerNode*, int32> NodeIndices;
+
+	TArray<int32> TopologicalOrder;
+	TArray<int32> TopologicalRank;
+	bool bIsAcyclic;
+
+	TArray<int32> LevelCount;
+	TArray<int32> Depth;
+	TArray<TArray<int32>> Levels;
+	int32 MaxLevelCount;
+
+	// One bit per node, per node. Row i has a bit set for each ancestor of i.
+	TArray<uint32> AncestorBits;
+	int32 AncestorWordsPerNode;
+};
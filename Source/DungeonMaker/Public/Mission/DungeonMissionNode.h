@@ -8,6 +8,8 @@
 #include "DungeonMakerNode.h"
 #include "DungeonMissionNode.generated.h"
 
+struct FDungeonMissionGraphAnalysis;
+
 /*
 * This is essentially an implementation of a doubly-linked list for Dungeon Mission Symbols.
 * This helps represent the graph of associations within rooms in the dungeon itself.
@@ -28,7 +30,12 @@ public:
 	FString GetSymbolDescription();
 
 	void AddLinkToNode(UDungeonMissionNode* NewChild, bool bTightlyCoupled);
+	// Builds a one-off analysis of everything below this node.
+	// When asking about several nodes of the same mission, build one analysis and use the overload below.
 	int32 GetLevelCount();
+	// Analysis needs to have been built from a graph containing this node,
+	// so it can be shared between every node of the same mission.
+	int32 GetLevelCount(const FDungeonMissionGraphAnalysis& Analysis) const;
 
 	/*static TArray<UDungeonMissionNode*> GetDepthFirstSortedNodes(UDungeonMissionNode* Head, bool bOnlyTightlyCoupled);
 	static TArray<UDungeonMissionNode*> GetTopologicalSortedNodes(UDungeonMissionNode* Head);
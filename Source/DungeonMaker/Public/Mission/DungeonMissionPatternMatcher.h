@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonMissionGraph.h"
+
+class UDungeonMakerGraph;
+
+/*
+* A grammar input graph, flattened into arrays so it can be matched quickly.
+* The node with ID 1 is the root of the pattern, which gets matched against the
+* node we're trying to replace. Every other node has to be connected to the root somehow.
+*/
+struct DUNGEONMAKER_API FDungeonMissionPattern
+{
+public:
+	// Builds this pattern out of a graph. Returns false if the graph can't be used as a pattern.
+	bool Compile(const UDungeonMakerGraph* Graph);
+
+	int32 Num() const
+	{
+		return Symbols.Num();
+	}
+	bool IsValid() const
+	{
+		return Symbols.Num() > 0;
+	}
+
+	// The symbol each node must have. A null symbol matches anything.
+	TArray<const UGraphNode*> Symbols;
+	// The ID of each node in the input graph.
+	TArray<int32> NodeIDs;
+	// Whether each node must be tightly coupled to its parent.
+	// Only checked for nodes which have a parent in the pattern.
+	TArray<bool> TightlyCoupled;
+	TArray<TArray<int32>> Children;
+	TArray<TArray<int32>> Parents;
+
+	// The order nodes get matched in. The root is always first.
+	TArray<int32> MatchOrder;
+	// For each node in MatchOrder (after the root), a node earlier in the order that it's linked to.
+	// Candidates are taken from the neighbors of whatever that node matched.
+	TArray<int32> Anchors;
+	// Whether the anchor is the parent (true) or child (false) of the node.
+	TArray<bool> AnchorIsParent;
+};
+
+/*
+* Finds every place a pattern appears in a mission graph, starting from a specific node.
+* This is a VF2-style search: pattern nodes are matched one at a time, candidates only come
+* from the neighbors of nodes which have already been matched, and candidates are pruned by
+* symbol, coupling, degree, and links to everything matched so far.
+*
+* Matches are induced: two matched nodes are linked in the mission if and only if they're
+* linked in the pattern.
+*/
+struct DUNGEONMAKER_API FDungeonMissionPatternMatcher
+{
+public:
+	// Finds up to MaxMatches matches with the pattern's root at Root.
+	// Each match is indexed by pattern node and contains the matching mission graph index.
+	static int32 FindMatches(const FDungeonMissionPattern& Pattern, const FDungeonMissionGraph& Graph,
+		int32 Root, TArray<TArray<int32>>& OutMatches, int32 MaxMatches = 16);
+
+private:
+	static void MatchNext(const FDungeonMissionPattern& Pattern, const FDungeonMissionGraph& Graph,
+		int32 OrderIndex, TArray<int32>& CurrentMatch, TArray<TArray<int32>>& OutMatches, int32 MaxMatches);
+	static bool IsFeasible(const FDungeonMissionPattern& Pattern, const FDungeonMissionGraph& Graph,
+		int32 PatternNode, int32 Candidate, const TArray<int32>& CurrentMatch);
+};
@@ -27,11 +27,56 @@ public:
 	int32 Seed = 1234;
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
 	bool bChooseRandomSeedAtRuntime = false;
+	// How many more times to try laying out a mission, each with its own seed, before giving up on it
+	// and generating a new mission. At 0, every failed layout generates a new mission.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	int32 LayoutRetriesPerMission = 4;
 
 public:
 	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
 	TSet<FIntVector> GetAllTilesOfType(ETileType Type) const;
 
+	// Converts a world location to the tile it's in.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	FIntVector ConvertWorldToTileSpace(FVector WorldLocation) const;
+	// Finds the closest tile of a type on the same floor as Origin, in tile space.
+	// If MaxDistance is above 0, tiles further away than that are ignored.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	bool FindNearestTileOfType(ETileType Type, FIntVector Origin, int32 MaxDistance, FIntVector& NearestTile) const;
+	// All tiles of a type within Radius tiles of Center, on the same floor.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	TArray<FIntVector> GetTilesOfTypeInRadius(ETileType Type, FIntVector Center, float Radius) const;
+	// All tiles of a type between Min and Max (inclusive), on Min's floor.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	TArray<FIntVector> GetTilesOfTypeInRectangle(ETileType Type, FIntVector Min, FIntVector Max) const;
+
+	// Finds a path over floor tiles from Start to Goal, in tile space. Both need to be on the same floor.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	bool FindPath(FIntVector Start, FIntVector Goal, TArray<FIntVector>& Path);
+	// The next tile to move to from From, to get closer to Target.
+	// Cheap to call for lots of agents heading to the same target, since the flow field toward it is cached.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	FIntVector GetFlowDirection(FIntVector Target, FIntVector From);
+	// How many tiles away Target is from From, walking over floor tiles. -1 if it can't be reached.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	int32 GetFlowDistance(FIntVector Target, FIntVector From);
+
+	// Whether From can see To through floor tiles, both in tile space.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	bool HasLineOfSight(FIntVector From, FIntVector To) const;
+	// Every tile visible from Origin, within Radius tiles.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	TArray<FIntVector> GetVisibleTiles(FIntVector Origin, int32 Radius);
+	// Call whenever the player moves, to update what's visible and explored.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	void UpdateFogOfWar(FIntVector PlayerLocation, int32 SightRadius);
+	// Whether the player can currently see a tile, as of the last fog of war update.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	bool IsTileVisible(FIntVector Tile) const;
+	// Whether the player has ever seen a tile.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	bool IsTileExplored(FIntVector Tile) const;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
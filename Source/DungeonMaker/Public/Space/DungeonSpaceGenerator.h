@@ -10,10 +10,22 @@
 #include "Rooms/DungeonRoom.h"
 #include "Floor/DungeonMissionSpaceHandler.h"
 #include "Floor/DungeonFloorManager.h"
+#include "Floor/DungeonSolvabilityAnalyzer.h"
+#include "Floor/DungeonTileGrid.h"
+#include "Floor/DungeonPathfinder.h"
+#include "Floor/DungeonVisibility.h"
 #include "../Mission/DungeonMissionNode.h"
 #include "GroundScatterManager.h"
 #include "DungeonSpaceGenerator.generated.h"
 
+UENUM(BlueprintType)
+enum class EDungeonFloorSizing : uint8
+{
+	// Floors are sized from DungeonSize and RoomSize alone.
+	Fixed,
+	// Floors are sized from the shape of the mission, so there's enough space to lay it out.
+	FitToMission
+};
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class DUNGEONMAKER_API UDungeonSpaceGenerator : public UActorComponent
@@ -35,11 +47,20 @@ public:
 	int32 MaxGeneratedRooms;
 	UPROPERTY(EditInstanceOnly, BlueprintReadOnly, Category = "Debug")
 	bool bDebugDungeon;
+	// Whether the engine's navmesh gets built over the tile meshes.
+	// Turn this off if agents path with the dungeon's own pathfinding instead, which is built
+	// straight from the tiles and only rebuilds the rooms that change.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Tiles")
+	bool bTileMeshesAffectNavigation = true;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replacement")
 	TArray<FRoomReplacements> PreGenerationRoomReplacementPhases;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replacement")
 	TArray<FRoomReplacements> PostGenerationRoomReplacementPhases;
+	// Picks wall, edge and corner variants from each tile's neighbors after all the replacement phases.
+	// Cheaper than a replacement pattern per mirrored case.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replacement")
+	UTileAutotiler* Autotiler;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Props")
 	FGroundScatterPairing GlobalGroundScatter;
@@ -52,6 +73,42 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
 	int32 RoomSize = 24;
 
+	// How the floors are sized before the mission is laid out.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	EDungeonFloorSizing FloorSizing = EDungeonFloorSizing::Fixed;
+	// When fitting floors to the mission, the most of the floor the mission's rooms should fill.
+	// Lower values leave more space around crowded parts of the mission, so layouts fail less often.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon", meta = (ClampMin = "0.1", ClampMax = "1.0"))
+	float MaxFloorOccupancy = 0.6f;
+	// If true, a failed layout grows each floor by one room along each axis (so an N x N floor
+	// becomes (N + 1) x (N + 1)) and tries the same mission again, rather than giving up on the mission.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	bool bGrowFloorsOnLayoutFailure = false;
+	// How many times the floors can grow for a single mission.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	int32 MaxFloorGrowth = 3;
+
+	// How many room placements we can try when laying out the dungeon before giving up.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	int32 MaxLayoutSteps = 10000;
+	// How many different layouts to try for each mission. The first one (by index) that works is used.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	int32 LayoutAttempts = 1;
+	// If true, layout attempts all run at once, across worker threads. This gives the same results.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	bool bParallelLayoutAttempts = false;
+
+	// If true, any layout where the goal can't be reached will be thrown out before any rooms are spawned.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	bool bRejectUnsolvableLayouts = false;
+	// The symbol for the room the player is trying to reach.
+	// If this is not set, the room furthest down the mission is used.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+	const UGraphNode* GoalSymbol;
+
+	UPROPERTY(BlueprintReadOnly, VisibleInstanceOnly, Category = "Dungeon")
+	FDungeonSolvabilityReport Solvability;
+
 	UPROPERTY(BlueprintReadOnly, VisibleInstanceOnly, Category = "Dungeon")
 	TSet<ADungeonRoom*> MissionRooms;
 
@@ -74,9 +131,22 @@ public:
 
 	UPROPERTY(BlueprintReadOnly, VisibleInstanceOnly, Category = "Dungeon")
 	TArray<UDungeonFloorManager*> Floors;
+
+	// Every tile in the dungeon, for spatial queries. Built once all the rooms are spawned.
+	FDungeonTileGrid TileGrid;
+	// Paths and flow fields over the tile grid's floor tiles.
+	FDungeonPathfinder Pathfinder;
+	// Line of sight and fog of war over the tile grid.
+	FDungeonVisibility Visibility;
 public:	
 	bool CreateDungeonSpace(UDungeonMissionNode* Head, int32 SymbolCount, FRandomStream& Rng);
 	void DrawDebugSpace();
 	FIntVector ConvertToFloorSpace(FIntVector TileSpaceLocation);
 	FFloorRoom GetRoomFromFloorCoordinates(FIntVector FloorSpaceLocation);
+	// Finds a room without copying it. Returns NULL if the location is invalid.
+	const FFloorRoom* FindRoom(FIntVector FloorSpaceLocation) const;
+
+private:
+	// Finds the smallest floor which the mission should fit on, based on how crowded its rooms are.
+	int32 FitFloorToMission(UDungeonMissionNode* Head, int32 SymbolCount) const;
 };
@@ -15,6 +15,9 @@ class ADungeonRoom;
 * It also contains data about which rooms will neighbor this room.
 * Once the room is spawned, it contains a reference to the spawned room
 * as well as any metadata involving that room.
+*
+* Rooms can only neighbor each other along an axis, so neighbors are stored as
+* a bit per direction: +X, -X, +Y, -Y, +Z, -Z.
 */
 USTRUCT(BlueprintType)
 struct DUNGEONMAKER_API FFloorRoom
@@ -27,10 +30,12 @@ public:
 	
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
 	FIntVector Location;
+	// A bit for each direction with a loosely-coupled neighbor.
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
-	TSet<FIntVector> NeighboringRooms;
+	uint8 NeighborMask;
+	// A bit for each direction with a tightly-coupled neighbor.
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
-	TSet<FIntVector> NeighboringTightlyCoupledRooms;
+	uint8 TightlyCoupledNeighborMask;
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
 	FIntVector IncomingRoom;
 	
@@ -45,105 +50,193 @@ public:
 	{
 		RoomClass = NULL;
 		Location = FIntVector::ZeroValue;
-		NeighboringRooms = TSet<FIntVector>();
-		NeighboringTightlyCoupledRooms = TSet<FIntVector>();
+		NeighborMask = 0;
+		TightlyCoupledNeighborMask = 0;
 		IncomingRoom = FIntVector::ZeroValue;
 		Difficulty = 0.0f;
 		SpawnedRoom = NULL;
 		DungeonSymbol = FNumberedGraphSymbol();
 	}
 
-	TSet<FIntVector> GetOutgoingRooms() const
+	static const int32 DIRECTION_COUNT = 6;
+
+	// Flipping the lowest bit of a direction gives the opposite direction.
+	static FIntVector GetDirectionOffset(int32 Direction)
 	{
-		TSet<FIntVector> neighbors = TSet<FIntVector>(NeighboringRooms);
-		neighbors.Append(NeighboringTightlyCoupledRooms);
-		neighbors.Remove(IncomingRoom);
-		return neighbors;
+		static const FIntVector DIRECTIONS[DIRECTION_COUNT] = { FIntVector(1, 0, 0), FIntVector(-1, 0, 0),
+			FIntVector(0, 1, 0), FIntVector(0, -1, 0), FIntVector(0, 0, 1), FIntVector(0, 0, -1) };
+		return DIRECTIONS[Direction];
 	}
-};
 
-USTRUCT(BlueprintType)
-struct DUNGEONMAKER_API FDungeonFloorRow
-{
-	GENERATED_BODY()
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-		TArray<FFloorRoom> DungeonRooms;
+	// The bit for the direction of Other from this room, or 0 if it isn't right next to us.
+	uint8 GetDirectionBit(const FIntVector& Other) const
+	{
+		FIntVector offset = Other - Location;
+		for (int32 direction = 0; direction < DIRECTION_COUNT; direction++)
+		{
+			if (offset == GetDirectionOffset(direction))
+			{
+				return (uint8)(1 << direction);
+			}
+		}
+		return 0;
+	}
+
+	FIntVector GetNeighborLocation(int32 Direction) const
+	{
+		return Location + GetDirectionOffset(Direction);
+	}
+
+	// Returns false if the other room isn't right next to us.
+	bool AddNeighbor(const FIntVector& Other, bool bTightlyCoupled)
+	{
+		uint8 bit = GetDirectionBit(Other);
+		if (bTightlyCoupled)
+		{
+			TightlyCoupledNeighborMask |= bit;
+		}
+		else
+		{
+			NeighborMask |= bit;
+		}
+		return bit != 0;
+	}
+
+	void SetIncomingRoom(const FIntVector& Other)
+	{
+		IncomingRoom = Other;
+	}
+
+	// The bit for the direction we're entered from, if it's a neighbor.
+	// Worked out from IncomingRoom every time, so a room that was never given one
+	// still treats (0, 0, 0) as where it's entered from, like it always has.
+	uint8 GetIncomingMask() const
+	{
+		return GetDirectionBit(IncomingRoom);
+	}
+
+	// Every direction with a neighbor, tightly-coupled or not.
+	uint8 GetAllNeighborsMask() const
+	{
+		return NeighborMask | TightlyCoupledNeighborMask;
+	}
 
-	FDungeonFloorRow()
+	// Every direction with a neighbor we lead into.
+	uint8 GetOutgoingMask() const
 	{
-		DungeonRooms = TArray<FFloorRoom>();
+		return GetAllNeighborsMask() & ~GetIncomingMask();
 	}
 
-	FDungeonFloorRow(int Size)
+	bool IsOutgoingRoom(const FIntVector& Other) const
 	{
-		DungeonRooms.SetNum(Size);
-		for (int i = 0; i < Size; i++)
+		return (GetOutgoingMask() & GetDirectionBit(Other)) != 0;
+	}
+
+	// Converts a direction mask into the locations of those neighbors.
+	TSet<FIntVector> GetNeighborLocations(uint8 Mask) const
+	{
+		TSet<FIntVector> neighbors;
+		for (int32 direction = 0; direction < DIRECTION_COUNT; direction++)
 		{
-			DungeonRooms[i] = FFloorRoom();
+			if (Mask & (1 << direction))
+			{
+				neighbors.Add(GetNeighborLocation(direction));
+			}
 		}
+		return neighbors;
 	}
 
-	void Set(FFloorRoom Room, int Index)
+	TSet<FIntVector> GetOutgoingRooms() const
 	{
-		DungeonRooms[Index] = Room;
+		return GetNeighborLocations(GetOutgoingMask());
 	}
+};
+
+// Refers to a single room by its floor and its index on that floor.
+// Stays valid until the floors are resized.
+struct DUNGEONMAKER_API FFloorRoomHandle
+{
+	int32 Floor;
+	int32 Index;
 
-	FFloorRoom operator[] (int Index)
+	FFloorRoomHandle()
 	{
-		return DungeonRooms[Index];
+		Floor = INDEX_NONE;
+		Index = INDEX_NONE;
 	}
 
-	int Num() const
+	FFloorRoomHandle(int32 FloorIndex, int32 RoomIndex)
 	{
-		return DungeonRooms.Num();
+		Floor = FloorIndex;
+		Index = RoomIndex;
 	}
 
+	bool IsValid() const
+	{
+		return Floor != INDEX_NONE && Index != INDEX_NONE;
+	}
 };
 
+/*
+* A single floor of rooms.
+* Rooms are stored in one dense array, row by row, so looking one up is a single index.
+*/
 USTRUCT(BlueprintType)
 struct DUNGEONMAKER_API FDungeonFloor
 {
 	GENERATED_BODY()
 
+	// The room at (X, Y) is at Y * XSize() + X.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	TArray<FDungeonFloorRow> DungeonRooms;
+	TArray<FFloorRoom> Rooms;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Width;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Height;
 
 	FDungeonFloor()
 	{
-		DungeonRooms = TArray<FDungeonFloorRow>();
+		Width = 0;
+		Height = 0;
 	}
 
 	FDungeonFloor(int SizeX, int SizeY)
 	{
 		check(SizeX >= 0);
 		check(SizeY >= 0);
-		DungeonRooms.SetNum(SizeY);
-		for (int i = 0; i < SizeY; i++)
-		{
-			DungeonRooms[i] = FDungeonFloorRow(SizeX);
-		}
+		Width = SizeX;
+		Height = SizeY;
+		Rooms.SetNum(SizeX * SizeY);
 	}
 
-	FDungeonFloorRow& operator[] (int Index)
+	int XSize() const
 	{
-		return DungeonRooms[Index];
+		return Width;
 	}
 
-	int XSize() const
+	int YSize() const
 	{
-		if (DungeonRooms.Num() == 0)
-		{
-			return 0;
-		}
-		else
-		{
-			return DungeonRooms[0].Num();
-		}
+		return Height;
 	}
 
-	int YSize() const
+	bool IsValid(int X, int Y) const
+	{
+		return X >= 0 && Y >= 0 && X < Width && Y < Height;
+	}
+
+	int32 ToIndex(int X, int Y) const
+	{
+		return Y * Width + X;
+	}
+
+	const FFloorRoom& Get(int X, int Y) const
+	{
+		return Rooms[ToIndex(X, Y)];
+	}
+
+	FFloorRoom& Get(int X, int Y)
 	{
-		return DungeonRooms.Num();
+		return Rooms[ToIndex(X, Y)];
 	}
 
 	//FColor DrawFloor(AActor* ContextObject, FIntVector Position);
@@ -155,6 +248,6 @@ struct DUNGEONMAKER_API FDungeonFloor
 	const UDungeonTile* GetTileAt(FIntVector CurrentLocation);
 	ADungeonRoom* GetRoom(FIntVector CurrentLocation);*/
 	void DrawDungeonFloor(AActor* Context, int32 RoomSize, int32 ZOffset);
-	void Set(FFloorRoom Room);
+	void Set(const FFloorRoom& Room);
 	void UpdateChildren(FIntVector A, FIntVector B);
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 
 #include "../Tiles/RoomReplacementPattern.h"
+#include "../Tiles/TileAutotiler.h"
 #include "DungeonMissionNode.h"
 #include "DungeonFloor.h"
 #include "GroundScatterManager.h"
@@ -43,6 +44,9 @@ public:
 	TArray<FRoomReplacements> PreGenerationRoomReplacementPhases;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FRoomReplacements> PostGenerationRoomReplacementPhases;
+	// Picks cosmetic tile variants once every replacement phase is done.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UTileAutotiler* Autotiler;
 
 	// The size of any room on this floor, in tile space.
 	// The total number of rooms this floor will have is determined by
@@ -64,6 +68,8 @@ public:
 	// Gets a room based on tile space coordinates.
 	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
 	FFloorRoom GetRoomFromTileSpace(FIntVector TileSpaceLocation);
+	// Finds a room without copying it. Returns NULL if there's no room slot at that location.
+	const FFloorRoom* FindRoomFromTileSpace(FIntVector TileSpaceLocation) const;
 
 	const UDungeonTile* GetTileFromTileSpace(FIntVector TileSpaceLocation);
 	void UpdateTileFromTileSpace(FIntVector TileSpaceLocation, const UDungeonTile* NewTile);
@@ -80,9 +86,9 @@ public:
 private:
 	ADungeonRoom* CreateRoom(const FFloorRoom& Room, FRandomStream& Rng, 
 		const FGroundScatterPairing& GlobalGroundScatter);
-	// Returns a COPY of the DungeonFloor we represent.
-	FDungeonFloor GetDungeonFloor() const;
+	const FDungeonFloor& GetDungeonFloor() const;
 	void CreateEntrances(ADungeonRoom* Room, FRandomStream& Rng);
 	void DoTileReplacement(ADungeonRoom* Room, FRandomStream& Rng);
 	void DoFloorWideTileReplacement(TArray<FRoomReplacements> ReplacementPhases, FRandomStream &Rng);
+	void DoFloorWideAutotiling();
 };
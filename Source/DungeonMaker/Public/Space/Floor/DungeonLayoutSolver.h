@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonFloor.h"
+
+class UDungeonMissionNode;
+struct FDungeonMissionGraphAnalysis;
+
+// Where a single mission node ended up.
+struct DUNGEONMAKER_API FDungeonLayoutPlacement
+{
+	UDungeonMissionNode* Node;
+	// Floor-space location of the node's room.
+	FIntVector Location;
+	// The room this room is entered from, or (-1, -1, -1) for the first room.
+	FIntVector EntranceLocation;
+	bool bIsTightlyCoupled;
+};
+
+/*
+* Pairs every mission node with a room on the dungeon floors.
+*
+* Nodes are placed one at a time: tightly-coupled nodes right after the parent they need to be
+* next to, and everything else in topological order. Each node tries every location it could go,
+* in a random order. After each placement, we check that every placed room still has enough
+* free neighbors for the tightly-coupled rooms it's still waiting on; if not, we try the next
+* location. If a node runs out of locations, we back up and move the node before it instead.
+*
+* Free neighbors are kept as a bitmask per cell, so checks are a popcount rather than a search.
+* Solving gives up after a set number of placements, so a bad mission fails in bounded time.
+*/
+struct DUNGEONMAKER_API FDungeonLayoutSolver
+{
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	FDungeonLayoutSolver();
+
+	// Sets up an empty grid the same size as the given floors.
+	void Initialize(const TArray<FDungeonFloor>& DungeonSpace);
+	// Tries to place every node in the mission, starting with its first node at StartLocation.
+	// Returns false if there's no layout, or if MaxSteps placements were tried without finding one.
+	bool Solve(const FDungeonMissionGraphAnalysis& Mission, FIntVector StartLocation,
+		FRandomStream& Rng, int32 MaxSteps);
+
+	// If set, this gets checked every so often while solving. Returning true stops the solver,
+	// which then fails. Can be called from whatever thread we're solving on.
+	TFunction<bool()> ShouldCancel;
+
+	// Every node's room, in the order they were placed.
+	const TArray<FDungeonLayoutPlacement>& GetPlacements() const
+	{
+		return Placements;
+	}
+	int32 GetStepCount() const
+	{
+		return StepCount;
+	}
+	int32 GetBacktrackCount() const
+	{
+		return BacktrackCount;
+	}
+
+private:
+	// Empties every cell.
+	void ClearGrid();
+	// The order nodes get placed in, and which node each tightly-coupled node has to be next to.
+	void OrderNodes(const FDungeonMissionGraphAnalysis& Mission);
+	void FindCandidates(int32 Step, FRandomStream& Rng);
+	void Place(int32 Step, int32 Cell);
+	void Unplace(int32 Step);
+	// Can everything placed so far still have its tightly-coupled rooms next to it?
+	bool IsConsistent(int32 Cell) const;
+	int32 FindEntrance(int32 Step, int32 Cell) const;
+
+	int32 ToCell(const FIntVector& Location) const;
+	FIntVector ToLocation(int32 Cell) const;
+	int32 GetNeighbor(int32 Cell, int32 Direction) const
+	{
+		return CellNeighbors[Cell * 4 + Direction];
+	}
+	int32 CountFreeNeighbors(int32 Cell) const
+	{
+		return FMath::CountBits(FreeNeighbors[Cell]);
+	}
+
+	// Grid
+	TArray<int32> FloorXSizes;
+	TArray<int32> FloorYSizes;
+	TArray<int32> FloorOffsets;
+	// The cell in each direction (+X, -X, +Y, -Y), or INVALID_INDEX.
+	TArray<int32> CellNeighbors;
+	// Bit N is set if the neighbor in direction N exists and is empty.
+	TArray<uint8> FreeNeighbors;
+	// How many neighboring rooms are allowed to have children, and so could lead into this cell.
+	TArray<uint8> OpenNeighbors;
+	// The step whose node is in each cell, or INVALID_INDEX.
+	TArray<int32> CellStep;
+	int32 FreeCellCount;
+	int32 StartCell;
+
+	// Per step, in placement order
+	TArray<UDungeonMissionNode*> Order;
+	// The step a tightly-coupled node has to be next to, or INVALID_INDEX.
+	TArray<int32> Anchors;
+	TArray<bool> AllowsChildren;
+	// How many tightly-coupled nodes anchored to each step haven't been placed yet.
+	TArray<int32> PendingTightNodes;
+	TArray<TArray<int32>> Candidates;
+	TArray<int32> NextCandidate;
+	TArray<int32> StepCells;
+	TArray<int32> StepEntrances;
+	// The steps of each node's parents, for finding entrances.
+	TArray<TArray<int32>> ParentSteps;
+
+	TArray<FDungeonLayoutPlacement> Placements;
+	int32 StepCount;
+	int32 BacktrackCount;
+};
@@ -8,7 +8,9 @@
 
 #include "../Tiles/RoomReplacementPattern.h"
 #include "DungeonMissionNode.h"
+#include "DungeonMissionGraphAnalysis.h"
 #include "DungeonFloor.h"
+#include "DungeonLayoutSolver.h"
 #include "DungeonMissionSpaceHandler.generated.h"
 
 class UDungeonSpaceGenerator;
@@ -32,8 +34,24 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	int32 RoomSize = 32;
 
+	// How many room placements the layout solver can try before giving up.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int32 MaxLayoutSteps = 10000;
+
+	// How many layouts to try before giving up. With more than one attempt, each attempt gets
+	// its own seed and the first attempt (by index) to succeed is used, so running them in
+	// parallel gives the same layout as running them one after another.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int32 LayoutAttempts = 1;
+	// If true, all layout attempts are run at once across worker threads.
+	// Attempts which can't be used anymore stop as soon as an earlier one succeeds.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bParallelLayoutAttempts = false;
+
 private:
 	int32 RoomCount = 0;
+	// Used to place rooms in an order where parents come before their children.
+	FDungeonMissionGraphAnalysis MissionAnalysis;
 
 public:
 	void DrawDebugSpace();
@@ -52,8 +70,22 @@ public:
 	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
 	bool IsLocationValid(FIntVector FloorSpaceCoordinates) const;
 
+	// Finds a room without copying it. Returns NULL if the location is invalid.
+	const FFloorRoom* FindRoom(FIntVector FloorSpaceCoordinates) const;
+	FFloorRoom* FindRoom(FIntVector FloorSpaceCoordinates);
+	// Returns an invalid handle if the location is invalid.
+	FFloorRoomHandle GetRoomHandle(FIntVector FloorSpaceCoordinates) const;
+	const FFloorRoom& GetRoom(FFloorRoomHandle Handle) const;
+	FFloorRoom& GetRoom(FFloorRoomHandle Handle);
+
 	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
 	TArray<FFloorRoom> GetAllNeighbors(FFloorRoom Room);
+	// The floor-space locations of a room's loosely-coupled neighbors.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
+	TSet<FIntVector> GetNeighboringRooms(FFloorRoom Room) const;
+	// The floor-space locations of a room's tightly-coupled neighbors.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
+	TSet<FIntVector> GetTightlyCoupledRooms(FFloorRoom Room) const;
 
 	// Creates a blank DungeonFloor array, with the specified size.
 	void InitializeDungeonFloor(UDungeonSpaceGenerator* SpaceGenerator, TArray<int32> LevelSizes);
@@ -62,17 +94,11 @@ public:
 		int32 SymbolCount, FRandomStream& Rng);
 
 private:
-	bool PairNodesToRooms(UDungeonMissionNode* Node, TMap<FIntVector, FIntVector>& AvailableRooms, 
-		FRandomStream& Rng, TSet<UDungeonMissionNode*>& ProcessedNodes, TSet<FIntVector>& ProcessedRooms, 
-		FIntVector EntranceRoom, TMap<FIntVector, FIntVector>& AllOpenRooms, 
-		bool bIsTightCoupling, int32 TotalSymbolCount);
-
-	TSet<FIntVector> GetAvailableLocations(FIntVector Location, TSet<FIntVector> IgnoredLocations = TSet<FIntVector>());
 	FFloorRoom MakeFloorRoom(UDungeonMissionNode* Node, FIntVector Location,
 		FRandomStream& Rng, int32 TotalSymbolCount);
-	void SetRoom(FFloorRoom Room);
-	void GenerateDungeonRooms(UDungeonMissionNode* Head, FIntVector StartLocation, FRandomStream &Rng, int32 SymbolCount);
-	TKeyValuePair<FIntVector, FIntVector> GetOpenRoom(UDungeonMissionNode* Node,
-		TMap<FIntVector, FIntVector>& AvailableRooms, FRandomStream& Rng, TSet<FIntVector>& ProcessedRooms);
-	void ProcessRoomNeighbors();
+	void SetRoom(const FFloorRoom& Room);
+	// Creates a room for every placement the layout solver made, and links it to the room it's entered from.
+	void PlaceRooms(const TArray<FDungeonLayoutPlacement>& Placements, FRandomStream& Rng, int32 TotalSymbolCount);
+	// Runs LayoutAttempts layout solvers, and returns the placements of the lowest-index one which succeeds.
+	bool SolveLayoutAttempts(FIntVector StartLocation, FRandomStream& Rng, TArray<FDungeonLayoutPlacement>& OutPlacements);
 };
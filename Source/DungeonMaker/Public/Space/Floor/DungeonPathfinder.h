@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonTileGrid.h"
+
+class UDungeonSpaceGenerator;
+
+/*
+* Finds paths through the dungeon's floor tiles, without going through the navmesh.
+*
+* Rooms are linked together by their entrances, which gives us a small portal graph:
+* one node per entrance tile, with edges to the matching entrance in the next room and
+* to every other entrance in the same room (weighted by how far apart they are).
+* A path between two rooms first finds the cheapest route through the portal graph, then
+* runs A* over the floor tiles of only the rooms on that route.
+*
+* For targets which lots of agents head toward at once (the player, a room's entrance),
+* flow fields can be used instead: a single breadth-first search out from the target gives
+* every tile's distance to it, so each agent just steps to its closest neighbor.
+*
+* The portal graph is kept per room, lined up with the rooms' tiles. When tiles change (a room
+* gets replaced, a locked door opens), only the rooms whose tiles changed have their in-room
+* distances rebuilt, so keeping it up to date costs as much as what changed rather than the
+* whole dungeon. Flow fields cover a whole floor and are rebuilt lazily on their next use.
+*/
+struct DUNGEONMAKER_API FDungeonPathfinder
+{
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	FDungeonPathfinder();
+
+	// Finds every room and entrance in the dungeon. The space generator's tile grid must already be built.
+	void Initialize(const UDungeonSpaceGenerator* SpaceGenerator);
+	void Reset();
+
+	// Finds a path from Start to Goal (both in tile space, on the same floor), including both ends.
+	// Returns false if there is no path.
+	bool FindPath(const FIntVector& Start, const FIntVector& Goal, TArray<FIntVector>& OutPath);
+
+	// The next tile to step to from From, to get closer to Target.
+	// Returns From if Target can't be reached or From is already there.
+	FIntVector GetFlowDirection(const FIntVector& Target, const FIntVector& From);
+	// How many steps it takes to get from From to Target, or INVALID_INDEX if it can't be reached.
+	int32 GetFlowDistance(const FIntVector& Target, const FIntVector& From);
+
+	// How many flow fields are kept around before the least recently used one is thrown out.
+	int32 MaxCachedFlowFields;
+
+private:
+	struct FPortal
+	{
+		FIntVector Tile;
+		int32 Room;
+		// The entrance on the other side of this one, in the neighboring room.
+		int32 LinkedPortal;
+	};
+
+	struct FRoomNode
+	{
+		// Floor-space location of the room.
+		FIntVector Location;
+		TArray<int32> Portals;
+		// Distance between every pair of this room's portals, row by row; INVALID_INDEX if unreachable.
+		TArray<int32> PortalDistances;
+		// The grid's room version these distances were worked out from.
+		uint32 Version;
+	};
+
+	struct FFlowField
+	{
+		FIntVector Target;
+		uint32 Version;
+		uint32 LastUsed;
+		// Steps from each tile on the target's floor to the target, or INVALID_INDEX.
+		TArray<int32> Distances;
+	};
+
+	int32 FindRoom(const FIntVector& TileSpaceLocation) const;
+	bool IsWalkable(const FIntVector& TileSpaceLocation) const;
+	// Rebuilds portal distances for every room whose tiles have changed.
+	void UpdatePortalGraph();
+	void BuildRoom(int32 Room);
+	// Breadth-first search from Start, which stays inside Room if it's valid.
+	// Distances are indexed by tile within Room, or by tile on Start's floor if there's no room.
+	void FloodFill(const FIntVector& Start, int32 Room, TArray<int32>& Distances) const;
+	// Marks every room on the cheapest portal route from Start to Goal.
+	bool FindRoomRoute(const FIntVector& Start, int32 StartRoom, const FIntVector& Goal, int32 GoalRoom, TBitArray<>& OutRooms);
+	// A* over floor tiles. If AllowedRooms is given, only tiles in those rooms are searched.
+	bool FindTilePath(const FIntVector& Start, const FIntVector& Goal, const TBitArray<>* AllowedRooms, TArray<FIntVector>& OutPath);
+	const FFlowField* GetFlowField(const FIntVector& Target);
+
+	const FDungeonTileGrid* Grid;
+	int32 RoomSize;
+	TArray<FRoomNode> Rooms;
+	TMap<FIntVector, int32> RoomIndices;
+	TArray<FPortal> Portals;
+	uint32 PortalVersion;
+
+	TArray<FFlowField> FlowFields;
+	uint32 FlowFieldClock;
+
+	// Scratch space for searches, so we don't reallocate for every query.
+	// A tile's entry is only valid if its stamp matches the current search.
+	TArray<int32> SearchCosts;
+	TArray<int32> SearchParents;
+	TArray<uint32> SearchStamps;
+	uint32 SearchStamp;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonFloor.h"
+#include "DungeonSolvabilityAnalyzer.generated.h"
+
+class UDungeonMissionNode;
+class UGraphNode;
+
+/*
+* The results of checking whether a laid-out dungeon can actually be finished.
+* All locations are in floor space.
+*/
+USTRUCT(BlueprintType)
+struct DUNGEONMAKER_API FDungeonSolvabilityReport
+{
+	GENERATED_BODY()
+public:
+	// Can the goal be reached from the start?
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	bool bIsSolvable;
+	// Is there a locked door the player could open at the wrong time,
+	// leaving them without the keys they need to finish the dungeon?
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	bool bHasSoftlockRisk;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	FIntVector StartRoom;
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	FIntVector GoalRoom;
+
+	// Every room between the start and the goal, in the order the player will pass through them.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<FIntVector> CriticalPath;
+	// Rooms with keys, in the order they can be picked up.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<FIntVector> KeyOrder;
+	// Locked rooms, in the order they can be opened.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<FIntVector> LockOrder;
+	// Locked rooms where spending a key before the one the analyzer would open leaves the goal
+	// out of reach, assuming the player opens the rest in mission order.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	TArray<FIntVector> SoftlockRiskRooms;
+	// How many rooms could never be reached, no matter what.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly)
+	int32 UnreachableRoomCount;
+
+	FDungeonSolvabilityReport()
+	{
+		bIsSolvable = false;
+		bHasSoftlockRisk = false;
+		StartRoom = FIntVector(-1, -1, -1);
+		GoalRoom = FIntVector(-1, -1, -1);
+		UnreachableRoomCount = 0;
+	}
+};
+
+/*
+* Walks the room layout the same way a player would, picking up keys (rooms implementing IKeyRoom)
+* and spending them on locked rooms (rooms implementing ILockedRoom).
+* Keys can open any lock, so when several locked rooms are available the one which comes first
+* in the mission is opened first.
+*
+* This only needs the room classes, so it can be run before any rooms get spawned.
+* Each room and link is visited once; locked rooms are kept in a heap.
+* Whenever there is a choice of lock, every lock besides the one we open gets a trial walk
+* to see if opening it instead still gets to the goal.
+*/
+struct DUNGEONMAKER_API FDungeonSolvabilityAnalyzer
+{
+public:
+	// Analyzes the given dungeon space. The start is the room containing Head.
+	// If GoalSymbol is set, the goal is the first room using it; otherwise, it's the room
+	// furthest down the mission from the start.
+	static FDungeonSolvabilityReport Analyze(const TArray<FDungeonFloor>& DungeonSpace,
+		UDungeonMissionNode* Head, const UGraphNode* GoalSymbol = NULL);
+
+	static bool IsKeyRoom(const FFloorRoom& Room);
+	static bool IsLockedRoom(const FFloorRoom& Room);
+};
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonTile.h"
+
+class UDungeonSpaceGenerator;
+
+/*
+* Every tile in the dungeon, in tile space, stitched together from all the rooms.
+*
+* Each floor keeps a bitboard per tile type, with a bit set for each tile of that type.
+* On top of that is a coarse occupancy pyramid: for blocks of 8x8 and 64x64 tiles, we count
+* how many tiles of each type are in the block. Queries skip any block with none of what
+* they're looking for, so searching a mostly-empty area is cheap.
+*
+* The grid is built once the rooms have been spawned, and rooms keep it up to date as their
+* tiles change afterwards.
+*/
+struct DUNGEONMAKER_API FDungeonTileGrid
+{
+public:
+	static const int32 LEVEL_COUNT = 2;
+	// log2 of the block size at each level of the pyramid.
+	static const int32 LEVEL_SHIFTS[LEVEL_COUNT];
+
+	FDungeonTileGrid();
+
+	// Builds the grid from every room the space generator spawned.
+	void Build(const UDungeonSpaceGenerator* SpaceGenerator);
+	void Reset();
+	bool IsBuilt() const
+	{
+		return Floors.Num() > 0;
+	}
+
+	// Updates a single tile. A NULL tile clears it.
+	void SetTile(const FIntVector& TileSpaceLocation, const UDungeonTile* Tile);
+	bool IsTileOfType(const FIntVector& TileSpaceLocation, ETileType Type) const;
+	bool IsLocationValid(const FIntVector& TileSpaceLocation) const;
+	int32 XSize(int32 Floor) const
+	{
+		return Floors.IsValidIndex(Floor) ? Floors[Floor].Width : 0;
+	}
+	int32 YSize(int32 Floor) const
+	{
+		return Floors.IsValidIndex(Floor) ? Floors[Floor].Height : 0;
+	}
+	int32 NumFloors() const
+	{
+		return Floors.Num();
+	}
+	// Goes up every time a tile changes, so anything built from the grid can tell when it's out of date.
+	uint32 GetVersion() const
+	{
+		return Version;
+	}
+	// The grid's version when a tile in the room at this floor-space location last changed.
+	// Lets anything built per room rebuild only the rooms that changed.
+	uint32 GetRoomVersion(const FIntVector& FloorSpaceLocation) const;
+
+	// Finds the closest tile of a type on the same floor, by straight-line distance.
+	// Returns false if there isn't one within MaxDistance tiles.
+	bool FindNearestTileOfType(ETileType Type, const FIntVector& Origin, int32 MaxDistance, FIntVector& OutLocation) const;
+
+	// These call Visitor for every matching tile, without allocating anything.
+	// Returning false from Visitor stops the search early.
+	void ForEachTileInRectangle(ETileType Type, const FIntVector& Min, const FIntVector& Max,
+		TFunctionRef<bool(const FIntVector&)> Visitor) const;
+	void ForEachTileInRadius(ETileType Type, const FIntVector& Center, float Radius,
+		TFunctionRef<bool(const FIntVector&)> Visitor) const;
+
+	// These append to OutLocations, so a caller can reuse the same array between queries.
+	// Every tile of a type on every floor, floor by floor, row by row.
+	void GetAllTiles(ETileType Type, TArray<FIntVector>& OutLocations) const;
+	void GetTilesInRectangle(ETileType Type, const FIntVector& Min, const FIntVector& Max, TArray<FIntVector>& OutLocations) const;
+	void GetTilesInRadius(ETileType Type, const FIntVector& Center, float Radius, TArray<FIntVector>& OutLocations) const;
+
+	// The bitboard for a type on a floor. Bit y * XSize(Floor) + x is set for each tile of that type.
+	const TBitArray<>& GetLayer(int32 Floor, ETileType Type) const
+	{
+		return Floors[Floor].Layers[(int32)Type];
+	}
+
+private:
+	struct FFloorGrid
+	{
+		int32 Width;
+		int32 Height;
+		TBitArray<> Layers[TILE_TYPE_COUNT];
+		// Number of tiles of each type in each block, per level.
+		TArray<int32> BlockCounts[LEVEL_COUNT][TILE_TYPE_COUNT];
+		int32 BlockWidths[LEVEL_COUNT];
+		int32 BlockHeights[LEVEL_COUNT];
+		// Per room, row by row.
+		TArray<uint32> RoomVersions;
+		int32 RoomColumns;
+	};
+
+	void InitializeFloor(FFloorGrid& Floor, int32 Width, int32 Height);
+	void SetBit(FFloorGrid& Floor, int32 X, int32 Y, int32 Type, bool bValue);
+	int32 GetBlockCount(const FFloorGrid& Floor, int32 Level, int32 BlockX, int32 BlockY, int32 Type) const
+	{
+		return Floor.BlockCounts[Level][Type][BlockY * Floor.BlockWidths[Level] + BlockX];
+	}
+	// Visits every tile of a type in a rectangle (clamped to the floor), skipping empty blocks.
+	// Stops and returns false as soon as Visitor does.
+	bool VisitRectangle(const FFloorGrid& Floor, int32 Z, int32 Type, int32 MinX, int32 MinY, int32 MaxX, int32 MaxY,
+		TFunctionRef<bool(const FIntVector&)> Visitor) const;
+
+	TArray<FFloorGrid> Floors;
+	int32 RoomSize;
+	uint32 Version;
+};
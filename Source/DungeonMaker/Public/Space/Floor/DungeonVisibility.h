@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonTileGrid.h"
+
+/*
+* Line of sight, field of view, and fog of war over the tile grid.
+*
+* Floor tiles are see-through; walls and empty tiles block sight. Since the tile grid is already
+* stitched together across every room, sight carries on through entrances into the next room.
+*
+* Line of sight walks every tile the line between two tile centers passes through (a grid DDA).
+* Field of view uses recursive shadowcasting, one octant at a time, so each visible tile is
+* touched about once instead of tracing a line to every tile in range.
+*
+* Fog of war keeps a bitset per floor of every tile that's ever been seen. It only gets recomputed
+* when the viewer moves to a different tile or the grid changes, and only the tiles that were
+* visible last time get cleared.
+*/
+struct DUNGEONMAKER_API FDungeonVisibility
+{
+public:
+	FDungeonVisibility();
+
+	void Initialize(const FDungeonTileGrid* TileGrid);
+	void Reset();
+
+	// Whether From can see To, both in tile space. Tiles on different floors can't see each other.
+	bool HasLineOfSight(const FIntVector& From, const FIntVector& To) const;
+	// Appends every tile visible from Origin within Radius tiles, including walls which block sight.
+	void GetVisibleTiles(const FIntVector& Origin, int32 Radius, TArray<FIntVector>& OutTiles);
+
+	// Moves the viewer, updating what's visible and marking it as explored.
+	void UpdateFogOfWar(const FIntVector& Origin, int32 Radius);
+	bool IsTileVisible(const FIntVector& TileSpaceLocation) const;
+	bool IsTileExplored(const FIntVector& TileSpaceLocation) const;
+	// Bit y * XSize(Floor) + x is set for each tile that's been seen on that floor.
+	const TBitArray<>& GetExploredTiles(int32 Floor) const
+	{
+		return Explored[Floor];
+	}
+
+private:
+	// Tiles seen from a single point, with a bitset so each tile only gets added once.
+	struct FViewShed
+	{
+		int32 Floor;
+		TBitArray<> Bits;
+		// Indices of every set bit, so they can be cleared without touching the whole floor.
+		TArray<int32> Tiles;
+	};
+
+	bool IsTransparent(int32 Floor, int32 X, int32 Y) const;
+	void ComputeFieldOfView(const FIntVector& Origin, int32 Radius, FViewShed& OutView) const;
+	// Scans one octant, from Row outward, between two slopes. The multipliers turn octant
+	// coordinates into grid coordinates.
+	void CastLight(const FIntVector& Origin, int32 Radius, int32 Row, float StartSlope, float EndSlope,
+		int32 XX, int32 XY, int32 YX, int32 YY, FViewShed& OutView) const;
+	void MarkVisible(int32 Floor, int32 X, int32 Y, FViewShed& OutView) const;
+	void ClearView(FViewShed& View) const;
+
+	const FDungeonTileGrid* Grid;
+
+	TArray<TBitArray<>> Explored;
+	FViewShed FogView;
+	FIntVector FogOrigin;
+	int32 FogRadius;
+	uint32 FogVersion;
+
+	// For one-off queries, so they don't disturb the fog of war.
+	FViewShed ScratchView;
+};
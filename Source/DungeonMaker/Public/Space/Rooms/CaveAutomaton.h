@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+* A cellular automaton for carving caves, where every cell is either wall or open.
+*
+* Each row is packed into 64-bit words, one bit per cell, so a step works on 64 cells at once.
+* A cell's eight neighbors are the rows above, at, and below it, shifted one bit either way;
+* those get summed with bitwise adders into a 4-bit count per cell, which is then compared
+* against the birth and survival limits the same way. A step never looks at cells one by one.
+*
+* Anything outside the grid counts as wall, which keeps caves away from the edges.
+* Fixed cells never change, which is how the room's own walls and entrances are kept.
+*/
+struct DUNGEONMAKER_API FCaveAutomaton
+{
+public:
+	FCaveAutomaton();
+
+	// Sets up a grid which is all wall.
+	void Initialize(int32 CaveWidth, int32 CaveHeight);
+	// Pins a cell to wall or open, so it never changes.
+	void SetFixed(int32 X, int32 Y, bool bWall);
+	// Makes each cell which isn't fixed into a wall with the given chance.
+	void Randomize(float WallChance, FRandomStream& Rng);
+
+	// An open cell becomes wall if it has at least BirthLimit wall neighbors.
+	// A wall stays wall if it has at least SurvivalLimit wall neighbors.
+	void Step(int32 BirthLimit, int32 SurvivalLimit);
+
+	// Fills in open regions smaller than MinRegionSize which don't hold an anchor, then digs
+	// tunnels through walls until every remaining open region is connected to the first anchor.
+	void ConnectRegions(const TArray<FIntVector>& Anchors, int32 MinRegionSize);
+
+	bool IsWall(int32 X, int32 Y) const
+	{
+		if (X < 0 || Y < 0 || X >= Width || Y >= Height)
+		{
+			return true;
+		}
+		return (Walls[Y * WordsPerRow + (X >> 6)] >> (X & 63)) & 1;
+	}
+	int32 GetWidth() const
+	{
+		return Width;
+	}
+	int32 GetHeight() const
+	{
+		return Height;
+	}
+
+private:
+	void SetBit(TArray<uint64>& Bits, int32 X, int32 Y, bool bValue)
+	{
+		uint64 mask = 1ull << (X & 63);
+		uint64& word = Bits[Y * WordsPerRow + (X >> 6)];
+		word = bValue ? (word | mask) : (word & ~mask);
+	}
+	bool IsFixed(int32 X, int32 Y) const
+	{
+		return (FixedMask[Y * WordsPerRow + (X >> 6)] >> (X & 63)) & 1;
+	}
+	// Keeps fixed cells at their fixed values, and the bits past the end of each row as wall.
+	void ApplyFixedCells(TArray<uint64>& Bits) const;
+	// Labels every open cell with its region, and returns how big each region is.
+	void LabelRegions(TArray<int32>& OutLabels, TArray<int32>& OutRegionSizes) const;
+
+	int32 Width;
+	int32 Height;
+	int32 WordsPerRow;
+	// Bits past the width in the last word of each row.
+	uint64 PaddingMask;
+
+	TArray<uint64> Walls;
+	TArray<uint64> NextWalls;
+	// Set for each cell which never changes, with its value in FixedWalls.
+	TArray<uint64> FixedMask;
+	TArray<uint64> FixedWalls;
+	// A row of solid wall, for the rows past the top and bottom.
+	TArray<uint64> SolidRow;
+};
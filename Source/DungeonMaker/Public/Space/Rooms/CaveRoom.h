@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Space/Rooms/DungeonRoom.h"
+#include "CaveRoom.generated.h"
+
+/**
+ * A room carved into an organic cave with a cellular automaton.
+ * Walls are scattered at random, then smoothed out over a few steps, and finally any
+ * pockets that got cut off are either filled in or tunneled back to the entrances.
+ */
+UCLASS(Blueprintable)
+class DUNGEONMAKER_API ACaveRoom : public ADungeonRoom
+{
+	GENERATED_BODY()
+public:
+	// The tile placed wherever the cave has a wall.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cave")
+	const UDungeonTile* CaveWallTile;
+	// How much of the room starts out as wall, before smoothing.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cave", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float InitialWallChance = 0.45f;
+	// How many times to smooth the cave. More steps make for rounder, more open caves.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cave", meta = (ClampMin = "0"))
+	int32 SmoothingSteps = 5;
+	// An open tile becomes wall if at least this many of its eight neighbors are walls.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cave", meta = (ClampMin = "0", ClampMax = "9"))
+	int32 WallBirthLimit = 5;
+	// A wall stays a wall if at least this many of its eight neighbors are walls.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cave", meta = (ClampMin = "0", ClampMax = "9"))
+	int32 WallSurvivalLimit = 4;
+	// Open pockets smaller than this are filled in rather than tunneled to.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cave", meta = (ClampMin = "0"))
+	int32 MinRegionSize = 8;
+
+public:
+	virtual void DoTileReplacementPreprocessing(FRandomStream& Rng) override;
+};
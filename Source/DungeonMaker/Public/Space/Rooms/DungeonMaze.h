@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonMaze.generated.h"
+
+UENUM(BlueprintType)
+enum class EMazeAlgorithm : uint8
+{
+	// Carves one tile at a time, never next to more than one existing passage. Long, winding corridors.
+	Backtracker,
+	// Randomized Prim's on a grid of every other tile. Lots of short dead ends.
+	Prim,
+	// Eller's algorithm on a grid of every other tile, one row at a time. Only keeps a row's worth of state.
+	Eller
+};
+
+/*
+* Carves mazes into a rectangle of tiles.
+*
+* Which tiles can be carved and which have been are kept as bitsets, and every algorithm runs
+* iteratively (with an explicit stack where it needs one), so large mazes don't use much memory
+* and can't run out of stack.
+*
+* Prim's and Eller's carve on a lattice: cells are every other tile, lined up with the start,
+* and the tile between two joined cells is carved as well. Cells which can't be carved are left
+* out, which can cut the maze apart, so check with AreAllReachable afterwards.
+*/
+struct DUNGEONMAKER_API FDungeonMaze
+{
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	FDungeonMaze();
+
+	// Sets up an empty maze where nothing can be carved.
+	void Initialize(int32 MazeWidth, int32 MazeHeight);
+	void SetCarvable(int32 X, int32 Y, bool bCarvable);
+	// Removes every passage, leaving what can be carved alone.
+	void ClearPassages();
+
+	// Carves a maze out from Start, which always gets carved.
+	void Generate(EMazeAlgorithm Algorithm, const FIntVector& Start, FRandomStream& Rng);
+
+	void SetPassage(int32 X, int32 Y);
+	bool IsPassage(int32 X, int32 Y) const
+	{
+		return IsInBounds(X, Y) && Passages[ToIndex(X, Y)];
+	}
+	// Bit y * Width + x is set for each carved tile.
+	const TBitArray<>& GetPassages() const
+	{
+		return Passages;
+	}
+	int32 GetWidth() const
+	{
+		return Width;
+	}
+	int32 GetHeight() const
+	{
+		return Height;
+	}
+
+	// Breadth-first search through the passages from Start. True if every goal was reached.
+	bool AreAllReachable(const FIntVector& Start, const TArray<FIntVector>& Goals) const;
+
+private:
+	bool IsInBounds(int32 X, int32 Y) const
+	{
+		return X >= 0 && Y >= 0 && X < Width && Y < Height;
+	}
+	int32 ToIndex(int32 X, int32 Y) const
+	{
+		return Y * Width + X;
+	}
+	bool IsCarvable(int32 X, int32 Y) const
+	{
+		return IsInBounds(X, Y) && Carvable[ToIndex(X, Y)] && !Passages[ToIndex(X, Y)];
+	}
+	// The backtracker can only carve a tile if it touches at most one passage.
+	bool CanGrowInto(int32 X, int32 Y) const;
+	// Carves a lattice cell, and the tile between it and the cell it was reached from.
+	bool CarveLatticeStep(int32 FromX, int32 FromY, int32 ToX, int32 ToY);
+
+	void GenerateBacktracker(const FIntVector& Start, FRandomStream& Rng);
+	void GeneratePrim(const FIntVector& Start, FRandomStream& Rng);
+	void GenerateEller(const FIntVector& Start, FRandomStream& Rng);
+
+	int32 Width;
+	int32 Height;
+	TBitArray<> Carvable;
+	TBitArray<> Passages;
+};
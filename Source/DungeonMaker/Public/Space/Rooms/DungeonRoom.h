@@ -9,12 +9,15 @@
 #include "Components/BoxComponent.h"
 #include "../Mission/DungeonMissionSymbol.h"
 #include "DungeonFloorManager.h"
+#include "RoomConnectivity.h"
+#include "RoomTransformBatch.h"
 #include "DungeonRoom.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSpaceGen, Log, All);
 
 class UDungeonSpaceGenerator;
 class UGroundScatterManager;
+class UTileSynthesisRules;
 
 UCLASS(Blueprintable)
 class DUNGEONMAKER_API ADungeonRoom : public AActor
@@ -60,8 +63,14 @@ public:
 	FFloorRoom RoomMetadata;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tiles")
 	TArray<FRoomReplacements> RoomReplacementPhases;
+	// If set, the room's tiles are synthesized in one pass from these rules instead of running the replacement phases.
+	// The replacement phases are still used if synthesis can't find a layout that keeps the entrances connected.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tiles")
+	UTileSynthesisRules* TileSynthesisRules;
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Tiles")
 	TSet<FIntVector> EntranceLocations;
+	// Whether the entrances can reach each other, kept up to date while tiles are being replaced.
+	FRoomConnectivity EntranceConnectivity;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Room")
 	UGroundScatterManager* GroundScatter;
 	// A list of actors that get scattered throughout the room
@@ -151,9 +160,14 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms")
 	void DoTileReplacement(FRandomStream &Rng);
 
+	// Picks and queues up this room's tile meshes. They aren't added to the mesh actors until AddTileInstances.
 	void PlaceRoomTiles(TMap<const UDungeonTile*, ASpaceMeshActor*>& FloorComponentLookup,
 		TMap<const UDungeonTile*, ASpaceMeshActor*>& CeilingComponentLookup,
 		FRandomStream& Rng);
+	// Works out the transforms of every queued tile mesh. Safe to call for several rooms at once.
+	void BuildTileInstances();
+	// Adds the queued tile meshes to their mesh actors. Must be on the game thread.
+	void AddTileInstances();
 
 	void DetermineGroundScatter(TMap<const UDungeonTile*, TArray<FIntVector>> TileLocations,
 		FRandomStream& Rng);
@@ -165,6 +179,9 @@ public:
 	// Gets the transform for a tile from that tile's position in world space.
 	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
 	FTransform GetTileTransformFromTileSpace(const FIntVector& WorldLocation) const;
+	// Gets the transforms for several tiles from their positions in world space.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	TArray<FTransform> GetTileTransformsFromTileSpace(const TArray<FIntVector>& WorldLocations) const;
 	
 	// Returns the set of all DungeonTiles used by this room.
 	TSet<const UDungeonTile*> FindAllTiles();
@@ -206,6 +223,13 @@ public:
 	
 	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
 	FIntVector GetRoomTileSpacePosition() const;
+	// The world-space box around every tile mesh in this room.
+	UFUNCTION(BlueprintPure, Category = "World Generation|Dungeon Generation|Rooms")
+	FBox GetRoomBounds() const;
+	// Sends every tile changed since the last flush to the navigation system as one dirty area.
+	// This happens by itself on the tick after a tile changes.
+	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles")
+	void FlushNavigationChanges();
 
 	void SetTileGridCoordinates(FIntVector currentLocation, const UDungeonTile* Tile);
 
@@ -215,12 +239,21 @@ public:
 
 protected:
 	virtual void DoTileReplacementPreprocessing(FRandomStream& Rng);
+	// Fills in the room's floor from TileSynthesisRules. Returns false if no attempt worked out.
+	bool SynthesizeTiles(FRandomStream& Rng);
 	ADungeonRoom* AddNeighborEntrances(const FIntVector& Neighbor, FRandomStream& Rng,
 		const UDungeonTile* EntranceTile);
 	void PlaceTile(TMap<const UDungeonTile*, ASpaceMeshActor*>& ComponentLookup,
 		const UDungeonTile* Tile, int32 MeshID, const FTransform& MeshTransformOffset, const FIntVector& Location);
 
 	FTransform CreateMeshTransform(const FTransform &MeshTransformOffset, const FIntVector &Location) const;
+	// Decides once per room which ground mesh a wall tile is stacked with, and which of its
+	// ColumnMeshes can be used, so all its walls match. Returns the ground mesh.
+	int32 ChooseWallMeshes(const UDungeonTile* WallTile, TBitArray<>& OutUsableColumns, FRandomStream& Rng) const;
+	// Builds a wall from layer 1 up, Layers high, the way the wall tile's WallColumnMode says to.
+	// UsableColumns has a bit for each of the tile's ColumnMeshes this room may use.
+	void PlaceWallColumn(ASpaceMeshActor* MeshActor, const UDungeonTile* WallTile, int32 MeshSelection,
+		const TBitArray<>& UsableColumns, FIntVector Location, int32 Layers);
 	AActor* SpawnInteraction(const UDungeonTile* Tile, FDungeonTileInteractionOptions InteractionOptions, 
 		const FIntVector& Location, FRandomStream& Rng);
 	void CreateAllRoomTiles(TMap<const UDungeonTile*, TArray<FIntVector>>& TileLocations,
@@ -229,4 +262,12 @@ protected:
 		FRandomStream& Rng);
 
 	virtual void SpawnInterfaces(FRandomStream &Rng);
+
+	// Tile meshes waiting to be added, along with the room's frame while they're being placed.
+	FRoomTransformBatch TileInstances;
+
+	// The world-space box around the tile meshes between two room-local tiles, inclusive.
+	FBox GetTileBounds(const FIntVector& MinTile, const FIntVector& MaxTile) const;
+	// Everything changed since navigation last heard from us.
+	FBox PendingNavigationBounds;
 };
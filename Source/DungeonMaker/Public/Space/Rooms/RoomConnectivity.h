@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RoomHelpers.h"
+
+/*
+* Keeps track of whether a room's entrances can all reach each other over floor tiles,
+* so tile replacement can turn down a patch that would wall one of them off.
+*
+* Walkable tiles are grouped with a union-find. Turning a tile into floor only ever joins
+* groups, so those patches are handled as they're written. Turning floor into something else
+* can split a group, which union-find can't undo; those patches flood fill out from an entrance
+* instead, stopping as soon as every entrance has been reached.
+*
+* Changes are made inside a patch. If the patch cuts off an entrance, it can be rolled back,
+* which only touches the tiles in the patch.
+*/
+struct DUNGEONMAKER_API FRoomConnectivity
+{
+public:
+	FRoomConnectivity();
+
+	// Starts tracking a room. Entrance tiles are always treated as walkable.
+	void Initialize(const FDungeonRoomMetadata& Room, const TSet<FIntVector>& Entrances);
+	bool IsInitialized() const
+	{
+		return bInitialized;
+	}
+	bool AreEntrancesConnected() const
+	{
+		return bEntrancesConnected;
+	}
+
+	void BeginPatch();
+	// Tells us a tile in the room has changed.
+	void SetTile(int32 X, int32 Y, const UDungeonTile* Tile);
+	// Finishes the patch. Returns false if the entrances were connected before it and aren't anymore.
+	bool EndPatch();
+	// Forgets every change since BeginPatch. The tiles themselves still need to be put back.
+	void RollBackPatch();
+
+private:
+	static bool IsWalkable(const UDungeonTile* Tile)
+	{
+		return Tile != NULL && Tile->TileType == ETileType::Floor;
+	}
+	int32 ToIndex(int32 X, int32 Y) const
+	{
+		return Y * Width + X;
+	}
+
+	int32 FindGroup(int32 Tile);
+	void JoinGroups(int32 A, int32 B);
+	// Joins a newly walkable tile with its walkable neighbors.
+	void JoinNeighbors(int32 Tile);
+	void RebuildGroups();
+	bool AreEntrancesInOneGroup();
+	bool CanFloodFillReachEntrances();
+
+	bool bInitialized;
+	int32 Width;
+	int32 Height;
+	TBitArray<> Walkable;
+	TBitArray<> EntranceBits;
+	TArray<int32> EntranceTiles;
+	bool bEntrancesConnected;
+
+	// Union-find over walkable tiles. Only accurate while bGroupsValid is set.
+	TArray<int32> Parents;
+	TArray<int32> GroupSizes;
+	bool bGroupsValid;
+
+	// Every tile changed in the current patch, and whether it was walkable beforehand.
+	TArray<TPair<int32, bool>> PatchLog;
+	bool bPatchRemovedFloor;
+	bool bConnectedBeforePatch;
+
+	// Scratch space for flood fills.
+	TBitArray<> Visited;
+	TArray<int32> Queue;
+};
@@ -13,7 +13,7 @@ struct DUNGEONMAKER_API FDungeonRow
 {
 	GENERATED_BODY()
 public:
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	TArray<const UDungeonTile*> DungeonTiles;
 
 	FDungeonRow()
@@ -70,14 +70,28 @@ public:
 	}
 };
 
+/*
+* A grid of tiles.
+* Alongside the grid, we keep a bitset layer for each tile asset and each tile type, so
+* finding every location of a tile doesn't need to look at the whole grid.
+* Layers are kept up to date by Set(), so tiles should always be changed through it.
+*/
 USTRUCT(BlueprintType)
 struct DUNGEONMAKER_API FDungeonRoomMetadata
 {
 	GENERATED_BODY()
 public:
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	// Read-only to Blueprint: tiles have to be changed through Set() so the
+	// layers below stay in step with the rows.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	TArray<FDungeonRow> DungeonRows;
 
+	// Bit x * YSize() + y is set if the tile is at (x, y), so walking a layer visits
+	// locations in the same order as looping over x, then y.
+	TMap<const UDungeonTile*, TBitArray<>> TileLayers;
+	// One layer per ETileType.
+	TBitArray<> TileTypeLayers[TILE_TYPE_COUNT];
+
 	FDungeonRoomMetadata()
 	{
 		DungeonRows = TArray<FDungeonRow>();
@@ -92,6 +106,7 @@ public:
 		{
 			DungeonRows[i] = FDungeonRow(SizeX);
 		}
+		RebuildTileLayers();
 	}
 
 	FDungeonRow& operator[] (int Index)
@@ -109,9 +124,31 @@ public:
 		return tiles;
 	}
 
-	void Set(int X, int Y, const UDungeonTile* Tile)
+	void Set(int X, int Y, const UDungeonTile* Tile);
+
+	// Every location of a tile, in the same order as looping over x, then y.
+	void GetTileLocations(const UDungeonTile* Tile, TArray<FIntVector>& OutLocations) const;
+	void GetTileLocationsOfType(ETileType Type, TArray<FIntVector>& OutLocations) const;
+	bool IsTileOfType(int X, int Y, ETileType Type) const
+	{
+		CheckTileLayers();
+		const TBitArray<>& layer = TileTypeLayers[(int32)Type];
+		int32 bit = ToLayerIndex(X, Y);
+		return layer.IsValidIndex(bit) && layer[bit];
+	}
+
+	int32 ToLayerIndex(int X, int Y) const
+	{
+		return X * YSize() + Y;
+	}
+	// Throws away the layers and builds them again from the grid.
+	// Needs to be called if DungeonRows is ever resized directly.
+	void RebuildTileLayers();
+	// The layers are only kept up to date by Set() and RebuildTileLayers(),
+	// so make sure nobody resized the grid out from under them.
+	void CheckTileLayers() const
 	{
-		DungeonRows[Y].Set(X, Tile);
+		check(TileTypeLayers[0].Num() == XSize() * YSize());
 	}
 
 	int XSize() const
@@ -161,4 +198,22 @@ public:
 	}
 
 	FColor DrawRoom(AActor* ContextObject, FIntVector Position);
+
+	// Grids loaded from an asset only come with their rows, so build the layers to go with them.
+	void PostSerialize(const FArchive& Ar)
+	{
+		if (Ar.IsLoading())
+		{
+			RebuildTileLayers();
+		}
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FDungeonRoomMetadata> : public TStructOpsTypeTraitsBase2<FDungeonRoomMetadata>
+{
+	enum
+	{
+		WithPostSerialize = true
+	};
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ASpaceMeshActor;
+class UHierarchicalInstancedStaticMeshComponent;
+
+/*
+* Works out the transforms of a room's tile meshes all at once.
+*
+* Everything that's the same for the whole room (the actor's transform, where the room sits in
+* tile space, the rotation and offset for each edge and corner) is worked out once up front.
+* Instances are queued up by mesh and offset, with their tile positions kept in flat arrays,
+* so working out the transforms is a few multiply-adds over 4 positions at a time.
+*
+* Queueing and submitting have to happen on the game thread. Computing the transforms only
+* touches the batch itself, so different rooms can compute theirs in parallel.
+*/
+struct DUNGEONMAKER_API FRoomTransformBatch
+{
+public:
+	FRoomTransformBatch();
+
+	// Captures the room's frame. Needs to be called again if the room moves.
+	void Initialize(const FTransform& ActorTransform, const FIntVector& RoomTileSpacePosition, int32 RoomXSize, int32 RoomYSize);
+	bool IsInitialized() const
+	{
+		return bInitialized;
+	}
+
+	// Queues up a mesh instance at a room-local tile location.
+	void AddInstance(ASpaceMeshActor* MeshActor, int32 MeshID, const FTransform& MeshTransformOffset, const FIntVector& Location);
+	void AddInstance(UHierarchicalInstancedStaticMeshComponent* MeshComponent, const FTransform& MeshTransformOffset, const FIntVector& Location);
+	// Works out the transform for every queued instance.
+	void ComputeTransforms();
+	// Adds every instance to its mesh actor, then forgets the frame and all the instances.
+	void Submit();
+	int32 Num() const;
+
+	// The transform of a tile mesh at a room-local location, same as ADungeonRoom::CreateMeshTransform.
+	FTransform GetMeshTransform(const FTransform& MeshTransformOffset, const FIntVector& Location) const;
+	// The transform of a tile in tile space, same as ADungeonRoom::GetTileTransformFromTileSpace.
+	FTransform GetTileTransform(const FIntVector& TileSpaceLocation) const;
+	void GetTileTransforms(const TArray<FIntVector>& TileSpaceLocations, TArray<FTransform>& OutTransforms) const;
+
+private:
+	// Every instance sharing a mesh and an offset, so they share a rotation and scale.
+	struct FInstanceGroup
+	{
+		UHierarchicalInstancedStaticMeshComponent* MeshComponent;
+		FTransform MeshTransformOffset;
+		FQuat Rotation;
+		// Where the room's (0, 0, 0) tile ends up, offset included.
+		FVector Origin;
+
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<float> Z;
+		TArray<FTransform> Transforms;
+	};
+
+	// Which edges of the room a tile is on, as a lookup into the direction table.
+	int32 GetEdgeMask(const FIntVector& TileSpaceLocation) const;
+	int32 FindOrAddGroup(UHierarchicalInstancedStaticMeshComponent* MeshComponent, const FTransform& MeshTransformOffset);
+
+	bool bInitialized;
+	FVector ActorLocation;
+	FRotator ActorRotation;
+	FVector ActorScale;
+	FIntVector RoomPosition;
+	int32 XSize;
+	int32 YSize;
+
+	// Rotation and offset for a tile on each combination of edges, indexed by GetEdgeMask.
+	static const int32 EDGE_MASK_COUNT = 16;
+	FQuat EdgeRotations[EDGE_MASK_COUNT];
+	FVector EdgeOffsets[EDGE_MASK_COUNT];
+
+	TArray<FInstanceGroup> Groups;
+	// The group the last instance went into, since tiles tend to come in runs.
+	int32 LastGroup;
+};
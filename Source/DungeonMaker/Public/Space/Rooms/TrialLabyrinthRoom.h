@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Space/Rooms/TrialRoomBase.h"
+#include "Space/Rooms/DungeonMaze.h"
 #include "TrialLabyrinthRoom.generated.h"
 
 /**
@@ -16,18 +17,15 @@ class DUNGEONMAKER_API ATrialLabyrinthRoom : public ATrialRoomBase
 public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	const UDungeonTile* MazeGroundTile;
-
-protected:
-	UPROPERTY()
-	TSet<FIntVector> FloorPositions;
+	// How the maze gets carved. If an entrance ends up cut off, we fall back to the backtracker.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EMazeAlgorithm MazeAlgorithm = EMazeAlgorithm::Backtracker;
 
 public:
 	virtual void DoTileReplacementPreprocessing(FRandomStream& Rng) override;
 
-	bool PositionIsValid(FIntVector Position, const UDungeonTile* DefaultTile, bool bCheckNeighborCount = true) const;
-	bool MakeSection(FIntVector Location, const UDungeonTile* DefaultTile, bool bForceGenerate = false);
 protected:
-	bool RecursiveBacktracker(const FIntVector& Start, const UDungeonTile* DefaultTile,
-		FRandomStream& Rng);
-	bool RecursiveBacktrackerSearch(const FIntVector& Start, const FIntVector& Goal, TSet<FIntVector>& Visited);
+	// Carves the maze and opens up the entrances. Returns false if any entrance can't be reached.
+	bool GenerateMaze(FDungeonMaze& Maze, EMazeAlgorithm Algorithm, const FIntVector& Start,
+		const TArray<FIntVector>& EntranceTiles, const UDungeonTile* DefaultTile, FRandomStream& Rng) const;
 };
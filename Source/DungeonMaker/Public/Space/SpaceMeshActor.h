@@ -21,9 +21,22 @@ public:
 	USceneComponent* DummyRoot;
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	TArray<UHierarchicalInstancedStaticMeshComponent*> MeshComponents;
+	// One for each of the tile's ColumnMeshes, so they line up; entries without a mesh stay empty.
+	UPROPERTY(BlueprintReadOnly, VisibleInstanceOnly)
+	TArray<UHierarchicalInstancedStaticMeshComponent*> ColumnComponents;
 	UPROPERTY(BlueprintReadOnly, VisibleInstanceOnly)
 	const UDungeonTile* MeshTile;
 public:
-	void SetStaticMesh(const UDungeonTile* Tile, TArray<FDungeonTileMesh> Mesh);
+	void SetStaticMesh(const UDungeonTile* Tile, TArray<FDungeonTileMesh> Mesh, bool bAffectsNavigation = true);
+	// Adds the tile's tall wall meshes to ColumnComponents.
+	void AddColumnMeshes(const TArray<FDungeonTileMesh>& Meshes, bool bAffectsNavigation = true);
+	UHierarchicalInstancedStaticMeshComponent* GetMeshComponent(int32 MeshIndex) const;
+	// The component for one of the tile's column meshes, or NULL if it has no mesh.
+	UHierarchicalInstancedStaticMeshComponent* GetColumnComponent(int32 ColumnIndex) const;
 	int32 AddInstance(int32 MeshIndex, const FTransform& Transform);
+	void AddInstances(int32 MeshIndex, const TArray<FTransform>& Transforms);
+	static void AddInstances(UHierarchicalInstancedStaticMeshComponent* MeshComponent, const TArray<FTransform>& Transforms);
+
+private:
+	UHierarchicalInstancedStaticMeshComponent* CreateMeshComponent(const FString& MeshName, UStaticMesh* Mesh, bool bAffectsNavigation);
 };
@@ -29,6 +29,24 @@ enum class ETileType : uint8
 	Wall
 };
 
+// How many ETileTypes there are, for anything which keeps something per type.
+static const int32 TILE_TYPE_COUNT = 2;
+static_assert((int32)ETileType::Wall + 1 == TILE_TYPE_COUNT, "TILE_TYPE_COUNT needs to match ETileType.");
+
+// How a wall gets built up to the ceiling in rooms taller than one layer.
+UENUM(BlueprintType)
+enum class EWallColumnMode : uint8
+{
+	// One ground mesh instance per layer.
+	Layers,
+	// One ground mesh instance per wall, scaled up on Z to cover every layer.
+	// The mesh's pivot should be at its base. Materials can read the layer count
+	// back from the instance's Z scale to tile their textures.
+	Stretched,
+	// Pre-authored tall meshes from ColumnMeshes, as few as possible per wall.
+	TallMeshes
+};
+
 USTRUCT(BlueprintType)
 struct DUNGEONMAKER_API FDungeonTileMesh
 {
@@ -121,6 +139,16 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	bool bCeilingMeshShouldAlwaysBeTheSame = true;
 
+	// How this tile is stacked when it's used as a room's walls in a room taller than one layer.
+	// Anything other than Layers cuts the number of wall instances by about the room's height.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EWallColumnMode WallColumnMode = EWallColumnMode::Layers;
+	// For TallMeshes: entry N covers N + 1 layers. Any layers left over which
+	// don't fit a column mesh use the ground mesh.
+	// Each room rolls every entry's SelectionChance once to decide whether its walls can use it.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FDungeonTileMesh> ColumnMeshes;
+
 	// A list of all actors which will be spawned on this 
 	// tile. This can be in addition to or instead of a tile 
 	// mesh. Things with special behavior (like keys) can be spawned here.
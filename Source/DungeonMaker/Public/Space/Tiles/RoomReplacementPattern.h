@@ -9,6 +9,7 @@
 
 class URoomReplacementPattern;
 class UDungeonFloorManager;
+struct FRoomConnectivity;
 
 USTRUCT(BlueprintType)
 struct FRoomReplacements
@@ -55,10 +56,17 @@ public:
 	// This modifier can be negative, but the end result will be clamped between 0 and 1.
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "-1.0", ClampMax = "1.0"))
 	float SelectionDifficultyModifier;
+	// If false, a spot where this replacement would cut a room's entrances off from each other
+	// is skipped, and we keep looking for another one.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bCanDisconnectEntrances;
 
 	URoomReplacementPattern();
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles|Replacement")
 	bool FindAndReplace(FDungeonRoomMetadata& ReplaceRoom, FRandomStream& Rng);
+	// As above, but keeps Connectivity up to date, and won't disconnect its entrances
+	// unless bCanDisconnectEntrances is set.
+	bool FindAndReplace(FDungeonRoomMetadata& ReplaceRoom, FRoomConnectivity* Connectivity, FRandomStream& Rng);
 
 
 	UFUNCTION(BlueprintCallable, Category = "World Generation|Dungeon Generation|Rooms|Tiles|Replacement")
@@ -68,8 +76,10 @@ public:
 	float GetActualSelectionChance(ADungeonRoom* InputRoom) const;
 
 private:
-	void UpdateFloorTiles(int ReplacementXSize, int ReplacementYSize,
+	// Writes the replacement. If it would disconnect a room's entrances, every tile is put back
+	// and this returns false.
+	bool UpdateFloorTiles(int ReplacementXSize, int ReplacementYSize,
 		int XOffset, int YOffset, int Width, int Height, uint8 ReplacementOutput,
-		UDungeonFloorManager* ReplaceFloor, FDungeonRoomMetadata &ReplaceRoom);
+		UDungeonFloorManager* ReplaceFloor, FDungeonRoomMetadata &ReplaceRoom, FRoomConnectivity* Connectivity);
 	uint8 MatchesReplacement(FDungeonRoomMetadata& InputToCheck);
 };
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "DungeonTile.h"
+#include "TileAutotiler.generated.h"
+
+UENUM(BlueprintType)
+enum class EAutotileMode : uint8
+{
+	// Looks at the 4 edge neighbors. 16 variants, indexed by the mask
+	// North = 1, East = 2, South = 4, West = 8.
+	Cardinal,
+	// Looks at all 8 neighbors, with corners only counting if both edges next to them connect.
+	// That leaves the usual 47 blob variants, in order of their mask:
+	// North = 1, Northeast = 2, East = 4, Southeast = 8, South = 16, Southwest = 32, West = 64, Northwest = 128.
+	Blob
+};
+
+// Swaps one tile for a variant picked from which of its neighbors it connects to.
+USTRUCT(BlueprintType)
+struct DUNGEONMAKER_API FAutotileSet
+{
+	GENERATED_BODY()
+public:
+	// The tile to swap out.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	const UDungeonTile* Tile;
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EAutotileMode Mode;
+	// The variant for each case: 16 for Cardinal, 47 for Blob.
+	// Missing or empty entries leave the tile as it is.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<const UDungeonTile*> Variants;
+	// Other tiles this one connects to. It always connects to itself and its own variants.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<const UDungeonTile*> ConnectsTo;
+	// Whether places with no tile, like past the edge of the dungeon, count as connected.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bConnectsToEmpty;
+
+	FAutotileSet()
+	{
+		Tile = NULL;
+		Mode = EAutotileMode::Blob;
+		bConnectsToEmpty = true;
+	}
+};
+
+/**
+* Picks cosmetic variants of tiles (wall edges, corners, and so on) from their neighbors.
+* Each tile's neighbor mask is worked out once and looked up in a table, rather than scanning
+* the room with a replacement pattern for every mirrored case.
+*/
+UCLASS(BlueprintType)
+class DUNGEONMAKER_API UTileAutotiler : public UDataAsset
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FAutotileSet> TileSets;
+
+	static const int32 CARDINAL_CASE_COUNT = 16;
+	static const int32 BLOB_CASE_COUNT = 47;
+
+	// Which of the 47 blob cases an 8-neighbor mask falls into.
+	static int32 GetBlobIndex(uint8 NeighborMask);
+
+	// Picks variants for every tile in a grid with a 1-tile border of neighbors around it.
+	// Tiles is Width x Height, including the border; OutTiles gets the inner tiles, with
+	// anything which doesn't change left as it was.
+	void Autotile(const TArray<const UDungeonTile*>& Tiles, int32 Width, int32 Height,
+		TArray<const UDungeonTile*>& OutTiles) const;
+};
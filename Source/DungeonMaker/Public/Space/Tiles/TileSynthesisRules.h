@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "RoomHelpers.h"
+#include "TileSynthesisRules.generated.h"
+
+// Two tiles which are allowed to be next to each other, in either order.
+USTRUCT(BlueprintType)
+struct DUNGEONMAKER_API FTileAdjacencyRule
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	const UDungeonTile* Tile;
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	const UDungeonTile* Neighbor;
+	// Can they be side by side along X?
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bHorizontal;
+	// Can they be side by side along Y?
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bVertical;
+
+	FTileAdjacencyRule()
+	{
+		Tile = NULL;
+		Neighbor = NULL;
+		bHorizontal = true;
+		bVertical = true;
+	}
+};
+
+/**
+ * Rules for synthesizing a room's tiles in one pass (with wave function collapse),
+ * instead of running replacement phases over it.
+ * Which tiles can go next to each other is learned from example rooms, authored by hand, or both.
+ */
+UCLASS(BlueprintType)
+class DUNGEONMAKER_API UTileSynthesisRules : public UDataAsset
+{
+	GENERATED_BODY()
+public:
+	// Rooms to learn from. Two tiles can go next to each other if they're next to each other
+	// in any example, and tiles get picked about as often as they show up in the examples.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FDungeonRoomMetadata> Examples;
+	// Extra pairs of tiles which can go next to each other.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FTileAdjacencyRule> Adjacencies;
+	// Overrides how likely a tile is to be picked. Tiles not in here use how often they're in the examples.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TMap<const UDungeonTile*, float> TileWeights;
+	// How many times the solver can back out of a dead end before giving up on an attempt.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "0"))
+	int32 MaxBacktracks = 256;
+	// How many attempts to make before falling back to the room's replacement phases.
+	// An attempt fails if it runs out of backtracks, or cuts the entrances off from each other.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "1"))
+	int32 MaxAttempts = 3;
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RoomHelpers.h"
+
+class UTileSynthesisRules;
+
+/*
+* Fills in a room's tiles with wave function collapse.
+*
+* Each cell keeps a domain: a bitset of the tiles it could still be. Propagating a change to a
+* neighbor ORs together the allowed-neighbor bitsets of every tile left in the cell, then ANDs
+* that into the neighbor's domain, a whole word of tiles at a time.
+*
+* The next cell to collapse is the one with the lowest entropy, taken from a heap. Stale heap
+* entries are skipped rather than removed.
+*
+* Every domain change is written to a trail. On a contradiction, we undo the trail back to the
+* last choice, ban the tile that was chosen, and carry on. After MaxBacktracks of those, we give up.
+*
+* Cells which already hold something other than the free tile are fixed: they constrain their
+* neighbors but never change. Fixed tiles the rules don't mention allow anything next to them.
+*/
+struct DUNGEONMAKER_API FTileSynthesizer
+{
+public:
+	static const int32 INVALID_INDEX = -1;
+
+	FTileSynthesizer();
+
+	// Sets up every cell of Room holding FreeTile to be synthesized.
+	void Initialize(const UTileSynthesisRules* Rules, const FDungeonRoomMetadata& Room, const UDungeonTile* FreeTile);
+	// Limits a free cell to tiles of a type, such as keeping the ground inside an entrance walkable.
+	void RestrictToType(int32 X, int32 Y, ETileType Type);
+
+	// Returns false if there's no solution, or we ran out of backtracks finding one.
+	bool Solve(FRandomStream& Rng, int32 MaxBacktracks);
+	// Writes the solved tiles into the free cells of Room.
+	void Apply(FDungeonRoomMetadata& Room) const;
+
+	int32 GetBacktrackCount() const
+	{
+		return BacktrackCount;
+	}
+
+private:
+	// -X, +X, -Y, +Y; the opposite direction is always Direction ^ 1
+	static const int32 DIRECTION_COUNT = 4;
+
+	int32 AddTile(const UDungeonTile* Tile);
+	uint64* GetDomain(int32 Cell)
+	{
+		return &Domains[Cell * WordsPerDomain];
+	}
+	const uint64* GetDomain(int32 Cell) const
+	{
+		return &Domains[Cell * WordsPerDomain];
+	}
+	uint64* GetAllowed(int32 Direction, int32 Tile)
+	{
+		return &Allowed[(Direction * Tiles.Num() + Tile) * WordsPerDomain];
+	}
+	int32 GetNeighbor(int32 Cell, int32 Direction) const;
+	int32 CountTiles(int32 Cell) const;
+
+	// Replaces a free cell's domain, writing the old one to the trail.
+	// Returns false if that leaves the cell with nothing.
+	bool SetDomain(int32 Cell, const uint64* Domain);
+	bool Propagate();
+	void UndoTo(int32 TrailLength);
+	// Puts every cell changed since last time back in the heap, with its new entropy.
+	void PushChangedCells(FRandomStream& Rng);
+	// The free cell with the fewest options left, or INVALID_INDEX if every cell is collapsed.
+	int32 PopLowestEntropy();
+	int32 ChooseTile(int32 Cell, FRandomStream& Rng) const;
+
+	int32 Width;
+	int32 Height;
+	int32 WordsPerDomain;
+	TArray<const UDungeonTile*> Tiles;
+	TMap<const UDungeonTile*, int32> TileIndices;
+	TArray<float> Weights;
+	// Which tiles can be next to each tile, per direction.
+	TArray<uint64> Allowed;
+
+	TArray<uint64> Domains;
+	TBitArray<> FreeCells;
+	// Goes up whenever a cell's domain changes, so old heap entries can be spotted.
+	TArray<int32> CellVersions;
+
+	struct FEntropyEntry
+	{
+		float Entropy;
+		int32 Cell;
+		int32 Version;
+
+		bool operator<(const FEntropyEntry& Other) const
+		{
+			return Entropy < Other.Entropy;
+		}
+	};
+	TArray<FEntropyEntry> EntropyHeap;
+	TArray<int32> ChangedCells;
+
+	struct FDecision
+	{
+		int32 Cell;
+		int32 Tile;
+		// How long the trail was before this choice was made.
+		int32 TrailLength;
+	};
+	TArray<FDecision> Decisions;
+
+	// Cells whose domains changed and need to be propagated.
+	TArray<int32> PropagationStack;
+	TArray<int32> TrailCells;
+	TArray<uint64> TrailDomains;
+	TArray<uint64> Scratch;
+	int32 BacktrackCount;
+};
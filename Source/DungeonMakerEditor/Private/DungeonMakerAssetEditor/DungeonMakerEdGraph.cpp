@@ -61,6 +61,8 @@ void UDungeonMakerEdGraph::RebuildDungeonMaker()
 			G->RootNodes.Add(Node);
 		}
 	}
+
+	G->UpdateGraphID();
 }
 
 #if WITH_EDITOR